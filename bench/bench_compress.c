@@ -0,0 +1,188 @@
+/*
+ * Archives (user-041): fs_compress_archive() and the transparent read of
+ * an archived file by its plain name (fs_compress_read_alloc()), against
+ * a plain read, for idle session logs and daily notes of 16 to 128 KB.
+ * Deflate runs on zlib here (stubs/rom/miniz.h), not the ROM.
+ */
+#include "storage/fs_compress.h"
+#include "storage/storage_mgr.h"
+#include "storage/file_catalog.h"
+#include "storage/fs_writer.h"
+#include "mimi_config.h"
+#include "bench_util.h"
+
+#include <sys/stat.h>
+
+typedef enum {
+    KIND_SESSION = 0,           /* JSONL turns, as an idle session is archived */
+    KIND_NOTES,                 /* Markdown bullets, as an old daily note */
+} kind_t;
+
+typedef struct {
+    const char *path;
+    const char *data;
+    size_t len;
+} run_ctx_t;
+
+static int s_removed;
+
+/* ── Fakes for fs_compress.c ────────────────────────────────── */
+
+void storage_notify(storage_evt_t evt, const char *path)
+{
+    if (evt == STORAGE_EVT_REMOVED) s_removed++;
+}
+
+bool file_catalog_ready(void)
+{
+    return false;
+}
+
+bool file_catalog_stat(const char *path, file_catalog_entry_t *out)
+{
+    return false;
+}
+
+/* Plain write: the swap through "~new" is fs_writer's cost, not this one */
+esp_err_t fs_write_atomic(const char *path, const void *data, size_t len, fs_writer_t who)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) return ESP_FAIL;
+    size_t n = fwrite(data, 1, len, f);
+    fclose(f);
+    return n == len ? ESP_OK : ESP_FAIL;
+}
+
+/* ── Corpus ─────────────────────────────────────────────────── */
+
+static const char *const s_words[] = {
+    "the", "weather", "tomorrow", "remind", "me", "to", "check", "garden", "sensor",
+    "battery", "is", "low", "please", "schedule", "meeting", "with", "team", "at",
+    "nine", "temperature", "reading", "was", "degrees", "light", "turned", "off",
+    "kitchen", "search", "results", "for", "recipe", "found", "three", "options",
+};
+
+static size_t add_words(char *buf, uint32_t *seed, int count)
+{
+    const int n = sizeof(s_words) / sizeof(s_words[0]);
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        len += sprintf(buf + len, "%s%s", i ? " " : "", s_words[bench_rand(seed) % n]);
+    }
+    return len;
+}
+
+static char *make_text(kind_t kind, size_t size)
+{
+    char *buf = malloc(size + 512);
+    BENCH_CHECK(buf);
+    uint32_t seed = 41;
+    size_t len = 0;
+    for (int i = 0; len < size; i++) {
+        if (kind == KIND_SESSION) {
+            len += sprintf(buf + len, "{\"role\":\"%s\",\"content\":\"",
+                           (i % 2) ? "assistant" : "user");
+            len += add_words(buf + len, &seed, 6 + (int)(bench_rand(&seed) % 40));
+            len += sprintf(buf + len, "\",\"ts\":%u}\n", 1700000000u + i * 37);
+        } else {
+            if (i % 12 == 0) len += sprintf(buf + len, "\n## %02d:%02d\n", i / 60 % 24, i % 60);
+            len += sprintf(buf + len, "- ");
+            len += add_words(buf + len, &seed, 5 + (int)(bench_rand(&seed) % 15));
+            buf[len++] = '\n';
+        }
+    }
+    buf[size] = '\0';
+    return buf;
+}
+
+static void write_file(const char *path, const char *data, size_t len)
+{
+    FILE *f = fopen(path, "wb");
+    BENCH_CHECK(f && fwrite(data, 1, len, f) == len);
+    fclose(f);
+}
+
+static long file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+/* ── Runs ───────────────────────────────────────────────────── */
+
+static int64_t run_archive(void *arg)
+{
+    run_ctx_t *rc = arg;
+    char zpath[128];
+    snprintf(zpath, sizeof(zpath), "%s" FS_COMPRESS_EXT, rc->path);
+    remove(zpath);
+    write_file(rc->path, rc->data, rc->len);
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = fs_compress_archive(rc->path);
+    int64_t us = esp_timer_get_time() - start;
+    BENCH_CHECK(err == ESP_OK);
+    BENCH_CHECK(file_size(rc->path) < 0 && file_size(zpath) > 0);
+    return us;
+}
+
+/* Reads rc->path, which is either plain or archived by now */
+static int64_t run_read(void *arg)
+{
+    run_ctx_t *rc = arg;
+    size_t len = 0;
+    int64_t start = esp_timer_get_time();
+    char *text = fs_compress_read_alloc(rc->path, MIMI_FS_COMPRESS_MAX, &len);
+    int64_t us = esp_timer_get_time() - start;
+    BENCH_CHECK(text && len == rc->len && memcmp(text, rc->data, len) == 0);
+    free(text);
+    return us;
+}
+
+static void bench_one(kind_t kind, size_t size, int reps)
+{
+    char path[96], zpath[128];
+    bench_tmp_path(path, sizeof(path), kind == KIND_SESSION ? "session.jsonl" : "note.md");
+    snprintf(zpath, sizeof(zpath), "%s" FS_COMPRESS_EXT, path);
+    char *data = make_text(kind, size);
+    run_ctx_t rc = { .path = path, .data = data, .len = size };
+
+    remove(zpath);
+    write_file(path, data, size);
+    int64_t plain_us = bench_best_us(reps, run_read, &rc);
+
+    int64_t archive_us = bench_best_us(reps, run_archive, &rc);
+    long packed = file_size(zpath);
+    int64_t read_us = bench_best_us(reps, run_read, &rc);
+
+    /* A second archive appends to the first, and restore undoes both */
+    write_file(path, data, size);
+    BENCH_CHECK(fs_compress_archive(path) == ESP_OK);
+    BENCH_CHECK(fs_compress_restore(path) == ESP_OK);
+    BENCH_CHECK(file_size(zpath) < 0 && file_size(path) == (long)(2 * size));
+
+    printf("%-7s %4zu KB -> %5.1f KB (%4.1f%%)   archive %6.2f ms   read plain %6.3f ms"
+           "   read archived %6.3f ms\n",
+           kind == KIND_SESSION ? "session" : "notes", size / 1024, packed / 1024.0,
+           100.0 * packed / size, archive_us / 1000.0, plain_us / 1000.0, read_us / 1000.0);
+    remove(path);
+    free(data);
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = bench_quick(argc, argv);
+    const size_t sizes[] = { 16 * 1024, 64 * 1024, MIMI_FS_COMPRESS_MAX / 2 };
+    int n = quick ? 2 : 3;
+    int reps = quick ? 1 : 5;
+
+    printf("Archives: deflate at %d probes, zlib standing in for ROM miniz (best of %d)\n",
+           MIMI_FS_COMPRESS_PROBES, reps);
+    for (int kind = KIND_SESSION; kind <= KIND_NOTES; kind++) {
+        for (int i = 0; i < n; i++) {
+            bench_one((kind_t)kind, sizes[i], reps);
+        }
+    }
+    BENCH_CHECK(s_removed > 0);
+    return 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * Memory entries (user-037): SimHash throughput and near-duplicate
+ * detection over a synthetic 10k-entry corpus, split with
+ * memory_split_entries(), plus the BM25 selection that builds the
+ * memory section of every prompt (memory_rank_select()).
+ */
+#include "memory/memory_dedup.h"
+#include "memory/memory_rank.h"
+#include "memory/memory_store.h"
+#include "memory/memory_kv.h"
+#include "mimi_config.h"
+#include "bench_util.h"
+
+#define VOCAB          600
+#define WORD_MAX       12
+#define NEAR_EVERY     10       /* Every 10th entry restates an earlier one */
+#define EXACT_EVERY    50       /* Every 50th repeats one verbatim */
+#define FP_PAIRS       200000   /* Unrelated pairs sampled for false positives */
+#define FP_MAX_RATE    100      /* At the configured distance: under 1 in 100 */
+
+typedef struct {
+    const char *text;
+    size_t len;
+    uint64_t fp;
+    int tokens;
+    int source;                 /* Entry it repeats, or -1 */
+    bool exact;
+} entry_t;
+
+static char s_vocab[VOCAB][WORD_MAX];
+static char *s_corpus;
+static entry_t *s_entries;
+static int s_count;
+
+/* ── Corpus ─────────────────────────────────────────────────── */
+
+static void make_vocab(uint32_t *seed)
+{
+    static const char *const syl[] = {
+        "ka", "lo", "mi", "ren", "tu", "vo", "zel", "pa", "dor", "qui", "bex", "fin",
+        "gra", "hu", "jo", "nel", "ri", "ta", "wen", "yo",
+    };
+    const int nsyl = sizeof(syl) / sizeof(syl[0]);
+    for (int i = 0; i < VOCAB; i++) {
+        int parts = 2 + (int)(bench_rand(seed) % 2);
+        s_vocab[i][0] = '\0';
+        for (int p = 0; p < parts; p++) strcat(s_vocab[i], syl[bench_rand(seed) % nsyl]);
+    }
+}
+
+/* Skewed towards common words, like notes about the same few topics */
+static const char *pick_word(uint32_t *seed)
+{
+    uint32_t span = 1 + bench_rand(seed) % VOCAB;
+    return s_vocab[bench_rand(seed) % span];
+}
+
+/* Restate: swap one word for another, keep the rest. */
+static size_t restate(const char *src, size_t len, char *out, uint32_t *seed)
+{
+    int words = 0;
+    for (size_t i = 2; i < len; i++) {
+        if (src[i] == ' ') words++;
+    }
+    int target = 1 + (int)(bench_rand(seed) % (words > 1 ? words - 1 : 1));
+    size_t o = 0;
+    int w = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] == ' ' && ++w == target) {
+            o += sprintf(out + o, " %s", pick_word(seed));
+            while (i + 1 < len && src[i + 1] != ' ') i++;
+            continue;
+        }
+        out[o++] = src[i];
+    }
+    return o;
+}
+
+static size_t build_corpus(int count, uint32_t *seed)
+{
+    char **lines = calloc(count, sizeof(char *));
+    int *source = calloc(count, sizeof(int));
+    BENCH_CHECK(lines && source);
+    size_t total = 0;
+    char line[256];
+    for (int i = 0; i < count; i++) {
+        size_t len = 0;
+        source[i] = -1;
+        if (i > 0 && (i % EXACT_EVERY == EXACT_EVERY - 1 || i % NEAR_EVERY == NEAR_EVERY - 1)) {
+            int src = (int)(bench_rand(seed) % i);
+            while (source[src] >= 0) src--;     /* Repeat an original */
+            source[i] = src;
+            if (i % EXACT_EVERY == EXACT_EVERY - 1) {
+                len = strlen(lines[src]);
+                memcpy(line, lines[src], len);
+            } else {
+                len = restate(lines[src], strlen(lines[src]), line, seed);
+            }
+        } else {
+            int words = 8 + (int)(bench_rand(seed) % 9);
+            len = sprintf(line, "-");
+            for (int w = 0; w < words; w++) len += sprintf(line + len, " %s", pick_word(seed));
+        }
+        line[len] = '\0';
+        lines[i] = strdup(line);
+        total += len + 1;
+    }
+
+    s_corpus = malloc(total + 1);
+    s_entries = calloc(count, sizeof(entry_t));
+    BENCH_CHECK(s_corpus && s_entries);
+    size_t off = 0;
+    for (int i = 0; i < count; i++) {
+        off += sprintf(s_corpus + off, "%s\n", lines[i]);
+        s_entries[i].source = source[i];
+        s_entries[i].exact = source[i] >= 0 && i % EXACT_EVERY == EXACT_EVERY - 1;
+        free(lines[i]);
+    }
+    free(lines);
+    free(source);
+    return off;
+}
+
+static bool on_entry(const char *text, size_t len, const char *heading, size_t heading_len,
+                     int line, void *arg)
+{
+    int *n = arg;
+    BENCH_CHECK(*n < s_count);
+    s_entries[*n].text = text;
+    s_entries[*n].len = len;
+    (*n)++;
+    return true;
+}
+
+/* Same rule as is_near() in memory_dedup.c, at a given distance */
+static bool is_near(const entry_t *a, const entry_t *b, int hamming)
+{
+    if (a->tokens == 0 || b->tokens == 0) return false;
+    int dist = __builtin_popcountll(a->fp ^ b->fp);
+    if (a->tokens < MIMI_DEDUP_MIN_TOKENS || b->tokens < MIMI_DEDUP_MIN_TOKENS) {
+        return dist == 0 && a->tokens == b->tokens;
+    }
+    return dist <= hamming;
+}
+
+/* ── Fakes for memory_rank.c ────────────────────────────────── */
+
+int memory_kv_count(void)
+{
+    return 0;
+}
+
+size_t memory_kv_render(char *buf, size_t size)
+{
+    if (size) buf[0] = '\0';
+    return 0;
+}
+
+static void copy_source(char *buf, size_t size, size_t from)
+{
+    size_t len = strlen(s_corpus);
+    from = from < len ? from : len;
+    size_t n = len - from < size - 1 ? len - from : size - 1;
+    memcpy(buf, s_corpus + from, n);
+    buf[n] = '\0';
+}
+
+esp_err_t memory_read_long_term(char *buf, size_t size)
+{
+    copy_source(buf, size, 0);
+    return ESP_OK;
+}
+
+esp_err_t memory_read_recent(char *buf, size_t size, int days)
+{
+    copy_source(buf, size, MIMI_MEMORY_RANK_SOURCE_MAX);
+    return ESP_OK;
+}
+
+/* ── Runs ───────────────────────────────────────────────────── */
+
+static int64_t run_simhash(void *arg)
+{
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < s_count; i++) {
+        s_entries[i].fp = memory_simhash(s_entries[i].text, s_entries[i].len, &s_entries[i].tokens);
+    }
+    return esp_timer_get_time() - start;
+}
+
+static int table_size(void)
+{
+    return s_count < MIMI_DEDUP_MAX_ENTRIES ? s_count : MIMI_DEDUP_MAX_ENTRIES;
+}
+
+/* Write-time checks: each later entry against a full fingerprint table */
+static int64_t run_scan(void *arg)
+{
+    int *hits = arg;
+    int table = table_size();
+    *hits = 0;
+    int64_t start = esp_timer_get_time();
+    for (int p = table; p < s_count; p++) {
+        for (int i = 0; i < table; i++) {
+            if (is_near(&s_entries[p], &s_entries[i], MIMI_DEDUP_HAMMING)) {
+                (*hits)++;
+                break;
+            }
+        }
+    }
+    return esp_timer_get_time() - start;
+}
+
+static int64_t run_rank(void *arg)
+{
+    char *out = arg;
+    static const char *const queries[] = { NULL, "kalo mi", "renvo dorqui finbex", "zelpa" };
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < 4; i++) {
+        memory_rank_select(queries[i] ? queries[i] : "", out, 4096);
+    }
+    return (esp_timer_get_time() - start) / 4;
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = bench_quick(argc, argv);
+    int reps = quick ? 1 : 5;
+    uint32_t seed = 37;
+    s_count = quick ? 3000 : 10000;   /* Above MIMI_DEDUP_MAX_ENTRIES */
+
+    make_vocab(&seed);
+    size_t bytes = build_corpus(s_count, &seed);
+
+    int split = 0;
+    int64_t start = esp_timer_get_time();
+    memory_split_entries(s_corpus, on_entry, &split);
+    int64_t split_us = esp_timer_get_time() - start;
+    BENCH_CHECK(split == s_count);
+
+    int64_t hash_us = bench_best_us(reps, run_simhash, NULL);
+
+    /* Planted repeats found, and unrelated pairs flagged, per distance */
+    static const int hamming[] = { MIMI_DEDUP_HAMMING, 10, 14 };
+    const int nham = sizeof(hamming) / sizeof(hamming[0]);
+    int exact = 0, near = 0, near_found[3] = { 0 }, false_pos[3] = { 0 }, pairs = 0;
+    for (int i = 0; i < s_count; i++) {
+        const entry_t *e = &s_entries[i];
+        if (e->source < 0) continue;
+        if (e->exact) {
+            BENCH_CHECK(e->fp == s_entries[e->source].fp);
+            exact++;
+            continue;
+        }
+        near++;
+        for (int h = 0; h < nham; h++) {
+            if (is_near(e, &s_entries[e->source], hamming[h])) near_found[h]++;
+        }
+    }
+    for (int k = 0; k < FP_PAIRS; k++) {
+        int a = (int)(bench_rand(&seed) % s_count);
+        int b = (int)(bench_rand(&seed) % s_count);
+        const entry_t *ea = &s_entries[a], *eb = &s_entries[b];
+        if (a == b || ea->source == b || eb->source == a ||
+            (ea->source >= 0 && ea->source == eb->source)) {
+            continue;
+        }
+        pairs++;
+        for (int h = 0; h < nham; h++) {
+            if (is_near(ea, eb, hamming[h])) false_pos[h]++;
+        }
+    }
+    BENCH_CHECK(false_pos[0] * FP_MAX_RATE < pairs);
+
+    int hits = 0;
+    int64_t scan_us = bench_best_us(reps, run_scan, &hits);
+    char *out = malloc(4096);
+    BENCH_CHECK(out);
+    int64_t rank_us = bench_best_us(reps, run_rank, out);
+    free(out);
+
+    printf("Memory entries: %d entries, %zu bytes (best of %d)\n", s_count, bytes, reps);
+    printf("  split         %8.2f ms\n", split_us / 1000.0);
+    printf("  simhash       %8.2f ms   %.0f entries/s   %.1f MB/s\n", hash_us / 1000.0,
+           s_count * 1e6 / hash_us, bytes / (double)hash_us);
+    printf("  exact repeats %5d, all at distance 0\n", exact);
+    printf("  one-word edits %4d\n", near);
+    for (int h = 0; h < nham; h++) {
+        printf("    <= %2d bits  found %5.1f%%   unrelated pairs matched %.3f%%%s\n", hamming[h],
+               100.0 * near_found[h] / (near ? near : 1), 100.0 * false_pos[h] / pairs,
+               hamming[h] == MIMI_DEDUP_HAMMING ? "   (MIMI_DEDUP_HAMMING)" : "");
+    }
+    printf("  write check   %8.2f us per entry against %d fingerprints (%d flagged)\n",
+           scan_us / (double)(s_count - table_size()), table_size(), hits);
+    printf("  bm25 select   %8.2f ms per prompt (%d KB MEMORY.md + %d KB notes)\n",
+           rank_us / 1000.0, MIMI_MEMORY_RANK_SOURCE_MAX / 1024, MIMI_MEMORY_RANK_SOURCE_MAX / 1024);
+
+    free(s_entries);
+    free(s_corpus);
+    return 0;
+}
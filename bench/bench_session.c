@@ -0,0 +1,142 @@
+/*
+ * Session history reads (user-027): session_codec_read_tail() against a
+ * full session_codec_read_all() pass, the cost of the old per-turn parse,
+ * for both on-flash formats and session files of 100 to 10k records.
+ */
+#include "memory/session_codec.h"
+#include "bench_util.h"
+
+#define TAIL_RECORDS   20
+#define LONG_LINE      5000     /* Over the old 2 KB fgets buffer */
+
+typedef struct {
+    session_fmt_t fmt;
+    const char *path;
+    int seen;
+    bool summary;               /* The summary record came first */
+    int first;                  /* Index of the first message seen */
+    int last;                   /* Index of the last message seen */
+    bool order_ok;
+} run_ctx_t;
+
+static bool on_record(const session_rec_t *rec, void *arg)
+{
+    run_ctx_t *rc = arg;
+    if (rec->role == SESSION_ROLE_SUMMARY) {
+        rc->summary = rc->seen == 0;
+    } else {
+        int idx = -1;
+        sscanf(rec->content, "msg %d", &idx);
+        if (rc->last >= 0 && idx != rc->last + 1) rc->order_ok = false;
+        if (rc->first < 0) rc->first = idx;
+        rc->last = idx;
+    }
+    rc->seen++;
+    return true;
+}
+
+/* Summary first, then user/assistant turns; one record near the end is long. */
+static void write_session(session_fmt_t fmt, const char *path, int count)
+{
+    FILE *f = fopen(path, "wb");
+    BENCH_CHECK(f);
+    uint8_t hdr[SESSION_BIN_MAGIC_LEN];
+    size_t hdr_len = session_codec_header(fmt, hdr);
+    fwrite(hdr, 1, hdr_len, f);
+
+    char *text = malloc(LONG_LINE + 64);
+    BENCH_CHECK(text);
+    uint32_t seed = 27;
+    for (int i = 0; i < count; i++) {
+        session_rec_t rec = { .ts = 1700000000u + i };
+        if (i == 0) {
+            rec.role = SESSION_ROLE_SUMMARY;
+            snprintf(text, LONG_LINE, "summary of the earlier conversation");
+        } else {
+            rec.role = (i % 2) ? SESSION_ROLE_USER : SESSION_ROLE_ASSISTANT;
+            int n = snprintf(text, LONG_LINE, "msg %d", i);
+            int pad = (i == count - 3) ? LONG_LINE - 100 : 40 + (int)(bench_rand(&seed) % 200);
+            for (int k = 0; k < pad; k++) text[n++] = (k % 7 == 6) ? ' ' : (char)('a' + k % 26);
+            text[n] = '\0';
+        }
+        rec.content = text;
+        rec.len = strlen(text);
+        size_t len = 0;
+        uint8_t *buf = session_codec_encode(fmt, &rec, &len);
+        BENCH_CHECK(buf);
+        fwrite(buf, 1, len, f);
+        free(buf);
+    }
+    free(text);
+    fclose(f);
+}
+
+static int64_t time_read(run_ctx_t *rc, bool tail)
+{
+    FILE *f = fopen(rc->path, "rb");
+    BENCH_CHECK(f);
+    rc->seen = 0;
+    rc->summary = false;
+    rc->first = rc->last = -1;
+    rc->order_ok = true;
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = tail ? session_codec_read_tail(rc->fmt, f, TAIL_RECORDS, on_record, rc)
+                         : session_codec_read_all(rc->fmt, f, on_record, rc);
+    int64_t us = esp_timer_get_time() - start;
+    fclose(f);
+    BENCH_CHECK(err == ESP_OK);
+    return us;
+}
+
+static int64_t run_tail(void *arg)
+{
+    return time_read(arg, true);
+}
+
+static int64_t run_all(void *arg)
+{
+    return time_read(arg, false);
+}
+
+static void bench_one(session_fmt_t fmt, int count, int reps)
+{
+    char path[128];
+    bench_tmp_path(path, sizeof(path), fmt == SESSION_FMT_BIN ? "session.bin" : "session.jsonl");
+    write_session(fmt, path, count);
+
+    FILE *f = fopen(path, "rb");
+    BENCH_CHECK(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+
+    run_ctx_t rc = { .fmt = fmt, .path = path };
+    int64_t all_us = bench_best_us(reps, run_all, &rc);
+    BENCH_CHECK(rc.seen == count && rc.summary && rc.first == 1 && rc.order_ok);
+
+    /* The summary, then exactly the last TAIL_RECORDS messages, in order */
+    int64_t tail_us = bench_best_us(reps, run_tail, &rc);
+    BENCH_CHECK(rc.seen == TAIL_RECORDS + 1 && rc.summary && rc.order_ok);
+    BENCH_CHECK(rc.first == count - TAIL_RECORDS && rc.last == count - 1);
+
+    printf("%-5s %6d records %9ld bytes   read_all %8.2f ms   read_tail %6.3f ms\n",
+           fmt == SESSION_FMT_BIN ? "bin" : "jsonl", count, size,
+           all_us / 1000.0, tail_us / 1000.0);
+    remove(path);
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = bench_quick(argc, argv);
+    const int sizes[] = { 100, 1000, 10000 };
+    int n = quick ? 2 : 3;
+
+    printf("Session history: full parse vs tail of %d records (best of %d)\n",
+           TAIL_RECORDS, quick ? 1 : 5);
+    for (int fmt = SESSION_FMT_JSONL; fmt <= SESSION_FMT_BIN; fmt++) {
+        for (int i = 0; i < n; i++) {
+            bench_one((session_fmt_t)fmt, sizes[i], quick ? 1 : 5);
+        }
+    }
+    return 0;
+}
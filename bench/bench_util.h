@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_timer.h"
+
+/* Shared helpers for the host benchmarks: timing, scratch files, checks. */
+
+#define BENCH_CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* "--quick" runs the small sizes only, for ctest. */
+static inline bool bench_quick(int argc, char **argv)
+{
+    return argc > 1 && strcmp(argv[1], "--quick") == 0;
+}
+
+/* A scratch path under $TMPDIR (or /tmp) that the caller removes. */
+static inline void bench_tmp_path(char *buf, size_t size, const char *name)
+{
+    const char *dir = getenv("TMPDIR");
+    snprintf(buf, size, "%s/mimi_bench_%d_%s", dir && dir[0] ? dir : "/tmp", (int)getpid(), name);
+}
+
+/* Deterministic xorshift32, so every run measures the same corpus. */
+static inline uint32_t bench_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+typedef int64_t (*bench_fn_t)(void *ctx);
+
+/* Best of reps runs in microseconds; fn returns its own elapsed time. */
+static inline int64_t bench_best_us(int reps, bench_fn_t fn, void *ctx)
+{
+    int64_t best = INT64_MAX;
+    for (int i = 0; i < reps; i++) {
+        int64_t us = fn(ctx);
+        if (us < best) best = us;
+    }
+    return best;
+}
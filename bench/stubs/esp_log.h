@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdio.h>
+
+/* Errors and warnings go to stderr; info and debug would skew the timings. */
+#define ESP_LOGE(tag, fmt, ...)  fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)  fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)  ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...)  ((void)(tag))
+#define ESP_LOGV(tag, fmt, ...)  ((void)(tag))
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+#include <zlib.h>
+
+/* The ROM CRC-32 is the zlib one, so records written here read back on the device. */
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    return (uint32_t)crc32(crc, buf, len);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+ * The slice of the ROM miniz API fs_compress.c uses, over zlib raw
+ * deflate. Both emit plain deflate streams; the probe count maps to the
+ * zlib level with the same probe budget in miniz's own level table, so
+ * ratios track the device closely and timings show scale only.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint;
+
+#define TDEFL_MAX_PROBES_MASK   0xFFF
+
+typedef enum {
+    TDEFL_NO_FLUSH = 0,
+    TDEFL_SYNC_FLUSH = 2,
+    TDEFL_FULL_FLUSH = 3,
+    TDEFL_FINISH = 4,
+} tdefl_flush;
+
+typedef enum {
+    TDEFL_STATUS_BAD_PARAM = -2,
+    TDEFL_STATUS_PUT_BUF_FAILED = -1,
+    TDEFL_STATUS_OKAY = 0,
+    TDEFL_STATUS_DONE = 1,
+} tdefl_status;
+
+typedef bool (*tdefl_put_buf_func_ptr)(const void *buf, int len, void *user);
+
+typedef struct {
+    int level;
+} tdefl_compressor;
+
+static inline tdefl_status tdefl_init(tdefl_compressor *d, tdefl_put_buf_func_ptr put_buf,
+                                      void *user, int flags)
+{
+    /* miniz's probes per level: 0, 1, 6, 32, 16, 32, 128, 256, 512, 768, 1500 */
+    static const int probes[] = { 0, 1, 6, 32, 16, 32, 128, 256, 512, 768, 1500 };
+    int want = flags & TDEFL_MAX_PROBES_MASK;
+    d->level = 9;
+    for (int i = 1; i < 10; i++) {
+        if (probes[i] >= want) {
+            d->level = i;
+            break;
+        }
+    }
+    return TDEFL_STATUS_OKAY;
+}
+
+/* Single-shot only (TDEFL_FINISH), the way fs_compress.c calls it. */
+static inline tdefl_status tdefl_compress(tdefl_compressor *d, const void *in, size_t *in_size,
+                                          void *out, size_t *out_size, tdefl_flush flush)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (flush != TDEFL_FINISH ||
+        deflateInit2(&zs, d->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return TDEFL_STATUS_BAD_PARAM;
+    }
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = (uInt)*in_size;
+    zs.next_out = out;
+    zs.avail_out = (uInt)*out_size;
+    int rc = deflate(&zs, Z_FINISH);
+    *in_size = zs.total_in;
+    *out_size = zs.total_out;
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? TDEFL_STATUS_DONE : TDEFL_STATUS_OKAY;
+}
+
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF   4
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    int unused;
+} tinfl_decompressor;
+
+#define tinfl_init(d)   ((d)->unused = 0)
+
+static inline tinfl_status tinfl_decompress(tinfl_decompressor *d, const mz_uint8 *in,
+                                            size_t *in_size, mz_uint8 *out_start,
+                                            mz_uint8 *out_next, size_t *out_size, mz_uint flags)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -15) != Z_OK) return TINFL_STATUS_BAD_PARAM;
+    zs.next_in = (Bytef *)in;
+    zs.avail_in = (uInt)*in_size;
+    zs.next_out = out_next;
+    zs.avail_out = (uInt)*out_size;
+    int rc = inflate(&zs, Z_FINISH);
+    *in_size = zs.total_in;
+    *out_size = zs.total_out;
+    inflateEnd(&zs);
+    if (rc == Z_STREAM_END) return TINFL_STATUS_DONE;
+    return rc == Z_BUF_ERROR && zs.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT
+                                                  : TINFL_STATUS_FAILED;
+}
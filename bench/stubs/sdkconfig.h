@@ -0,0 +1,3 @@
+#pragma once
+
+/* Host build: every CONFIG_* option keeps its default in mimi_config.h. */
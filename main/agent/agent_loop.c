@@ -1,9 +1,11 @@
 #include "agent_loop.h"
 #include "agent/context_builder.h"
+#include "clock/clock_service.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
 #include "llm/llm_proxy.h"
 #include "memory/session_mgr.h"
+#include "storage/storage_mgr.h"
 #include "tools/tool_registry.h"
 
 #include <string.h>
@@ -17,6 +19,7 @@
 static const char *TAG = "agent";
 
 #define TOOL_OUTPUT_SIZE  (8 * 1024)
+#define TOOL_LOG_SIZE     2048
 
 /* Build the assistant content array from llm_response_t for the messages history.
  * Returns a cJSON array with text and tool_use blocks. */
@@ -73,13 +76,21 @@ static void append_turn_context_prompt(char *prompt, size_t size, const mimi_msg
         return;
     }
 
+    /* Saves a get_current_time call on most turns */
+    char now[64];
+    if (clock_service_format(now, sizeof(now)) == 0) {
+        snprintf(now, sizeof(now), "unknown, clock not set; call get_current_time");
+    }
+
     int n = snprintf(
         prompt + off, size - off,
         "\n## Current Turn Context\n"
+        "- current_time: %s\n"
         "- source_channel: %s\n"
         "- source_chat_id: %s\n"
         "- If using cron_add for Telegram in this turn, set channel='telegram' and chat_id to source_chat_id.\n"
         "- Never use chat_id 'cron' for Telegram messages.\n",
+        now,
         msg->channel[0] ? msg->channel : "(unknown)",
         msg->chat_id[0] ? msg->chat_id : "(empty)");
 
@@ -136,9 +147,21 @@ static char *patch_tool_input_with_context(const llm_tool_call_t *call, const mi
     return patched;
 }
 
+/* One transcript line per tool call, for the session's "tool" record */
+static void tool_log_append(char *log, const char *name, const char *input, size_t result_len)
+{
+    if (!log) {
+        return;
+    }
+    size_t off = strnlen(log, TOOL_LOG_SIZE - 1);
+    snprintf(log + off, TOOL_LOG_SIZE - off, "%s %.160s -> %u bytes\n",
+             name, input, (unsigned)result_len);
+}
+
 /* Build the user message with tool_result blocks */
 static cJSON *build_tool_results(const llm_response_t *resp, const mimi_msg_t *msg,
-                                 char *tool_output, size_t tool_output_size)
+                                 char *tool_output, size_t tool_output_size,
+                                 char *tool_log)
 {
     cJSON *content = cJSON_CreateArray();
 
@@ -153,6 +176,7 @@ static cJSON *build_tool_results(const llm_response_t *resp, const mimi_msg_t *m
         /* Execute tool */
         tool_output[0] = '\0';
         tool_registry_execute(call->name, tool_input, tool_output, tool_output_size);
+        tool_log_append(tool_log, call->name, tool_input, strlen(tool_output));
         free(patched_input);
 
         ESP_LOGI(TAG, "Tool %s result: %d bytes", call->name, (int)strlen(tool_output));
@@ -174,10 +198,13 @@ static void agent_loop_task(void *arg)
 
     /* Allocate large buffers from PSRAM */
     char *system_prompt = heap_caps_calloc(1, MIMI_CONTEXT_BUF_SIZE, MALLOC_CAP_SPIRAM);
-    char *history_json = heap_caps_calloc(1, MIMI_LLM_STREAM_BUF_SIZE, MALLOC_CAP_SPIRAM);
     char *tool_output = heap_caps_calloc(1, TOOL_OUTPUT_SIZE, MALLOC_CAP_SPIRAM);
+    char *tool_log = NULL;
+#if MIMI_SESSION_LOG_TOOLS
+    tool_log = heap_caps_calloc(1, TOOL_LOG_SIZE, MALLOC_CAP_SPIRAM);
+#endif
 
-    if (!system_prompt || !history_json || !tool_output) {
+    if (!system_prompt || !tool_output) {
         ESP_LOGE(TAG, "Failed to allocate PSRAM buffers");
         vTaskDelete(NULL);
         return;
@@ -191,18 +218,17 @@ static void agent_loop_task(void *arg)
         if (err != ESP_OK) continue;
 
         ESP_LOGI(TAG, "Processing message from %s:%s", msg.channel, msg.chat_id);
+        storage_mgr_set_busy(true);
 
         /* 1. Build system prompt */
-        context_build_system_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE);
+        clock_service_ensure();     /* Local unless SNTP never answered */
+        context_build_system_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, msg.content);
         append_turn_context_prompt(system_prompt, MIMI_CONTEXT_BUF_SIZE, &msg);
         ESP_LOGI(TAG, "LLM turn context: channel=%s chat_id=%s", msg.channel, msg.chat_id);
 
         /* 2. Load session history into cJSON array */
-        session_get_history_json(msg.chat_id, history_json,
-                                 MIMI_LLM_STREAM_BUF_SIZE, MIMI_AGENT_MAX_HISTORY);
-
-        cJSON *messages = cJSON_Parse(history_json);
-        if (!messages) messages = cJSON_CreateArray();
+        cJSON *messages = cJSON_CreateArray();
+        session_get_history(msg.chat_id, messages, MIMI_AGENT_MAX_HISTORY);
 
         /* 3. Append current user message */
         cJSON *user_msg = cJSON_CreateObject();
@@ -211,6 +237,7 @@ static void agent_loop_task(void *arg)
         cJSON_AddItemToArray(messages, user_msg);
 
         /* 4. ReAct loop */
+        if (tool_log) tool_log[0] = '\0';
         char *final_text = NULL;
         int iteration = 0;
         bool sent_working_status = false;
@@ -260,7 +287,8 @@ static void agent_loop_task(void *arg)
             cJSON_AddItemToArray(messages, asst_msg);
 
             /* Execute tools and append results */
-            cJSON *tool_results = build_tool_results(&resp, &msg, tool_output, TOOL_OUTPUT_SIZE);
+            cJSON *tool_results = build_tool_results(&resp, &msg, tool_output, TOOL_OUTPUT_SIZE,
+                                                    tool_log);
             cJSON *result_msg = cJSON_CreateObject();
             cJSON_AddStringToObject(result_msg, "role", "user");
             cJSON_AddItemToObject(result_msg, "content", tool_results);
@@ -274,14 +302,19 @@ static void agent_loop_task(void *arg)
 
         /* 5. Send response */
         if (final_text && final_text[0]) {
-            /* Save to session (only user text + final assistant text) */
-            esp_err_t save_user = session_append(msg.chat_id, "user", msg.content);
-            esp_err_t save_asst = session_append(msg.chat_id, "assistant", final_text);
-            if (save_user != ESP_OK || save_asst != ESP_OK) {
-                ESP_LOGW(TAG, "Session save failed for chat %s (user=%s, assistant=%s)",
-                         msg.chat_id,
-                         esp_err_to_name(save_user),
-                         esp_err_to_name(save_asst));
+            /* Save the turn in one write: user text, tool transcript, final text */
+            session_record_t turn[3];
+            int turn_len = 0;
+            turn[turn_len++] = (session_record_t){ "user", msg.content };
+            if (tool_log && tool_log[0]) {
+                turn[turn_len++] = (session_record_t){ "tool", tool_log };
+            }
+            turn[turn_len++] = (session_record_t){ "assistant", final_text };
+
+            esp_err_t save_err = session_append_turn(msg.chat_id, turn, turn_len, 0);
+            if (save_err != ESP_OK) {
+                ESP_LOGW(TAG, "Session save failed for chat %s: %s",
+                         msg.chat_id, esp_err_to_name(save_err));
             } else {
                 ESP_LOGI(TAG, "Session saved for chat %s", msg.chat_id);
             }
@@ -314,6 +347,10 @@ static void agent_loop_task(void *arg)
             }
         }
 
+        /* Compaction and rollup summaries follow on the storage task once idle */
+        storage_mgr_set_busy(false);
+        storage_mgr_request_check();
+
         /* Free inbound message content */
         free(msg.content);
 
@@ -5,21 +5,11 @@
 
 /**
  * Build the system prompt from bootstrap files (SOUL.md, USER.md)
- * and memory context (MEMORY.md + recent daily notes).
+ * and the memory entries (MEMORY.md + recent daily notes) most relevant
+ * to the current message, up to MIMI_CONTEXT_MEMORY_BUDGET bytes.
  *
- * @param buf   Output buffer (caller allocates, recommend MIMI_CONTEXT_BUF_SIZE)
- * @param size  Buffer size
+ * @param buf    Output buffer (caller allocates, recommend MIMI_CONTEXT_BUF_SIZE)
+ * @param size   Buffer size
+ * @param query  Current user message used to rank memory (may be NULL)
  */
-esp_err_t context_build_system_prompt(char *buf, size_t size);
-
-/**
- * Build the complete messages JSON array for LLM call.
- * Combines session history + current user message.
- *
- * @param history_json    JSON array from session_get_history_json()
- * @param user_message    Current user message text
- * @param buf             Output buffer
- * @param size            Buffer size
- */
-esp_err_t context_build_messages(const char *history_json, const char *user_message,
-                                 char *buf, size_t size);
+esp_err_t context_build_system_prompt(char *buf, size_t size, const char *query);
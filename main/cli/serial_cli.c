@@ -5,21 +5,35 @@
 #include "llm/llm_proxy.h"
 #include "memory/memory_store.h"
 #include "memory/session_mgr.h"
+#include "memory/memory_kv.h"
+#include "memory/memory_rollup.h"
+#include "memory/memory_dedup.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/file_catalog.h"
+#include "storage/file_cache.h"
+#include "storage/fs_compress.h"
+#include "storage/fs_writer.h"
+#include "search/search_index.h"
 #include "proxy/http_proxy.h"
 #include "tools/tool_registry.h"
 #include "tools/tool_web_search.h"
 #include "cron/cron_service.h"
 #include "heartbeat/heartbeat.h"
 #include "skills/skill_loader.h"
+#include "clock/clock_service.h"
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
-#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
 #include "esp_log.h"
 #include "esp_console.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "argtable3/argtable3.h"
@@ -161,6 +175,48 @@ static int cmd_memory_write(int argc, char **argv)
     return 0;
 }
 
+/* --- memory_facts command --- */
+static bool print_fact(const char *key, const char *value, uint32_t ts, void *ctx)
+{
+    printf("  %-24s %s\n", key, value);
+    return true;
+}
+
+static int cmd_memory_facts(int argc, char **argv)
+{
+    printf("Facts (%d / %d):\n", memory_kv_count(), MIMI_MEMORY_KV_MAX_KEYS);
+    memory_kv_list(NULL, print_fact, NULL);
+    return 0;
+}
+
+/* --- memory_rollup command --- */
+static int cmd_memory_rollup(int argc, char **argv)
+{
+    /* The console stack is too small for a TLS request: merge verbatim */
+    memory_rollup_result_t res;
+    esp_err_t err = memory_rollup_run(false, &res);
+    if (err == ESP_ERR_INVALID_STATE) {
+        printf("Clock not set yet; see clock_status.\n");
+        return 1;
+    }
+    printf("Rolled %d notes into weekly digests, %d weeks into monthly digests, "
+           "archived %d months.\n", res.notes_rolled, res.weeks_rolled, res.months_archived);
+    return err == ESP_OK ? 0 : 1;
+}
+
+/* --- memory_dedup command --- */
+static int cmd_memory_dedup(int argc, char **argv)
+{
+    memory_dedup_report_t rep;
+    int files = 0;
+    esp_err_t err = memory_dedup_clean(&rep, &files);
+    printf("Checked %d entries: %d near-duplicates removed from %d file(s).\n",
+           rep.entries, rep.dropped, files);
+    if (rep.detail[0]) printf("First: %s\n", rep.detail);
+    printf("%d entries fingerprinted.\n", memory_dedup_count());
+    return err == ESP_OK ? 0 : 1;
+}
+
 /* --- session_list command --- */
 static int cmd_session_list(int argc, char **argv)
 {
@@ -190,6 +246,241 @@ static int cmd_session_clear(int argc, char **argv)
     return 0;
 }
 
+/* --- session_cache command --- */
+static int cmd_session_cache(int argc, char **argv)
+{
+    session_cache_stats_t st;
+    session_cache_get_stats(&st);
+    uint32_t lookups = st.hits + st.misses;
+    printf("Cached sessions: %d (%u bytes, budget %d)\n",
+           st.entries, (unsigned)st.bytes, MIMI_SESSION_CACHE_BYTES);
+    printf("Hits: %u  Misses: %u  Hit rate: %u%%\n",
+           (unsigned)st.hits, (unsigned)st.misses,
+           lookups ? (unsigned)(st.hits * 100 / lookups) : 0);
+    printf("Evictions: %u\n", (unsigned)st.evictions);
+    return 0;
+}
+
+/* --- storage_stats command --- */
+static int cmd_storage_stats(int argc, char **argv)
+{
+    storage_stats_t st;
+    storage_get_stats(&st);
+    if (st.scans == 0) {
+        printf("No storage scan yet.\n");
+        return 0;
+    }
+
+    printf("Partition: %u / %u KB used (%u%%, high water %d%%)\n",
+           (unsigned)(st.part_used / 1024), (unsigned)(st.part_total / 1024),
+           st.part_total ? (unsigned)(st.part_used * 100 / st.part_total) : 0,
+           MIMI_STORAGE_HIGH_WATER_PCT);
+    printf("%-10s %10s %10s %6s %10s %12s\n",
+           "Namespace", "Used KB", "Quota KB", "Files", "Evictions", "Evicted KB");
+    for (int i = 0; i < STORAGE_NS_COUNT; i++) {
+        const storage_ns_usage_t *u = &st.ns[i];
+        printf("%-10s %10u %10u %6d %10u %12u\n", storage_ns_name(i),
+               (unsigned)(u->bytes / 1024), (unsigned)(u->quota / 1024), u->files,
+               (unsigned)u->evictions, (unsigned)(u->evicted_bytes / 1024));
+    }
+    printf("Scans: %u (last took %u ms)\n", (unsigned)st.scans, (unsigned)st.last_scan_ms);
+    printf("Idle GC: %u runs, %u ms total, longest step %u ms, %u skipped during turns\n",
+           (unsigned)st.io.gc_runs, (unsigned)st.io.gc_ms, (unsigned)st.io.gc_max_ms,
+           (unsigned)st.io.gc_skipped);
+    printf("Writes: %u timed, %u over %d ms, worst %u ms%s%s\n",
+           (unsigned)st.io.writes, (unsigned)st.io.slow_writes, MIMI_STORAGE_SLOW_WRITE_MS,
+           (unsigned)st.io.write_max_ms, st.io.write_max_path[0] ? " on " : "",
+           st.io.write_max_path);
+
+    file_cache_stats_t fc;
+    file_cache_get_stats(&fc);
+    uint32_t served = fc.hits + fc.absent;
+    uint32_t lookups = served + fc.misses + fc.bypass;
+    printf("File cache: %d files, %u KB; %u hits, %u absent, %u misses, %u too large "
+           "(%u%% without flash)\n",
+           fc.entries, (unsigned)(fc.bytes / 1024), (unsigned)fc.hits, (unsigned)fc.absent,
+           (unsigned)fc.misses, (unsigned)fc.bypass,
+           lookups ? (unsigned)(served * 100 / lookups) : 0);
+    printf("           %u evictions, %u invalidations\n",
+           (unsigned)fc.evictions, (unsigned)fc.invalidations);
+
+    fs_writer_stats_t ws;
+    fs_writer_get_stats(&ws);
+    printf("%-10s %10s %10s %10s %10s %12s\n",
+           "Writer", "Requests", "Flushes", "Coalesced", "Failures", "Written KB");
+    for (int i = 0; i < FS_WRITER_COUNT; i++) {
+        const fs_writer_usage_t *u = &ws.who[i];
+        printf("%-10s %10u %10u %10u %10u %12u\n", fs_writer_name(i),
+               (unsigned)u->requests, (unsigned)u->flushes, (unsigned)u->coalesced,
+               (unsigned)u->failures, (unsigned)(u->bytes / 1024));
+    }
+    if (ws.pending) printf("%d file(s) waiting to be flushed\n", ws.pending);
+
+    fs_compress_stats_t zs;
+    fs_compress_get_stats(&zs);
+    printf("Compression: %u files packed, %u -> %u KB (%u%%), %u ms; %u inflated, %u ms\n",
+           (unsigned)zs.packed, (unsigned)(zs.raw_bytes / 1024), (unsigned)(zs.packed_bytes / 1024),
+           zs.raw_bytes ? (unsigned)(zs.packed_bytes * 100 / zs.raw_bytes) : 0,
+           (unsigned)zs.deflate_ms, (unsigned)zs.unpacked, (unsigned)zs.inflate_ms);
+    return 0;
+}
+
+/* --- fs_check command --- */
+static struct {
+    struct arg_lit *repair;
+    struct arg_end *end;
+} fs_check_args;
+
+static int cmd_fs_check(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&fs_check_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, fs_check_args.end, argv[0]);
+        return 1;
+    }
+
+    bool repair = fs_check_args.repair->count > 0;
+    file_catalog_check_t chk;
+    if (file_catalog_check(repair, &chk) != ESP_OK) {
+        printf("File catalog not available.\n");
+        return 1;
+    }
+    printf("Catalog: %d entries (max %d), %s\n", chk.entries, MIMI_FS_CATALOG_MAX,
+           file_catalog_ready() ? "serving listings" : "incomplete, listings scan flash");
+    printf("Flash: %d files; %d missing, %d stale, %d extra\n",
+           chk.scanned, chk.missing, chk.stale, chk.extra);
+    if (chk.first[0]) printf("First: %s\n", chk.first);
+    if (repair && (chk.missing || chk.stale || chk.extra)) {
+        printf("Rebuilt: %d entries\n", file_catalog_count());
+    }
+    return 0;
+}
+
+/* --- fs_bench command --- */
+#define FS_BENCH_DIR    MIMI_SPIFFS_BASE "/fsbench/"
+#define FS_BENCH_MAX    256
+
+static struct {
+    struct arg_int *files;
+    struct arg_end *end;
+} fs_bench_args;
+
+typedef struct {
+    int n;
+    int64_t total_us;
+    int64_t max_us;
+} fs_bench_op_t;
+
+static void fs_bench_note(fs_bench_op_t *op, int64_t start)
+{
+    int64_t us = esp_timer_get_time() - start;
+    op->n++;
+    op->total_us += us;
+    if (us > op->max_us) op->max_us = us;
+}
+
+static void fs_bench_print(const char *name, const fs_bench_op_t *op)
+{
+    printf("%-8s %6d %10u %10u\n", name, op->n,
+           op->n ? (unsigned)(op->total_us / op->n) : 0, (unsigned)op->max_us);
+}
+
+static bool fs_bench_count(const char *path, void *ctx)
+{
+    (*(int *)ctx)++;
+    return true;
+}
+
+/* Times one file op, n times; returns false on the first failure */
+static bool fs_bench_files(const char *mode, const char *data, size_t len, int n,
+                           fs_bench_op_t *op)
+{
+    char path[64];
+    for (int i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), FS_BENCH_DIR "f%03d.txt", i);
+        int64_t start = esp_timer_get_time();
+        FILE *f = fopen(path, mode);
+        if (!f || (len && fwrite(data, 1, len, f) != len)) {
+            if (f) fclose(f);
+            printf("fs_bench: %s \"%s\" failed\n", path, mode);
+            return false;
+        }
+        fclose(f);
+        fs_bench_note(op, start);
+    }
+    return true;
+}
+
+static int cmd_fs_bench(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&fs_bench_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, fs_bench_args.end, argv[0]);
+        return 1;
+    }
+
+    int files = fs_bench_args.files->count ? fs_bench_args.files->ival[0] : 32;
+    if (files < 1 || files > FS_BENCH_MAX) {
+        printf("Files must be 1..%d\n", FS_BENCH_MAX);
+        return 1;
+    }
+    char *data = malloc(1024);
+    if (!data) return 1;
+    for (int i = 0; i < 1024; i++) data[i] = (i % 64 == 63) ? '\n' : 'a' + i % 26;
+
+    /* Plain stdio, not storage_notify(): the catalog and caches never see these */
+    fs_bench_op_t create = {0}, open_op = {0}, append = {0}, rewrite = {0}, list = {0};
+    fs_ensure_parent(FS_BENCH_DIR "f000.txt");
+    bool ok = fs_bench_files("w", data, 256, files, &create) &&
+              fs_bench_files("r", NULL, 0, files, &open_op) &&
+              fs_bench_files("a", data, 128, files, &append) &&
+              fs_bench_files("w", data, 1024, files, &rewrite);
+    for (int i = 0; ok && i < 5; i++) {
+        int seen = 0;
+        int64_t start = esp_timer_get_time();
+        fs_scan(FS_BENCH_DIR, fs_bench_count, &seen);
+        fs_bench_note(&list, start);
+        if (seen != files) {
+            printf("fs_bench: listed %d of %d files\n", seen, files);
+            ok = false;
+        }
+    }
+
+    char path[64];
+    for (int i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), FS_BENCH_DIR "f%03d.txt", i);
+        remove(path);
+    }
+    if (fs_has_dirs()) rmdir(MIMI_SPIFFS_BASE "/fsbench");
+    free(data);
+
+    size_t total = 0, used = 0;
+    fs_info(&total, &used);
+    printf("%s, %u / %u KB used, %d files in " FS_BENCH_DIR "\n",
+           fs_has_dirs() ? "LittleFS" : "SPIFFS", (unsigned)(used / 1024),
+           (unsigned)(total / 1024), files);
+    printf("%-8s %6s %10s %10s\n", "Op", "Count", "Avg us", "Max us");
+    fs_bench_print("create", &create);
+    fs_bench_print("open", &open_op);
+    fs_bench_print("append", &append);
+    fs_bench_print("rewrite", &rewrite);
+    fs_bench_print("list", &list);
+    return ok ? 0 : 1;
+}
+
+/* --- search_stats command --- */
+static int cmd_search_stats(int argc, char **argv)
+{
+    search_stats_t st;
+    search_index_get_stats(&st);
+    printf("Indexed files: %d / %d\n", st.files, MIMI_SEARCH_MAX_FILES);
+    printf("Terms: %d  Postings: %d  (%u bytes PSRAM)\n",
+           st.terms, st.postings, (unsigned)st.bytes);
+    printf("Queries: %u  Files reindexed since boot: %u\n",
+           (unsigned)st.queries, (unsigned)st.reindexed);
+    return 0;
+}
+
 /* --- heap_info command --- */
 static int cmd_heap_info(int argc, char **argv)
 {
@@ -202,6 +493,30 @@ static int cmd_heap_info(int argc, char **argv)
     return 0;
 }
 
+/* --- clock_status command --- */
+static int cmd_clock_status(int argc, char **argv)
+{
+    char now[64];
+    if (clock_service_format(now, sizeof(now)) == 0) {
+        printf("Clock not set.\n");
+    } else {
+        printf("Time:   %s\n", now);
+    }
+
+    clock_status_t st;
+    clock_service_get_status(&st);
+    if (st.source == CLOCK_SRC_NONE) {
+        printf("No sync since boot.\n");
+    } else {
+        printf("Source: %s, last sync %ld s ago\n", clock_source_name(st.source),
+               (long)(time(NULL) - st.last_sync));
+    }
+    printf("Syncs:  %lu SNTP, %lu HTTP (%lu HTTP failures)\n", (unsigned long)st.sntp_syncs,
+           (unsigned long)st.http_syncs, (unsigned long)st.http_failures);
+    printf("Drift:  last correction %ld ms, %ld ppm\n", (long)st.drift_ms, (long)st.drift_ppm);
+    return 0;
+}
+
 /* --- set_proxy command --- */
 static struct {
     struct arg_str *host;
@@ -318,18 +633,16 @@ static int cmd_skill_show(int argc, char **argv)
         return 1;
     }
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        printf("Skill not found: %s\n", path);
+    size_t len = 0;
+    char *text = file_cache_read_alloc(path, MIMI_FILE_CACHE_MAX_FILE, &len);
+    if (!text) {
+        printf(len ? "Skill too large: %s\n" : "Skill not found: %s\n", path);
         return 1;
     }
 
     printf("=== %s ===\n", path);
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        fputs(line, stdout);
-    }
-    fclose(f);
+    fputs(text, stdout);
+    free(text);
     printf("\n============\n");
     return 0;
 }
@@ -356,6 +669,48 @@ static bool contains_nocase(const char *text, const char *keyword)
     return false;
 }
 
+typedef struct {
+    const char *keyword;
+    int matches;
+} skill_search_ctx_t;
+
+static bool on_skill_search_file(const char *full_path, void *arg)
+{
+    skill_search_ctx_t *sc = arg;
+    const char *name = full_path + strlen(MIMI_SKILLS_PREFIX);
+    size_t path_len = strlen(full_path);
+    if (strlen(name) < 4 || strcmp(full_path + path_len - 3, ".md") != 0) return true;
+
+    bool file_matched = contains_nocase(name, sc->keyword);
+    int matched_line = 0;
+
+    size_t len = 0;
+    char *text = file_cache_read_alloc(full_path, MIMI_FILE_CACHE_MAX_FILE, &len);
+    if (!text) return true;
+
+    int line_no = 0;
+    for (char *line = text, *next; !file_matched && line && *line; line = next) {
+        next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        line_no++;
+        if (contains_nocase(line, sc->keyword)) {
+            file_matched = true;
+            matched_line = line_no;
+        }
+    }
+    free(text);
+
+    if (file_matched) {
+        sc->matches++;
+        if (matched_line > 0) {
+            printf("- %s (matched at line %d)\n", full_path, matched_line);
+        } else {
+            printf("- %s (matched in filename)\n", full_path);
+        }
+    }
+    return true;
+}
+
 static int cmd_skill_search(int argc, char **argv)
 {
     int nerrors = arg_parse(argc, argv, (void **)&skill_search_args);
@@ -364,61 +719,13 @@ static int cmd_skill_search(int argc, char **argv)
         return 1;
     }
 
-    const char *keyword = skill_search_args.keyword->sval[0];
-    DIR *dir = opendir("/spiffs");
-    if (!dir) {
-        printf("Cannot open /spiffs.\n");
-        return 1;
-    }
-
-    const char *prefix = "skills/";
-    const size_t prefix_len = strlen(prefix);
-    int matches = 0;
-
-    struct dirent *ent;
-    while ((ent = readdir(dir)) != NULL) {
-        const char *name = ent->d_name;
-        size_t name_len = strlen(name);
-
-        if (strncmp(name, prefix, prefix_len) != 0) continue;
-        if (name_len < prefix_len + 4) continue;
-        if (strcmp(name + name_len - 3, ".md") != 0) continue;
-
-        char full_path[296];
-        snprintf(full_path, sizeof(full_path), "/spiffs/%s", name);
-
-        bool file_matched = contains_nocase(name, keyword);
-        int matched_line = 0;
-
-        FILE *f = fopen(full_path, "r");
-        if (!f) continue;
-
-        char line[256];
-        int line_no = 0;
-        while (!file_matched && fgets(line, sizeof(line), f)) {
-            line_no++;
-            if (contains_nocase(line, keyword)) {
-                file_matched = true;
-                matched_line = line_no;
-            }
-        }
-        fclose(f);
-
-        if (file_matched) {
-            matches++;
-            if (matched_line > 0) {
-                printf("- %s (matched at line %d)\n", full_path, matched_line);
-            } else {
-                printf("- %s (matched in filename)\n", full_path);
-            }
-        }
-    }
+    skill_search_ctx_t sc = { .keyword = skill_search_args.keyword->sval[0], .matches = 0 };
+    fs_list(MIMI_SKILLS_PREFIX, on_skill_search_file, &sc);
 
-    closedir(dir);
-    if (matches == 0) {
-        printf("No skills matched keyword: %s\n", keyword);
+    if (sc.matches == 0) {
+        printf("No skills matched keyword: %s\n", sc.keyword);
     } else {
-        printf("Total matches: %d\n", matches);
+        printf("Total matches: %d\n", sc.matches);
     }
     return 0;
 }
@@ -541,6 +848,7 @@ static int cmd_tool_exec(int argc, char **argv)
 static int cmd_restart(int argc, char **argv)
 {
     printf("Restarting...\n");
+    fs_writer_flush(NULL);
     esp_restart();
     return 0;  /* unreachable */
 }
@@ -691,6 +999,30 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&mem_write_cmd);
 
+    /* memory_facts */
+    esp_console_cmd_t facts_cmd = {
+        .command = "memory_facts",
+        .help = "List key-value facts",
+        .func = &cmd_memory_facts,
+    };
+    esp_console_cmd_register(&facts_cmd);
+
+    /* memory_rollup */
+    esp_console_cmd_t rollup_cmd = {
+        .command = "memory_rollup",
+        .help = "Merge old daily notes into weekly/monthly digests now",
+        .func = &cmd_memory_rollup,
+    };
+    esp_console_cmd_register(&rollup_cmd);
+
+    /* memory_dedup */
+    esp_console_cmd_t dedup_cmd = {
+        .command = "memory_dedup",
+        .help = "Remove near-duplicate entries from the memory files",
+        .func = &cmd_memory_dedup,
+    };
+    esp_console_cmd_register(&dedup_cmd);
+
     /* session_list */
     esp_console_cmd_t sess_list_cmd = {
         .command = "session_list",
@@ -710,6 +1042,52 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&sess_clear_cmd);
 
+    /* session_cache */
+    esp_console_cmd_t sess_cache_cmd = {
+        .command = "session_cache",
+        .help = "Show session history cache stats",
+        .func = &cmd_session_cache,
+    };
+    esp_console_cmd_register(&sess_cache_cmd);
+
+    /* storage_stats */
+    esp_console_cmd_t storage_cmd = {
+        .command = "storage_stats",
+        .help = "Show storage usage, quotas, evictions, idle GC and write stalls",
+        .func = &cmd_storage_stats,
+    };
+    esp_console_cmd_register(&storage_cmd);
+
+    /* fs_check */
+    fs_check_args.repair = arg_lit0("r", "repair", "Rebuild the catalog if it differs");
+    fs_check_args.end = arg_end(1);
+    esp_console_cmd_t fs_check_cmd = {
+        .command = "fs_check",
+        .help = "Compare the in-RAM file catalog with the filesystem",
+        .func = &cmd_fs_check,
+        .argtable = &fs_check_args,
+    };
+    esp_console_cmd_register(&fs_check_cmd);
+
+    /* fs_bench */
+    fs_bench_args.files = arg_int0("n", "files", "<n>", "Files per op (default 32)");
+    fs_bench_args.end = arg_end(1);
+    esp_console_cmd_t fs_bench_cmd = {
+        .command = "fs_bench",
+        .help = "Time create, open, append, rewrite and listing on the filesystem",
+        .func = &cmd_fs_bench,
+        .argtable = &fs_bench_args,
+    };
+    esp_console_cmd_register(&fs_bench_cmd);
+
+    /* search_stats */
+    esp_console_cmd_t search_cmd = {
+        .command = "search_stats",
+        .help = "Show full-text search index stats",
+        .func = &cmd_search_stats,
+    };
+    esp_console_cmd_register(&search_cmd);
+
     /* heap_info */
     esp_console_cmd_t heap_cmd = {
         .command = "heap_info",
@@ -718,6 +1096,14 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&heap_cmd);
 
+    /* clock_status */
+    esp_console_cmd_t clock_cmd = {
+        .command = "clock_status",
+        .help = "Show the time, its sync source and measured drift",
+        .func = &cmd_clock_status,
+    };
+    esp_console_cmd_register(&clock_cmd);
+
     /* set_search_key */
     search_key_args.key = arg_str1(NULL, NULL, "<key>", "Brave Search API key");
     search_key_args.end = arg_end(1);
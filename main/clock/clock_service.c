@@ -0,0 +1,305 @@
+#include "clock/clock_service.h"
+#include "mimi_config.h"
+#include "proxy/http_proxy.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+
+static const char *TAG = "clock";
+
+#define CLOCK_MIN_YEAR   2024   /* Anything earlier means never set */
+
+static SemaphoreHandle_t s_lock = NULL;
+static clock_status_t s_status = {0};
+static int64_t s_sync_wall_us = 0;      /* Server time at the last sync */
+static int64_t s_sync_mono_us = 0;      /* esp_timer at the last sync */
+static int64_t s_sntp_started_us = 0;   /* 0 until clock_service_start() */
+static int64_t s_http_next_us = 0;      /* Earliest next HTTP fallback */
+
+static const char *const s_source_names[] = { "none", "sntp", "http" };
+
+static void lock(void)
+{
+    if (s_lock) xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    if (s_lock) xSemaphoreGive(s_lock);
+}
+
+/* ── Sync bookkeeping ───────────────────────────────────────── */
+
+/*
+ * Record a sync to server time tv. Between syncs the system clock runs
+ * off the same timer as esp_timer, so the gap between tv and the last
+ * sync plus elapsed esp_timer time is the local clock's drift.
+ */
+static void note_sync(clock_source_t src, const struct timeval *tv)
+{
+    int64_t mono = esp_timer_get_time();
+    int64_t wall = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+    lock();
+    if (s_sync_mono_us) {
+        int64_t elapsed = mono - s_sync_mono_us;
+        int64_t drift = wall - (s_sync_wall_us + elapsed);
+        s_status.drift_ms = (int32_t)(drift / 1000);
+        /* Whole-second HTTP dates say nothing useful about ppm */
+        if (src == CLOCK_SRC_SNTP && s_status.source == CLOCK_SRC_SNTP && elapsed > 60 * 1000000LL) {
+            s_status.drift_ppm = (int32_t)(drift * 1000000 / elapsed);
+        }
+    }
+    s_sync_wall_us = wall;
+    s_sync_mono_us = mono;
+    s_status.source = src;
+    s_status.last_sync = tv->tv_sec;
+    if (src == CLOCK_SRC_SNTP) {
+        s_status.sntp_syncs++;
+    } else {
+        s_status.http_syncs++;
+    }
+    int32_t drift_ms = s_status.drift_ms;
+    unlock();
+
+    ESP_LOGI(TAG, "Clock synced via %s (corrected %ld ms)", clock_source_name(src), (long)drift_ms);
+}
+
+static void on_sntp_sync(struct timeval *tv)
+{
+    note_sync(CLOCK_SRC_SNTP, tv);
+}
+
+/* ── HTTP Date fallback ─────────────────────────────────────── */
+
+static const char *MONTHS[] = {
+    "Jan","Feb","Mar","Apr","May","Jun",
+    "Jul","Aug","Sep","Oct","Nov","Dec"
+};
+
+/* Parse "Sat, 01 Feb 2025 10:25:00 GMT" as UTC */
+static bool parse_http_date(const char *date_str, time_t *out)
+{
+    int day, year, hour, min, sec;
+    char mon_str[4] = {0};
+
+    if (sscanf(date_str, "%*[^,], %d %3s %d %d:%d:%d",
+               &day, mon_str, &year, &hour, &min, &sec) != 6) {
+        return false;
+    }
+
+    int mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(mon_str, MONTHS[i]) == 0) { mon = i; break; }
+    }
+    if (mon < 0) return false;
+
+    struct tm tm = {
+        .tm_sec = sec, .tm_min = min, .tm_hour = hour,
+        .tm_mday = day, .tm_mon = mon, .tm_year = year - 1900,
+    };
+
+    /* Convert UTC to epoch — mktime expects local, so temporarily set UTC */
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    time_t t = mktime(&tm);
+
+    /* Restore timezone */
+    setenv("TZ", MIMI_TIMEZONE, 1);
+    tzset();
+
+    if (t < 0) return false;
+    *out = t;
+    return true;
+}
+
+/* HEAD request to api.telegram.org through the proxy, parse the Date header */
+static esp_err_t fetch_date_via_proxy(time_t *out)
+{
+    proxy_conn_t *conn = proxy_conn_open("api.telegram.org", 443, 10000);
+    if (!conn) return ESP_ERR_HTTP_CONNECT;
+
+    const char *req =
+        "HEAD / HTTP/1.1\r\n"
+        "Host: api.telegram.org\r\n"
+        "Connection: close\r\n\r\n";
+
+    if (proxy_conn_write(conn, req, strlen(req)) < 0) {
+        proxy_conn_close(conn);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+
+    char buf[1024];
+    int total = 0;
+    buf[0] = '\0';
+    while (total < (int)sizeof(buf) - 1) {
+        int n = proxy_conn_read(conn, buf + total, sizeof(buf) - 1 - total, 10000);
+        if (n <= 0) break;
+        total += n;
+        buf[total] = '\0';
+        if (strstr(buf, "\r\n\r\n")) break;
+    }
+    proxy_conn_close(conn);
+
+    /* Find Date header */
+    char *date_hdr = strcasestr(buf, "\r\nDate: ");
+    if (!date_hdr) return ESP_ERR_NOT_FOUND;
+    date_hdr += 8;
+
+    char *eol = strstr(date_hdr, "\r\n");
+    if (!eol) return ESP_ERR_NOT_FOUND;
+
+    char date_val[64];
+    size_t dlen = eol - date_hdr;
+    if (dlen >= sizeof(date_val)) return ESP_ERR_NOT_FOUND;
+    memcpy(date_val, date_hdr, dlen);
+    date_val[dlen] = '\0';
+
+    return parse_http_date(date_val, out) ? ESP_OK : ESP_FAIL;
+}
+
+/* Same over direct HTTPS */
+static esp_err_t fetch_date_direct(time_t *out)
+{
+    esp_http_client_config_t config = {
+        .url = "https://api.telegram.org/",
+        .method = HTTP_METHOD_HEAD,
+        .timeout_ms = 10000,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return ESP_FAIL;
+
+    esp_err_t err = esp_http_client_perform(client);
+    if (err != ESP_OK) {
+        esp_http_client_cleanup(client);
+        return err;
+    }
+
+    /* Returns a pointer into the client, valid until cleanup */
+    char *date_ptr = NULL;
+    esp_http_client_get_header(client, "Date", &date_ptr);
+    bool ok = date_ptr && date_ptr[0] && parse_http_date(date_ptr, out);
+    esp_http_client_cleanup(client);
+    return ok ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t sync_via_http(void)
+{
+    time_t t = 0;
+    esp_err_t err = http_proxy_is_enabled() ? fetch_date_via_proxy(&t) : fetch_date_direct(&t);
+    if (err != ESP_OK) {
+        lock();
+        s_status.http_failures++;
+        unlock();
+        ESP_LOGW(TAG, "HTTP time fallback failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    struct timeval tv = { .tv_sec = t };
+    settimeofday(&tv, NULL);
+    note_sync(CLOCK_SRC_HTTP, &tv);
+    return ESP_OK;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t clock_service_init(void)
+{
+    setenv("TZ", MIMI_TIMEZONE, 1);
+    tzset();
+
+    if (!s_lock) s_lock = xSemaphoreCreateMutex();
+    return s_lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t clock_service_start(void)
+{
+    if (s_sntp_started_us) return ESP_OK;
+
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG_MULTIPLE(2,
+                                   ESP_SNTP_SERVER_LIST(MIMI_CLOCK_SNTP_SERVER1,
+                                                        MIMI_CLOCK_SNTP_SERVER2));
+    config.sync_cb = on_sntp_sync;
+    esp_err_t err = esp_netif_sntp_init(&config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SNTP init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    esp_sntp_set_sync_interval(MIMI_CLOCK_SYNC_INTERVAL_MS);
+    s_sntp_started_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "SNTP started (%s, %s), re-sync every %d min", MIMI_CLOCK_SNTP_SERVER1,
+             MIMI_CLOCK_SNTP_SERVER2, MIMI_CLOCK_SYNC_INTERVAL_MS / 60000);
+    return ESP_OK;
+}
+
+bool clock_service_is_set(void)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    return tm.tm_year + 1900 >= CLOCK_MIN_YEAR;
+}
+
+esp_err_t clock_service_ensure(void)
+{
+    int64_t now = esp_timer_get_time();
+    lock();
+    int64_t last = s_sync_mono_us;
+    bool due = now >= s_http_next_us;
+    unlock();
+
+    /* Fresh enough: SNTP missed at most one re-sync */
+    if (last && now - last < 2LL * MIMI_CLOCK_SYNC_INTERVAL_MS * 1000) return ESP_OK;
+
+    /* Right after boot, give SNTP a moment before trying HTTP */
+    if (!last && s_sntp_started_us) {
+        int64_t waited_ms = (now - s_sntp_started_us) / 1000;
+        if (waited_ms < MIMI_CLOCK_SNTP_WAIT_MS &&
+            esp_netif_sntp_sync_wait(pdMS_TO_TICKS(MIMI_CLOCK_SNTP_WAIT_MS - waited_ms)) == ESP_OK) {
+            return ESP_OK;
+        }
+    }
+
+    if (!due) return clock_service_is_set() ? ESP_OK : ESP_ERR_INVALID_STATE;
+
+    lock();
+    s_http_next_us = now + (int64_t)MIMI_CLOCK_HTTP_RETRY_MS * 1000;
+    unlock();
+    esp_err_t err = sync_via_http();
+    if (err != ESP_OK && clock_service_is_set()) return ESP_OK;     /* Stale but usable */
+    return err;
+}
+
+size_t clock_service_format(char *buf, size_t size)
+{
+    buf[0] = '\0';
+    if (!clock_service_is_set()) return 0;
+
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    return strftime(buf, size, "%Y-%m-%d %H:%M:%S %Z (%A)", &local);
+}
+
+void clock_service_get_status(clock_status_t *out)
+{
+    lock();
+    *out = s_status;
+    unlock();
+}
+
+const char *clock_source_name(clock_source_t src)
+{
+    return src <= CLOCK_SRC_HTTP ? s_source_names[src] : "?";
+}
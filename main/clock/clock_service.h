@@ -0,0 +1,59 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Wall clock for the agent, cron, rollups and session archiving.
+ *
+ * SNTP sets the clock once WiFi is up and re-syncs every
+ * MIMI_CLOCK_SYNC_INTERVAL_MS from the lwIP thread. Where UDP port 123 is
+ * blocked (typically the networks that need the HTTP proxy),
+ * clock_service_ensure() falls back to the Date header of an HTTPS HEAD
+ * request to api.telegram.org. Reading the time never touches the network.
+ */
+
+typedef enum {
+    CLOCK_SRC_NONE = 0,
+    CLOCK_SRC_SNTP,
+    CLOCK_SRC_HTTP,
+} clock_source_t;
+
+typedef struct {
+    clock_source_t source;      /* Of the last successful sync */
+    time_t last_sync;           /* Wall time of the last sync, 0 if never */
+    uint32_t sntp_syncs;
+    uint32_t http_syncs;
+    uint32_t http_failures;
+    int32_t drift_ms;           /* Correction made by the last sync */
+    int32_t drift_ppm;          /* Local clock error over the last sync interval */
+} clock_status_t;
+
+/** Apply MIMI_TIMEZONE. Called early in app_main. */
+esp_err_t clock_service_init(void);
+
+/** Start SNTP. Call once WiFi is connected. */
+esp_err_t clock_service_start(void);
+
+/** True once any sync has set the clock. */
+bool clock_service_is_set(void);
+
+/**
+ * Make sure the clock is set and not stale. Waits briefly for SNTP after
+ * boot, then falls back to HTTP at most once per MIMI_CLOCK_HTTP_RETRY_MS.
+ * Needs a task stack large enough for TLS. Cheap when the clock is fresh.
+ */
+esp_err_t clock_service_ensure(void);
+
+/**
+ * Local time as "2026-02-05 14:03:22 PST (Thursday)".
+ * @return length written, or 0 (buf = "") when the clock is not set
+ */
+size_t clock_service_format(char *buf, size_t size);
+
+void clock_service_get_status(clock_status_t *out);
+
+const char *clock_source_name(clock_source_t src);
@@ -1,6 +1,8 @@
 #include "cron/cron_service.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
+#include "storage/file_cache.h"
+#include "storage/fs_writer.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -60,35 +62,21 @@ static void cron_generate_id(char *id_buf)
 
 static esp_err_t cron_load_jobs(void)
 {
-    FILE *f = fopen(MIMI_CRON_FILE, "r");
-    if (!f) {
+    size_t fsize = 0;
+    char *buf = file_cache_read_alloc(MIMI_CRON_FILE, 8192, &fsize);
+    if (!buf && fsize == 0) {
         ESP_LOGI(TAG, "No cron file found, starting fresh");
         s_job_count = 0;
         return ESP_OK;
     }
 
-    /* Read entire file */
-    fseek(f, 0, SEEK_END);
-    long fsize = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (fsize <= 0 || fsize > 8192) {
-        ESP_LOGW(TAG, "Cron file invalid size: %ld", fsize);
-        fclose(f);
+    if (!buf || fsize == 0) {
+        ESP_LOGW(TAG, "Cron file invalid size: %u", (unsigned)fsize);
+        free(buf);
         s_job_count = 0;
         return ESP_OK;
     }
 
-    char *buf = malloc(fsize + 1);
-    if (!buf) {
-        fclose(f);
-        return ESP_ERR_NO_MEM;
-    }
-
-    size_t n = fread(buf, 1, fsize, f);
-    buf[n] = '\0';
-    fclose(f);
-
     /* Parse JSON */
     cJSON *root = cJSON_Parse(buf);
     free(buf);
@@ -215,21 +203,12 @@ static esp_err_t cron_save_jobs(void)
         return ESP_ERR_NO_MEM;
     }
 
-    FILE *f = fopen(MIMI_CRON_FILE, "w");
-    if (!f) {
-        ESP_LOGE(TAG, "Failed to open %s for writing", MIMI_CRON_FILE);
-        free(json_str);
-        return ESP_FAIL;
-    }
-
-    size_t len = strlen(json_str);
-    size_t written = fwrite(json_str, 1, len, f);
-    fclose(f);
+    /* A run updates every due job: coalesce the burst into one write */
+    esp_err_t err = fs_write_coalesced(MIMI_CRON_FILE, json_str, strlen(json_str), FS_WRITER_CRON);
     free(json_str);
-
-    if (written != len) {
-        ESP_LOGE(TAG, "Cron save incomplete: %d/%d bytes", (int)written, (int)len);
-        return ESP_FAIL;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save %s", MIMI_CRON_FILE);
+        return err;
     }
 
     ESP_LOGI(TAG, "Saved %d cron jobs to %s", s_job_count, MIMI_CRON_FILE);
@@ -1,8 +1,10 @@
 #include "heartbeat/heartbeat.h"
 #include "mimi_config.h"
 #include "bus/message_bus.h"
+#include "storage/file_cache.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
@@ -29,15 +31,18 @@ static TimerHandle_t s_heartbeat_timer = NULL;
  */
 static bool heartbeat_has_tasks(void)
 {
-    FILE *f = fopen(MIMI_HEARTBEAT_FILE, "r");
-    if (!f) {
+    size_t len = 0;
+    char *text = file_cache_read_alloc(MIMI_HEARTBEAT_FILE, MIMI_FILE_CACHE_MAX_FILE, &len);
+    if (!text) {
         return false;
     }
 
-    char line[256];
     bool found_task = false;
 
-    while (fgets(line, sizeof(line), f)) {
+    for (char *line = text, *next; line && *line; line = next) {
+        next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+
         /* Skip leading whitespace */
         const char *p = line;
         while (*p && isspace((unsigned char)*p)) {
@@ -67,7 +72,7 @@ static bool heartbeat_has_tasks(void)
         break;
     }
 
-    fclose(f);
+    free(text);
     return found_task;
 }
 
@@ -523,15 +523,25 @@ static cJSON *convert_messages_openai(const char *system_prompt, cJSON *messages
 
 esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
                    char *response_buf, size_t buf_size)
+{
+    return llm_chat_model(NULL, system_prompt, messages_json, response_buf, buf_size);
+}
+
+esp_err_t llm_chat_model(const char *model, const char *system_prompt,
+                         const char *messages_json, char *response_buf, size_t buf_size)
 {
     if (s_api_key[0] == '\0') {
         snprintf(response_buf, buf_size, "Error: No API key configured");
         return ESP_ERR_INVALID_STATE;
     }
 
+    if (!model || model[0] == '\0') {
+        model = s_model;
+    }
+
     /* Build request body (non-streaming) */
     cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "model", s_model);
+    cJSON_AddStringToObject(body, "model", model);
     if (provider_is_openai()) {
         cJSON_AddNumberToObject(body, "max_completion_tokens", MIMI_LLM_MAX_TOKENS);
     } else {
@@ -573,7 +583,7 @@ esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
     }
 
     ESP_LOGI(TAG, "Calling LLM API (provider: %s, model: %s, body: %d bytes)",
-             s_provider, s_model, (int)strlen(post_data));
+             s_provider, model, (int)strlen(post_data));
     llm_log_payload("LLM request", post_data);
 
     resp_buf_t rb;
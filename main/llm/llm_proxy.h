@@ -39,6 +39,14 @@ esp_err_t llm_set_model(const char *model);
 esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
                    char *response_buf, size_t buf_size);
 
+/**
+ * Same as llm_chat(), but with an explicit model for this request only.
+ * Pass NULL or "" to use the configured model. Useful for cheap background
+ * jobs (e.g. session summarization) that do not need the main model.
+ */
+esp_err_t llm_chat_model(const char *model, const char *system_prompt,
+                         const char *messages_json, char *response_buf, size_t buf_size);
+
 /* ── Tool Use Support ──────────────────────────────────────────── */
 
 typedef struct {
@@ -0,0 +1,466 @@
+#include "memory/memory_dedup.h"
+#include "memory/memory_rank.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/fs_writer.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "mem_dedup";
+
+#define DEDUP_MAX_FILES     64
+#define DEDUP_PATH_MAX      48
+#define DEDUP_FILE_MAX      (32 * 1024)
+#define DEDUP_SPAN_MAX      512         /* Entries checked per write */
+
+typedef struct {
+    uint64_t fp;
+    uint16_t file;              /* Slot in s_files */
+    uint16_t line;
+    uint16_t len;
+    uint8_t tokens;
+} fp_entry_t;
+
+typedef struct {
+    char path[DEDUP_PATH_MAX];  /* "" = free slot */
+    bool long_term;             /* MEMORY.md */
+} fp_file_t;
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+    uint64_t fp;
+    uint16_t line;
+    uint8_t tokens;
+    bool drop;
+    bool existing;              /* Already in the file being replaced */
+} span_t;
+
+static fp_file_t *s_files = NULL;
+static fp_entry_t *s_entries = NULL;
+static int s_count = 0;
+static SemaphoreHandle_t s_lock = NULL;
+
+/* ── Matching ───────────────────────────────────────────────── */
+
+/* SimHash itself is in memory_simhash.c */
+static bool is_near(uint64_t a, int a_tokens, uint64_t b, int b_tokens)
+{
+    if (a_tokens == 0 || b_tokens == 0) return false;
+    int dist = __builtin_popcountll(a ^ b);
+    if (a_tokens < MIMI_DEDUP_MIN_TOKENS || b_tokens < MIMI_DEDUP_MIN_TOKENS) {
+        return dist == 0 && a_tokens == b_tokens;
+    }
+    return dist <= MIMI_DEDUP_HAMMING;
+}
+
+/* ── Fingerprint table ──────────────────────────────────────── */
+
+static bool is_tracked(const char *path)
+{
+    size_t plen = strlen(MIMI_SPIFFS_MEMORY_DIR "/");
+    size_t len = strlen(path);
+    return strncmp(path, MIMI_SPIFFS_MEMORY_DIR "/", plen) == 0 && len < DEDUP_PATH_MAX &&
+           len > plen + 3 && strcmp(path + len - 3, ".md") == 0;
+}
+
+static int file_find(const char *path)
+{
+    for (int i = 0; i < DEDUP_MAX_FILES; i++) {
+        if (strcmp(s_files[i].path, path) == 0) return i;
+    }
+    return -1;
+}
+
+/* Caller holds s_lock. Drops the file's fingerprints and frees its slot. */
+static void file_forget(int id)
+{
+    int out = 0;
+    for (int i = 0; i < s_count; i++) {
+        if (s_entries[i].file != id) s_entries[out++] = s_entries[i];
+    }
+    s_count = out;
+    s_files[id].path[0] = '\0';
+}
+
+typedef struct {
+    const char *base;
+    span_t *spans;
+    int count;
+} span_ctx_t;
+
+static bool on_entry(const char *text, size_t len, const char *heading,
+                     size_t heading_len, int line, void *arg)
+{
+    span_ctx_t *sc = arg;
+    if (sc->count >= DEDUP_SPAN_MAX) return false;
+
+    span_t *s = &sc->spans[sc->count++];
+    int tokens;
+    s->off = (uint32_t)(text - sc->base);
+    s->len = (uint32_t)len;
+    s->fp = memory_simhash(text, len, &tokens);
+    s->tokens = tokens > UINT8_MAX ? UINT8_MAX : (uint8_t)tokens;
+    s->line = line > UINT16_MAX ? UINT16_MAX : (uint16_t)line;
+    s->drop = false;
+    s->existing = false;
+    return true;
+}
+
+static int split_spans(const char *text, span_t *spans)
+{
+    span_ctx_t sc = { .base = text, .spans = spans, .count = 0 };
+    memory_split_entries(text, on_entry, &sc);
+    return sc.count;
+}
+
+static char *read_file(const char *path, size_t *len)
+{
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size > DEDUP_FILE_MAX) return NULL;
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    char *buf = heap_caps_malloc(st.st_size + 1, MALLOC_CAP_SPIRAM);
+    if (!buf) {
+        fclose(f);
+        return NULL;
+    }
+    *len = fread(buf, 1, st.st_size, f);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+/* Caller holds s_lock. Fingerprint spans (already split from path) into the table. */
+static void file_add_spans(const char *path, const span_t *spans, int n)
+{
+    int id = file_find(path);
+    if (id >= 0) file_forget(id);
+    for (id = 0; id < DEDUP_MAX_FILES && s_files[id].path[0]; id++) {}
+    if (id == DEDUP_MAX_FILES) {
+        ESP_LOGW(TAG, "Too many memory files, skipping %s", path);
+        return;
+    }
+    strcpy(s_files[id].path, path);
+    s_files[id].long_term = strcmp(path, MIMI_MEMORY_FILE) == 0;
+
+    for (int i = 0; i < n; i++) {
+        if (spans[i].drop || spans[i].tokens == 0) continue;
+        if (s_count >= MIMI_DEDUP_MAX_ENTRIES) {
+            ESP_LOGW(TAG, "Fingerprint table full");
+            return;
+        }
+        fp_entry_t *e = &s_entries[s_count++];
+        e->fp = spans[i].fp;
+        e->file = (uint16_t)id;
+        e->line = spans[i].line;
+        e->len = spans[i].len > UINT16_MAX ? UINT16_MAX : (uint16_t)spans[i].len;
+        e->tokens = spans[i].tokens;
+    }
+}
+
+/* Caller holds s_lock. */
+static void file_reindex(const char *path)
+{
+    size_t len = 0;
+    char *buf = read_file(path, &len);
+    span_t *spans = heap_caps_malloc(DEDUP_SPAN_MAX * sizeof(span_t), MALLOC_CAP_SPIRAM);
+    if (!buf || !spans) {
+        int id = file_find(path);
+        if (id >= 0) file_forget(id);
+        free(buf);
+        free(spans);
+        return;
+    }
+    file_add_spans(path, spans, split_spans(buf, spans));
+    free(spans);
+    free(buf);
+}
+
+static void on_storage_event(storage_evt_t evt, const char *path)
+{
+    if (evt == STORAGE_EVT_MAINTENANCE || !path || !is_tracked(path)) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (evt == STORAGE_EVT_CHANGED) {
+        file_reindex(path);
+    } else {
+        int id = file_find(path);
+        if (id >= 0) file_forget(id);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/* ── Filtering ──────────────────────────────────────────────── */
+
+static void note_duplicate(memory_dedup_report_t *rep, const char *text, const span_t *s,
+                           const char *other_path, int other_line)
+{
+    rep->duplicates++;
+    if (rep->detail[0]) return;
+
+    const char *name = strrchr(other_path, '/');
+    name = name ? name + 1 : other_path;
+    int shown = s->len > 40 ? 40 : (int)s->len;
+    snprintf(rep->detail, sizeof(rep->detail), "'%.*s%s' ~ %s:%d",
+             shown, text + s->off, s->len > 40 ? "..." : "", name, other_line);
+}
+
+/* Caller holds s_lock. True if the file in slot self already has this exact entry. */
+static bool in_file(int self, const span_t *s)
+{
+    for (int k = 0; self >= 0 && k < s_count; k++) {
+        const fp_entry_t *e = &s_entries[k];
+        if (e->file == self && e->fp == s->fp && e->len == s->len && e->tokens == s->tokens) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Mark near-duplicates in spans. Caller holds s_lock. Each span is compared
+ * with the kept spans before it, then with the table (skipping the file's
+ * own slot when it is being replaced, and everything but MEMORY.md's own
+ * entries when the target is MEMORY.md). When a file is replaced, entries
+ * it already had are left as they are: only what the call adds is checked
+ * or dropped.
+ */
+static void mark_duplicates(const char *path, bool whole_file, const char *text,
+                            span_t *spans, int n, bool drop, memory_dedup_report_t *rep)
+{
+    int self = file_find(path);
+    bool long_term = strcmp(path, MIMI_MEMORY_FILE) == 0;
+
+    for (int i = 0; i < n && whole_file; i++) {
+        spans[i].existing = in_file(self, &spans[i]);
+    }
+
+    for (int i = 0; i < n; i++) {
+        span_t *s = &spans[i];
+        if (s->existing) continue;
+        rep->entries++;
+        if (s->tokens == 0) continue;
+
+        bool found = false;
+        for (int j = 0; j < n && !found; j++) {
+            span_t *o = &spans[j];
+            if (j == i || (j > i && !o->existing)) continue;
+            if (o->drop || !is_near(s->fp, s->tokens, o->fp, o->tokens)) continue;
+            found = true;
+            note_duplicate(rep, text, s, path, o->line);
+            if (!drop) break;
+            /* Keep whichever copy says more, and never one already saved */
+            if (s->len > o->len && !o->existing) {
+                o->drop = true;
+            } else {
+                s->drop = true;
+            }
+            rep->dropped++;
+        }
+
+        for (int k = 0; k < s_count && !found; k++) {
+            const fp_entry_t *e = &s_entries[k];
+            if (whole_file && e->file == self) continue;
+            if (long_term && !s_files[e->file].long_term) continue;
+            if (!is_near(s->fp, s->tokens, e->fp, e->tokens)) continue;
+            found = true;
+            note_duplicate(rep, text, s, s_files[e->file].path, e->line);
+            if (drop && s->len <= e->len) {
+                s->drop = true;
+                rep->dropped++;
+            }
+        }
+    }
+}
+
+/* Remove dropped spans (and their line breaks) from text in place. */
+static size_t compact(char *text, size_t len, const span_t *spans, int n)
+{
+    size_t out = 0, in = 0;
+    for (int i = 0; i < n; i++) {
+        if (!spans[i].drop) continue;
+        size_t start = spans[i].off;
+        size_t end = start + spans[i].len;
+        if (end < len && text[end] == '\n') end++;
+        memmove(text + out, text + in, start - in);
+        out += start - in;
+        in = end;
+    }
+    memmove(text + out, text + in, len - in);
+    out += len - in;
+    text[out] = '\0';
+    return out;
+}
+
+size_t memory_dedup_filter(const char *path, bool whole_file, char *text, size_t len,
+                           memory_dedup_report_t *rep)
+{
+    memset(rep, 0, sizeof(*rep));
+    if (MIMI_DEDUP_MODE == 0 || !s_entries || !path || !is_tracked(path)) return len;
+
+    span_t *spans = heap_caps_malloc(DEDUP_SPAN_MAX * sizeof(span_t), MALLOC_CAP_SPIRAM);
+    if (!spans) return len;
+
+    int n = split_spans(text, spans);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    mark_duplicates(path, whole_file, text, spans, n, MIMI_DEDUP_MODE == 2, rep);
+    xSemaphoreGive(s_lock);
+
+    if (rep->dropped) len = compact(text, len, spans, n);
+    free(spans);
+
+    if (rep->duplicates) {
+        ESP_LOGI(TAG, "%s: %d near-duplicate(s), %d dropped (%s)",
+                 path, rep->duplicates, rep->dropped, rep->detail);
+    }
+    return len;
+}
+
+/* ── Cleaning ───────────────────────────────────────────────── */
+
+/* MEMORY.md, then monthly and weekly digests, then daily notes by date */
+static int clean_rank(const char *path)
+{
+    const char *name = strrchr(path, '/') + 1;
+    if (strcmp(path, MIMI_MEMORY_FILE) == 0) return 0;
+    if (strncmp(name, "month-", 6) == 0) return 1;
+    if (strncmp(name, "week-", 5) == 0) return 2;
+    return 3;
+}
+
+static int cmp_clean_order(const void *a, const void *b)
+{
+    const char *pa = a, *pb = b;
+    int ra = clean_rank(pa), rb = clean_rank(pb);
+    if (ra != rb) return ra - rb;
+    return strcmp(pa, pb);
+}
+
+typedef struct {
+    char (*paths)[DEDUP_PATH_MAX];
+    int count;
+    int max;
+} list_ctx_t;
+
+static bool on_list_file(const char *path, void *arg)
+{
+    list_ctx_t *lc = arg;
+    if (is_tracked(path)) strcpy(lc->paths[lc->count++], path);
+    return lc->count < lc->max;
+}
+
+/* Full paths of the memory files, in no particular order */
+static int list_files(char (*paths)[DEDUP_PATH_MAX], int max)
+{
+    list_ctx_t lc = { .paths = paths, .count = 0, .max = max };
+    fs_list(MIMI_SPIFFS_MEMORY_DIR "/", on_list_file, &lc);
+    return lc.count;
+}
+
+esp_err_t memory_dedup_clean(memory_dedup_report_t *rep, int *files_changed)
+{
+    memset(rep, 0, sizeof(*rep));
+    *files_changed = 0;
+    if (!s_entries) return ESP_ERR_INVALID_STATE;
+
+    char (*paths)[DEDUP_PATH_MAX] = heap_caps_calloc(DEDUP_MAX_FILES, DEDUP_PATH_MAX, MALLOC_CAP_SPIRAM);
+    span_t *spans = heap_caps_malloc(DEDUP_SPAN_MAX * sizeof(span_t), MALLOC_CAP_SPIRAM);
+    if (!paths || !spans) {
+        free(paths);
+        free(spans);
+        return ESP_ERR_NO_MEM;
+    }
+    fs_writer_flush(NULL);     /* Files are read and rewritten in place below */
+    int n = list_files(paths, DEDUP_MAX_FILES);
+    if (n) qsort(paths, n, DEDUP_PATH_MAX, cmp_clean_order);
+
+    /* Rebuild the table file by file, so each file is checked only against
+       the entries kept so far */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memset(s_files, 0, DEDUP_MAX_FILES * sizeof(fp_file_t));
+    s_count = 0;
+
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < n; i++) {
+        size_t len = 0;
+        char *buf = read_file(paths[i], &len);
+        if (!buf) continue;
+
+        memory_dedup_report_t file_rep = {0};
+        int count = split_spans(buf, spans);
+        mark_duplicates(paths[i], true, buf, spans, count, true, &file_rep);
+        file_add_spans(paths[i], spans, count);
+
+        rep->entries += file_rep.entries;
+        rep->duplicates += file_rep.duplicates;
+        rep->dropped += file_rep.dropped;
+        if (!rep->detail[0]) strcpy(rep->detail, file_rep.detail);
+
+        if (file_rep.dropped) {
+            len = compact(buf, len, spans, count);
+            /* Outside the lock: the write notifies our own listener, which
+               re-reads the file */
+            xSemaphoreGive(s_lock);
+            if (fs_write_atomic(paths[i], buf, len, FS_WRITER_TOOLS) != ESP_OK) {
+                ESP_LOGE(TAG, "Cannot rewrite %s", paths[i]);
+                err = ESP_FAIL;
+            } else {
+                (*files_changed)++;
+            }
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+        }
+        free(buf);
+    }
+    xSemaphoreGive(s_lock);
+    free(spans);
+    free(paths);
+
+    ESP_LOGI(TAG, "Dedup pass: %d entries, %d near-duplicates, %d dropped from %d file(s)",
+             rep->entries, rep->duplicates, rep->dropped, *files_changed);
+    return err;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t memory_dedup_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    s_files = heap_caps_calloc(DEDUP_MAX_FILES, sizeof(fp_file_t), MALLOC_CAP_SPIRAM);
+    s_entries = heap_caps_calloc(MIMI_DEDUP_MAX_ENTRIES, sizeof(fp_entry_t), MALLOC_CAP_SPIRAM);
+    char (*paths)[DEDUP_PATH_MAX] = heap_caps_calloc(DEDUP_MAX_FILES, DEDUP_PATH_MAX, MALLOC_CAP_SPIRAM);
+    if (!s_lock || !s_files || !s_entries || !paths) {
+        ESP_LOGE(TAG, "Failed to allocate fingerprint table");
+        free(s_files);
+        free(s_entries);
+        free(paths);
+        s_files = NULL;
+        s_entries = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    int n = list_files(paths, DEDUP_MAX_FILES);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < n; i++) {
+        file_reindex(paths[i]);
+    }
+    xSemaphoreGive(s_lock);
+    free(paths);
+
+    storage_add_listener(on_storage_event);
+    ESP_LOGI(TAG, "Fingerprinted %d entries in %d memory files", s_count, n);
+    return ESP_OK;
+}
+
+int memory_dedup_count(void)
+{
+    return s_count;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Near-duplicate detection for the markdown memory files under memory/.
+ *
+ * Every entry (bullet or paragraph, see memory_split_entries()) gets a
+ * 64-bit SimHash over its words and word 2-shingles. Fingerprints of the files on
+ * flash are kept in PSRAM and refreshed through storage_notify() events.
+ * Writers run new content through memory_dedup_filter() before saving it.
+ */
+
+typedef struct {
+    int entries;            /* Entries checked */
+    int duplicates;         /* Near-duplicates found */
+    int dropped;            /* Removed from the text */
+    char detail[128];       /* The first duplicate, e.g. "'- Likes tea' ~ MEMORY.md:4" */
+} memory_dedup_report_t;
+
+/**
+ * Fingerprint the memory files and register for storage events.
+ * Call after storage_mgr_init().
+ */
+esp_err_t memory_dedup_init(void);
+
+/**
+ * SimHash of a text's words and word 2-shingles (memory_simhash.c).
+ * @param tokens  Out: number of words after tokenizing (may be NULL)
+ */
+uint64_t memory_simhash(const char *text, size_t len, int *tokens);
+
+/**
+ * Check text about to be written to path against the other entries in it
+ * and in the memory files. With MIMI_DEDUP_MODE 2 a near-duplicate is cut
+ * from the text unless it is longer than the entry it repeats (then the
+ * shorter copy within the text is cut instead); mode 1 only reports it.
+ * When the text replaces the file, entries the file already has are not
+ * checked, so a rewrite never loses what the file held. New text for a
+ * daily note is checked against every memory file; text for MEMORY.md
+ * only against itself, so facts can be promoted out of the notes.
+ *
+ * @param whole_file  text replaces the file (write/edit) rather than being
+ *                    appended to it: the file's current entries are not
+ *                    compared against, and are left alone in text
+ * @param text        NUL-terminated; compacted in place
+ * @return new length of text (len when nothing was cut or path is not memory)
+ */
+size_t memory_dedup_filter(const char *path, bool whole_file, char *text, size_t len,
+                           memory_dedup_report_t *rep);
+
+/**
+ * Rewrite the memory files without near-duplicates, keeping MEMORY.md
+ * entries first, then monthly and weekly digests, then daily notes from
+ * oldest to newest. Runs regardless of MIMI_DEDUP_MODE.
+ * @param files_changed  Out: number of files rewritten
+ */
+esp_err_t memory_dedup_clean(memory_dedup_report_t *rep, int *files_changed);
+
+/** Entries currently fingerprinted. */
+int memory_dedup_count(void);
@@ -0,0 +1,429 @@
+#include "memory/memory_kv.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_writer.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+
+static const char *TAG = "memory_kv";
+
+#define KV_SLOTS       (MIMI_MEMORY_KV_MAX_KEYS * 2)    /* Power of two */
+#define KV_LINE_MAX    4096
+
+typedef struct {
+    char key[MIMI_MEMORY_KV_KEY_MAX];   /* "" = empty slot */
+    char *value;
+    uint32_t ts;
+} kv_entry_t;
+
+static kv_entry_t *s_table = NULL;
+static int s_count = 0;
+static int s_log_records = 0;
+static char *s_render = NULL;           /* Cached memory_kv_render() output */
+static size_t s_render_len = 0;
+static bool s_render_valid = false;
+static SemaphoreHandle_t s_lock = NULL;
+
+static uint32_t key_hash(const char *key)
+{
+    uint32_t h = 2166136261u;           /* FNV-1a */
+    while (*key) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Lowercase into out; false if the key is empty, too long or has other characters. */
+static bool normalize_key(const char *key, char *out)
+{
+    if (!key) return false;
+    size_t len = strlen(key);
+    if (len == 0 || len >= MIMI_MEMORY_KV_KEY_MAX) return false;
+    for (size_t i = 0; i <= len; i++) {
+        char c = key[i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (c && !((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                   c == '.' || c == '_' || c == '-')) {
+            return false;
+        }
+        out[i] = c;
+    }
+    return true;
+}
+
+/* ── Hash table (linear probing, backward-shift delete) ───────── */
+
+static int slot_find(const char *key)
+{
+    uint32_t mask = KV_SLOTS - 1;
+    for (uint32_t i = key_hash(key) & mask;; i = (i + 1) & mask) {
+        if (s_table[i].key[0] == '\0') return -(int)i - 1;     /* Free slot to insert at */
+        if (strcmp(s_table[i].key, key) == 0) return (int)i;
+    }
+}
+
+static void slot_remove(uint32_t i)
+{
+    uint32_t mask = KV_SLOTS - 1;
+    free(s_table[i].value);
+
+    uint32_t j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (s_table[j].key[0] == '\0') break;
+        uint32_t home = key_hash(s_table[j].key) & mask;
+        /* Move j back into the hole unless its home lies cyclically in (i, j] */
+        bool stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            s_table[i] = s_table[j];
+            i = j;
+        }
+    }
+    memset(&s_table[i], 0, sizeof(kv_entry_t));
+    s_count--;
+}
+
+/* Caller holds s_lock; takes a copy of value. */
+static esp_err_t table_set(const char *key, const char *value, uint32_t ts)
+{
+    int slot = slot_find(key);
+    if (slot < 0 && s_count >= MIMI_MEMORY_KV_MAX_KEYS) return ESP_ERR_NO_MEM;
+
+    size_t len = strlen(value);
+    char *copy = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (!copy) return ESP_ERR_NO_MEM;
+    memcpy(copy, value, len + 1);
+
+    kv_entry_t *e;
+    if (slot >= 0) {
+        e = &s_table[slot];
+        free(e->value);
+    } else {
+        e = &s_table[-slot - 1];
+        strcpy(e->key, key);
+        s_count++;
+    }
+    e->value = copy;
+    e->ts = ts;
+    s_render_valid = false;
+    return ESP_OK;
+}
+
+static bool table_delete(const char *key)
+{
+    int slot = slot_find(key);
+    if (slot < 0) return false;
+    slot_remove(slot);
+    s_render_valid = false;
+    return true;
+}
+
+/* ── Log ─────────────────────────────────────────────────────── */
+
+static char *record_line(const char *key, const char *value, uint32_t ts)
+{
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "k", key);
+    if (value) {
+        cJSON_AddStringToObject(obj, "v", value);
+        cJSON_AddNumberToObject(obj, "ts", ts);
+    } else {
+        cJSON_AddNumberToObject(obj, "d", 1);
+    }
+    char *line = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    return line;
+}
+
+static esp_err_t log_append(const char *key, const char *value, uint32_t ts)
+{
+    char *line = record_line(key, value, ts);
+    if (!line) return ESP_ERR_NO_MEM;
+
+    FILE *f = fopen(MIMI_MEMORY_KV_FILE, "a");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s", MIMI_MEMORY_KV_FILE);
+        free(line);
+        return ESP_FAIL;
+    }
+    bool ok = fprintf(f, "%s\n", line) > 0;
+    fclose(f);
+    free(line);
+    if (!ok) return ESP_FAIL;
+
+    s_log_records++;
+    storage_notify(STORAGE_EVT_CHANGED, MIMI_MEMORY_KV_FILE);
+    return ESP_OK;
+}
+
+static void log_replay(void)
+{
+    FILE *f = fopen(MIMI_MEMORY_KV_FILE, "r");
+    if (!f) return;
+
+    char *line = heap_caps_malloc(KV_LINE_MAX, MALLOC_CAP_SPIRAM);
+    if (!line) {
+        fclose(f);
+        return;
+    }
+
+    int bad = 0;
+    while (fgets(line, KV_LINE_MAX, f)) {
+        size_t len = strlen(line);
+        if (len == KV_LINE_MAX - 1 && line[len - 1] != '\n') {
+            /* Overlong record: skip the rest of it */
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n') {}
+            bad++;
+            continue;
+        }
+        s_log_records++;
+
+        cJSON *obj = cJSON_Parse(line);
+        char key[MIMI_MEMORY_KV_KEY_MAX];
+        const char *value = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "v"));
+        if (!obj || !normalize_key(cJSON_GetStringValue(cJSON_GetObjectItem(obj, "k")), key)) {
+            bad++;
+        } else if (value) {
+            cJSON *ts = cJSON_GetObjectItem(obj, "ts");
+            table_set(key, value, cJSON_IsNumber(ts) ? (uint32_t)ts->valuedouble : 0);
+        } else {
+            table_delete(key);
+        }
+        cJSON_Delete(obj);
+    }
+    free(line);
+    fclose(f);
+
+    if (bad) ESP_LOGW(TAG, "Skipped %d unreadable records", bad);
+}
+
+/* Rewrite the log with one record per live key; a reset keeps the old or the new log */
+static esp_err_t compact_locked(void)
+{
+    fs_write_stream_t ws;
+    if (fs_write_stream_begin(&ws, MIMI_MEMORY_KV_FILE, FS_WRITER_TOOLS) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot write %s" FS_WRITE_TMP_EXT, MIMI_MEMORY_KV_FILE);
+        return ESP_FAIL;
+    }
+    bool ok = true;
+    for (int i = 0; i < KV_SLOTS && ok; i++) {
+        const kv_entry_t *e = &s_table[i];
+        if (e->key[0] == '\0') continue;
+        char *line = record_line(e->key, e->value, e->ts);
+        ok = line && fprintf(ws.f, "%s\n", line) > 0;
+        free(line);
+    }
+    if (fs_write_stream_end(&ws, ok) != ESP_OK || !ok) {
+        ESP_LOGE(TAG, "Cannot compact %s", MIMI_MEMORY_KV_FILE);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Compacted log: %d records -> %d", s_log_records, s_count);
+    s_log_records = s_count;
+    return ESP_OK;
+}
+
+/*
+ * Compaction used to write "<log>.tmp", remove the log and rename. A reset
+ * between the two left only the .tmp, which is complete then; otherwise
+ * it is a partial copy.
+ */
+static void recover_legacy_tmp(void)
+{
+    const char *tmp = MIMI_MEMORY_KV_FILE ".tmp";
+    struct stat st;
+    if (stat(tmp, &st) != 0) return;
+    if (stat(MIMI_MEMORY_KV_FILE, &st) != 0 && rename(tmp, MIMI_MEMORY_KV_FILE) == 0) {
+        ESP_LOGW(TAG, "Recovered %s from an interrupted compaction", MIMI_MEMORY_KV_FILE);
+    } else {
+        remove(tmp);
+    }
+}
+
+static bool needs_compaction(void)
+{
+    return s_log_records > 2 * s_count + MIMI_MEMORY_KV_COMPACT_SLACK;
+}
+
+static void on_storage_event(storage_evt_t evt, const char *path)
+{
+    if (evt == STORAGE_EVT_MAINTENANCE) {
+        memory_kv_compact(false);
+    }
+}
+
+/* ── Sorted views ───────────────────────────────────────────── */
+
+static int cmp_entry_key(const void *a, const void *b)
+{
+    return strcmp((*(const kv_entry_t *const *)a)->key, (*(const kv_entry_t *const *)b)->key);
+}
+
+/* Caller holds s_lock and frees the result. */
+static const kv_entry_t **sorted_entries(int *count)
+{
+    const kv_entry_t **list = heap_caps_malloc((s_count ? s_count : 1) * sizeof(*list),
+                                               MALLOC_CAP_SPIRAM);
+    if (!list) return NULL;
+    int n = 0;
+    for (int i = 0; i < KV_SLOTS; i++) {
+        if (s_table[i].key[0]) list[n++] = &s_table[i];
+    }
+    qsort(list, n, sizeof(*list), cmp_entry_key);
+    *count = n;
+    return list;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t memory_kv_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    s_table = heap_caps_calloc(KV_SLOTS, sizeof(kv_entry_t), MALLOC_CAP_SPIRAM);
+    if (!s_lock || !s_table) {
+        ESP_LOGE(TAG, "Failed to allocate key-value memory");
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    recover_legacy_tmp();
+    log_replay();
+    if (needs_compaction()) compact_locked();
+    xSemaphoreGive(s_lock);
+
+    storage_add_listener(on_storage_event);
+    ESP_LOGI(TAG, "Key-value memory: %d keys (%d log records)", s_count, s_log_records);
+    return ESP_OK;
+}
+
+esp_err_t memory_kv_set(const char *key, const char *value)
+{
+    char k[MIMI_MEMORY_KV_KEY_MAX];
+    if (!normalize_key(key, k) || !value || strlen(value) >= MIMI_MEMORY_KV_VALUE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    int slot = slot_find(k);
+    if (slot >= 0 && strcmp(s_table[slot].value, value) == 0) {
+        /* Unchanged: skip the flash write */
+    } else if (slot < 0 && s_count >= MIMI_MEMORY_KV_MAX_KEYS) {
+        err = ESP_ERR_NO_MEM;
+    } else {
+        uint32_t ts = (uint32_t)time(NULL);
+        err = log_append(k, value, ts);
+        if (err == ESP_OK) err = table_set(k, value, ts);
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t memory_kv_get(const char *key, char *buf, size_t size)
+{
+    char k[MIMI_MEMORY_KV_KEY_MAX];
+    if (!normalize_key(key, k)) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int slot = slot_find(k);
+    if (slot >= 0) snprintf(buf, size, "%s", s_table[slot].value);
+    xSemaphoreGive(s_lock);
+    return slot >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t memory_kv_delete(const char *key)
+{
+    char k[MIMI_MEMORY_KV_KEY_MAX];
+    if (!normalize_key(key, k)) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (slot_find(k) >= 0) {
+        err = log_append(k, NULL, 0);
+        if (err == ESP_OK) table_delete(k);
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int memory_kv_list(const char *prefix, memory_kv_cb_t cb, void *ctx)
+{
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    int visited = 0, n = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const kv_entry_t **list = sorted_entries(&n);
+    for (int i = 0; list && i < n; i++) {
+        if (prefix_len && strncmp(list[i]->key, prefix, prefix_len) != 0) continue;
+        visited++;
+        if (!cb(list[i]->key, list[i]->value, list[i]->ts, ctx)) break;
+    }
+    xSemaphoreGive(s_lock);
+    free(list);
+    return visited;
+}
+
+size_t memory_kv_render(char *buf, size_t size)
+{
+    if (size == 0) return 0;
+    buf[0] = '\0';
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_render_valid) {
+        int n = 0;
+        const kv_entry_t **list = sorted_entries(&n);
+        size_t cap = 1;
+        for (int i = 0; list && i < n; i++) {
+            cap += strlen(list[i]->key) + strlen(list[i]->value) + 5;
+        }
+        free(s_render);
+        s_render = list ? heap_caps_malloc(cap, MALLOC_CAP_SPIRAM) : NULL;
+        s_render_len = 0;
+        if (s_render) {
+            s_render[0] = '\0';
+            for (int i = 0; i < n; i++) {
+                char *line = s_render + s_render_len;
+                s_render_len += snprintf(line, cap - s_render_len,
+                                         "- %s: %s\n", list[i]->key, list[i]->value);
+                /* One fact per line */
+                for (char *p = line; p < s_render + s_render_len - 1; p++) {
+                    if (*p == '\n' || *p == '\r') *p = ' ';
+                }
+            }
+            s_render_valid = true;
+        }
+        free(list);
+    }
+    size_t len = 0;
+    if (s_render) {
+        len = s_render_len < size - 1 ? s_render_len : size - 1;
+        memcpy(buf, s_render, len);
+        buf[len] = '\0';
+    }
+    xSemaphoreGive(s_lock);
+    return len;
+}
+
+esp_err_t memory_kv_compact(bool force)
+{
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = (force || needs_compaction()) ? compact_locked() : ESP_OK;
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int memory_kv_count(void)
+{
+    return s_count;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Structured key-value memory (user facts, preferences, settings).
+ *
+ * Held in a PSRAM hash table and persisted as an append-only JSONL log at
+ * MIMI_MEMORY_KV_FILE: {"k":"user.name","v":"Ana","ts":...} per set and
+ * {"k":"...","d":1} per delete. The log is rewritten with only live keys
+ * once dead records outweigh them, from the storage maintenance pass.
+ */
+
+/** Visitor for memory_kv_list(); return false to stop. */
+typedef bool (*memory_kv_cb_t)(const char *key, const char *value, uint32_t ts, void *ctx);
+
+/**
+ * Replay the log into memory. Call after storage_mgr_init().
+ */
+esp_err_t memory_kv_init(void);
+
+/**
+ * Insert or replace a key. Keys are 1..MIMI_MEMORY_KV_KEY_MAX-1 chars of
+ * [a-z0-9._-] (uppercase is folded); values up to MIMI_MEMORY_KV_VALUE_MAX-1 bytes.
+ * @return ESP_ERR_INVALID_ARG on a bad key/value, ESP_ERR_NO_MEM when full
+ */
+esp_err_t memory_kv_set(const char *key, const char *value);
+
+/**
+ * Copy a value into buf.
+ * @return ESP_ERR_NOT_FOUND if the key is not set
+ */
+esp_err_t memory_kv_get(const char *key, char *buf, size_t size);
+
+/**
+ * @return ESP_ERR_NOT_FOUND if the key is not set
+ */
+esp_err_t memory_kv_delete(const char *key);
+
+/**
+ * Visit keys in sorted order, optionally only those starting with prefix.
+ * @return number of keys visited
+ */
+int memory_kv_list(const char *prefix, memory_kv_cb_t cb, void *ctx);
+
+/**
+ * Render all facts as "- key: value" lines, for the long-term memory section
+ * of the prompt. The rendering is cached until the next change.
+ * @return bytes written
+ */
+size_t memory_kv_render(char *buf, size_t size);
+
+/**
+ * Rewrite the log with only live keys if it has grown past the threshold.
+ */
+esp_err_t memory_kv_compact(bool force);
+
+int memory_kv_count(void);
@@ -0,0 +1,310 @@
+#include "memory/memory_rank.h"
+#include "memory/memory_store.h"
+#include "memory/memory_kv.h"
+#include "search/tokenizer.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "mem_rank";
+
+#define RANK_MAX_TERMS   16
+#define BM25_K1          1.2f
+#define BM25_B           0.75f
+
+enum { SRC_LONG_TERM = 0, SRC_NOTES, SRC_COUNT };
+
+static const char *const s_src_headers[SRC_COUNT] = {
+    "Long-term Memory", "Recent Notes",
+};
+
+typedef struct {
+    const char *text;
+    const char *heading;        /* Line of the enclosing "#" heading, or NULL */
+    uint16_t len;
+    uint16_t heading_len;
+    uint16_t dl;                /* Document length in tokens */
+    uint8_t src;
+    bool selected;
+    float score;
+    uint8_t tf[RANK_MAX_TERMS];
+} mem_entry_t;
+
+typedef struct {
+    mem_entry_t *items;
+    int count;
+} entry_list_t;
+
+/* ── Splitting ──────────────────────────────────────────────── */
+
+static bool is_bullet(const char *line, size_t len)
+{
+    if (len >= 2 && (line[0] == '-' || line[0] == '*' || line[0] == '+') && line[1] == ' ') {
+        return true;
+    }
+    size_t i = 0;
+    while (i < len && line[i] >= '0' && line[i] <= '9') i++;
+    return i > 0 && i + 1 < len && line[i] == '.' && line[i + 1] == ' ';
+}
+
+static bool is_blank(const char *line, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r') return false;
+    }
+    return true;
+}
+
+void memory_split_entries(const char *text, memory_entry_cb_t cb, void *ctx)
+{
+    const char *heading = NULL;
+    size_t heading_len = 0;
+    const char *cur = NULL;         /* Open entry */
+    size_t cur_len = 0;
+    int cur_line = 0;
+    int line = 0;
+
+    const char *p = text;
+    while (*p) {
+        const char *nl = strchr(p, '\n');
+        size_t len = nl ? (size_t)(nl - p) : strlen(p);
+        line++;
+
+        bool blank = is_blank(p, len) || (len >= 3 && strncmp(p, "---", 3) == 0);
+        if (cur && !blank && p[0] != '#' && !is_bullet(p, len)) {
+            cur_len = (size_t)(p + len - cur);
+        } else {
+            if (cur && !cb(cur, cur_len, heading, heading_len, cur_line, ctx)) return;
+            cur = NULL;
+            if (p[0] == '#') {
+                heading = p;
+                heading_len = len;
+            } else if (!blank) {
+                cur = p;
+                cur_len = len;
+                cur_line = line;
+            }
+        }
+
+        if (!nl) break;
+        p = nl + 1;
+    }
+    if (cur) cb(cur, cur_len, heading, heading_len, cur_line, ctx);
+}
+
+typedef struct {
+    entry_list_t *list;
+    uint8_t src;
+} split_ctx_t;
+
+static bool on_split_entry(const char *text, size_t len, const char *heading,
+                           size_t heading_len, int line, void *arg)
+{
+    split_ctx_t *sc = arg;
+    entry_list_t *list = sc->list;
+    if (list->count >= MIMI_MEMORY_RANK_MAX_ENTRIES) return false;
+    if (len > UINT16_MAX || heading_len > UINT16_MAX) return true;
+
+    mem_entry_t *e = &list->items[list->count++];
+    memset(e, 0, sizeof(*e));
+    e->text = text;
+    e->len = (uint16_t)len;
+    e->heading = heading;
+    e->heading_len = (uint16_t)heading_len;
+    e->src = sc->src;
+    return true;
+}
+
+/* ── Scoring ────────────────────────────────────────────────── */
+
+typedef struct {
+    char terms[RANK_MAX_TERMS][TOKEN_MAX_LEN + 1];
+    int count;
+} query_t;
+
+typedef struct {
+    const query_t *q;
+    mem_entry_t *e;
+} tf_ctx_t;
+
+static bool on_query_token(const char *token, size_t len, size_t offset, void *arg)
+{
+    query_t *q = arg;
+    for (int i = 0; i < q->count; i++) {
+        if (strcmp(q->terms[i], token) == 0) return true;
+    }
+    memcpy(q->terms[q->count++], token, len + 1);
+    return q->count < RANK_MAX_TERMS;
+}
+
+static bool on_entry_token(const char *token, size_t len, size_t offset, void *arg)
+{
+    tf_ctx_t *c = arg;
+    if (c->e->dl < UINT16_MAX) c->e->dl++;
+    for (int i = 0; i < c->q->count; i++) {
+        if (strcmp(c->q->terms[i], token) == 0) {
+            if (c->e->tf[i] < UINT8_MAX) c->e->tf[i]++;
+            break;
+        }
+    }
+    return true;
+}
+
+static void score_entries(const query_t *q, entry_list_t *list)
+{
+    int df[RANK_MAX_TERMS] = {0};
+    uint32_t total_dl = 0;
+
+    for (int i = 0; i < list->count; i++) {
+        mem_entry_t *e = &list->items[i];
+        tf_ctx_t c = { .q = q, .e = e };
+        if (e->heading) tokenize(e->heading, e->heading_len, on_entry_token, &c);
+        tokenize(e->text, e->len, on_entry_token, &c);
+        total_dl += e->dl;
+        for (int t = 0; t < q->count; t++) {
+            if (e->tf[t]) df[t]++;
+        }
+    }
+    if (list->count == 0 || q->count == 0) return;
+
+    float n = (float)list->count;
+    float avgdl = total_dl ? (float)total_dl / n : 1.0f;
+    float idf[RANK_MAX_TERMS];
+    for (int t = 0; t < q->count; t++) {
+        idf[t] = logf(1.0f + (n - df[t] + 0.5f) / (df[t] + 0.5f));
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        mem_entry_t *e = &list->items[i];
+        float norm = BM25_K1 * (1.0f - BM25_B + BM25_B * e->dl / avgdl);
+        for (int t = 0; t < q->count; t++) {
+            if (!e->tf[t]) continue;
+            e->score += idf[t] * (e->tf[t] * (BM25_K1 + 1.0f)) / (e->tf[t] + norm);
+        }
+    }
+}
+
+/* Best score first; ties keep document order (MEMORY.md, then newest notes). */
+static int cmp_rank(const void *a, const void *b)
+{
+    const mem_entry_t *ea = *(const mem_entry_t *const *)a;
+    const mem_entry_t *eb = *(const mem_entry_t *const *)b;
+    if (ea->score != eb->score) return ea->score > eb->score ? -1 : 1;
+    return ea < eb ? -1 : 1;
+}
+
+/* ── Rendering ──────────────────────────────────────────────── */
+
+static size_t render(const entry_list_t *list, char *out, size_t budget)
+{
+    size_t off = 0;
+    for (int src = 0; src < SRC_COUNT; src++) {
+        bool header = false;
+        const char *last_heading = NULL;
+        for (int i = 0; i < list->count; i++) {
+            const mem_entry_t *e = &list->items[i];
+            if (!e->selected || e->src != src) continue;
+            if (off >= budget) break;
+            if (!header) {
+                off += snprintf(out + off, budget - off, "\n## %s\n\n", s_src_headers[src]);
+                header = true;
+            }
+            if (e->heading && e->heading != last_heading && off < budget) {
+                off += snprintf(out + off, budget - off, "%.*s\n", e->heading_len, e->heading);
+                last_heading = e->heading;
+            }
+            if (off < budget) {
+                off += snprintf(out + off, budget - off, "%.*s\n", e->len, e->text);
+            }
+        }
+    }
+    return off < budget ? off : budget - 1;
+}
+
+/* Rendered size if e is added, counting its heading unless one already chosen shares it. */
+static size_t entry_cost(const entry_list_t *list, const mem_entry_t *e)
+{
+    size_t cost = e->len + 1;
+    if (!e->heading) return cost;
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i].selected && list->items[i].heading == e->heading) return cost;
+    }
+    return cost + e->heading_len + 1;
+}
+
+size_t memory_rank_select(const char *query, char *out, size_t budget)
+{
+    if (budget == 0) return 0;
+    out[0] = '\0';
+
+    char *src_text[SRC_COUNT] = {0};
+    entry_list_t list = {0};
+    mem_entry_t **order = NULL;
+    query_t q = {0};
+    size_t off = 0;
+
+    for (int s = 0; s < SRC_COUNT; s++) {
+        src_text[s] = heap_caps_calloc(1, MIMI_MEMORY_RANK_SOURCE_MAX, MALLOC_CAP_SPIRAM);
+    }
+    list.items = heap_caps_calloc(MIMI_MEMORY_RANK_MAX_ENTRIES, sizeof(mem_entry_t), MALLOC_CAP_SPIRAM);
+    order = heap_caps_calloc(MIMI_MEMORY_RANK_MAX_ENTRIES, sizeof(mem_entry_t *), MALLOC_CAP_SPIRAM);
+    if (!src_text[SRC_LONG_TERM] || !src_text[SRC_NOTES] || !list.items || !order) {
+        ESP_LOGE(TAG, "Out of memory ranking memory entries");
+        goto done;
+    }
+
+    /* Long-term memory is the key-value facts followed by MEMORY.md */
+    char *lt = src_text[SRC_LONG_TERM];
+    size_t lt_len = 0;
+    if (memory_kv_count() > 0) {
+        lt_len = snprintf(lt, MIMI_MEMORY_RANK_SOURCE_MAX, "## Facts\n");
+        lt_len += memory_kv_render(lt + lt_len, MIMI_MEMORY_RANK_SOURCE_MAX - lt_len - 1);
+        lt[lt_len++] = '\n';
+    }
+    memory_read_long_term(lt + lt_len, MIMI_MEMORY_RANK_SOURCE_MAX - lt_len);
+    memory_read_recent(src_text[SRC_NOTES], MIMI_MEMORY_RANK_SOURCE_MAX, MIMI_MEMORY_RECENT_DAYS);
+    for (int s = 0; s < SRC_COUNT; s++) {
+        split_ctx_t sc = { .list = &list, .src = (uint8_t)s };
+        memory_split_entries(src_text[s], on_split_entry, &sc);
+    }
+    if (list.count == 0) goto done;
+
+    if (query) tokenize(query, strlen(query), on_query_token, &q);
+    score_entries(&q, &list);
+
+    for (int i = 0; i < list.count; i++) {
+        order[i] = &list.items[i];
+    }
+    qsort(order, list.count, sizeof(mem_entry_t *), cmp_rank);
+
+    /* Room for the two section headers */
+    size_t used = 2 * (strlen(s_src_headers[SRC_LONG_TERM]) + 6);
+    int chosen = 0, matched = 0;
+    for (int i = 0; i < list.count; i++) {
+        size_t cost = entry_cost(&list, order[i]);
+        if (used + cost >= budget) continue;
+        order[i]->selected = true;
+        used += cost;
+        chosen++;
+        if (order[i]->score > 0) matched++;
+    }
+
+    off = render(&list, out, budget);
+    ESP_LOGI(TAG, "Selected %d/%d memory entries (%d matched, %u bytes)",
+             chosen, list.count, matched, (unsigned)off);
+
+done:
+    for (int s = 0; s < SRC_COUNT; s++) {
+        free(src_text[s]);
+    }
+    free(list.items);
+    free(order);
+    return off;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Visitor for memory_split_entries(). heading is the line of the enclosing
+ * "#" heading (not NUL-terminated) or NULL; line is 1-based. Return false to stop.
+ */
+typedef bool (*memory_entry_cb_t)(const char *text, size_t len, const char *heading,
+                                  size_t heading_len, int line, void *ctx);
+
+/**
+ * Split markdown memory text into entries. Each bullet (with its indented
+ * or wrapped continuation lines) is one entry, as is each paragraph.
+ * Headings are not entries themselves but are passed with the entries
+ * beneath them; blank lines and "---" end an entry.
+ */
+void memory_split_entries(const char *text, memory_entry_cb_t cb, void *ctx);
+
+/**
+ * Render the memory entries most relevant to a query, within a byte budget.
+ *
+ * Key-value facts, MEMORY.md and the recent daily notes are split into
+ * entries (bullets and paragraphs, each tagged with its markdown heading)
+ * and ranked with BM25 against the query. The best entries that fit are written back in document
+ * order under "## Long-term Memory" / "## Recent Notes" headers. With an
+ * empty query or no matches, entries are taken in order: facts, MEMORY.md,
+ * then notes from newest to oldest.
+ *
+ * @param query   Current user message (may be NULL)
+ * @param out     Output buffer
+ * @param budget  Size of out; at most budget - 1 bytes are written
+ * @return bytes written
+ */
+size_t memory_rank_select(const char *query, char *out, size_t budget);
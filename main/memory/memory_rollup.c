@@ -0,0 +1,429 @@
+#include "memory/memory_rollup.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/fs_compress.h"
+#include "llm/llm_proxy.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+
+static const char *TAG = "rollup";
+
+#define ROLLUP_MAX_FILES      128
+#define ROLLUP_MAX_SUMMARIES  2        /* LLM calls per pass */
+#define ROLLUP_SUMMARY_MIN    1024     /* Smaller weeks are merged verbatim */
+#define ROLLUP_SUMMARY_INPUT  (24 * 1024)  /* Larger weeks are merged verbatim too */
+#define SECS_PER_DAY          86400
+
+#define ROLLUP_SYSTEM_PROMPT \
+    "You condense a week of personal daily notes kept by MimiClaw, an AI assistant, " \
+    "into a digest of at most 200 words. Keep dates, names, decisions, preferences, " \
+    "plans and facts that may matter later; drop chit-chat. Use short markdown " \
+    "bullets, each starting with the date (YYYY-MM-DD) when it is known. No preamble."
+
+typedef struct {
+    char name[32];          /* Relative to the memory dir, e.g. "2026-09-28.md" */
+    int day;                /* Days since the epoch (note date / week start) */
+    char group[16];         /* Digest key: "2026-W40" or "2026-09" */
+} rollup_file_t;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} text_buf_t;
+
+static int64_t s_last_run_us = 0;
+
+static bool text_buf_append(text_buf_t *tb, const char *s, size_t n)
+{
+    if (tb->len + n + 1 > tb->cap) {
+        size_t new_cap = tb->cap ? tb->cap * 2 : 4096;
+        while (new_cap < tb->len + n + 1) new_cap *= 2;
+        char *tmp = heap_caps_realloc(tb->data, new_cap, MALLOC_CAP_SPIRAM);
+        if (!tmp) return false;
+        tb->data = tmp;
+        tb->cap = new_cap;
+    }
+    memcpy(tb->data + tb->len, s, n);
+    tb->len += n;
+    tb->data[tb->len] = '\0';
+    return true;
+}
+
+/* ── Dates ──────────────────────────────────────────────────── */
+
+static int day_of(int year, int mon, int mday)
+{
+    struct tm tm = { .tm_year = year - 1900, .tm_mon = mon - 1, .tm_mday = mday, .tm_hour = 12 };
+    return (int)(mktime(&tm) / SECS_PER_DAY);
+}
+
+static void day_to_tm(int day, struct tm *tm)
+{
+    time_t t = (time_t)day * SECS_PER_DAY + SECS_PER_DAY / 2;
+    localtime_r(&t, tm);
+}
+
+/* "YYYY-MM-DD.md" -> day number, or -1 */
+static int parse_note_name(const char *name)
+{
+    int y, m, d;
+    char tail[4];
+    if (strlen(name) != 13 || sscanf(name, "%4d-%2d-%2d.%3s", &y, &m, &d, tail) != 4 ||
+        strcmp(tail, "md") != 0 || !isdigit((unsigned char)name[9])) {
+        return -1;
+    }
+    return day_of(y, m, d);
+}
+
+/* Monday of ISO week w of year y */
+static int iso_week_start(int y, int w)
+{
+    int jan4 = day_of(y, 1, 4);
+    struct tm tm;
+    day_to_tm(jan4, &tm);
+    return jan4 - (tm.tm_wday + 6) % 7 + (w - 1) * 7;
+}
+
+/* "week-YYYY-Www.md" -> Monday day number, or -1 */
+static int parse_week_name(const char *name)
+{
+    int y, w;
+    char tail[4];
+    if (strlen(name) != 16 || sscanf(name, "week-%4d-W%2d.%3s", &y, &w, tail) != 3 ||
+        strcmp(tail, "md") != 0 || w < 1 || w > 53) {
+        return -1;
+    }
+    return iso_week_start(y, w);
+}
+
+/* "month-YYYY-MM.md" -> last day of that month, or -1 */
+static int parse_month_name(const char *name)
+{
+    int y, m;
+    char tail[4];
+    if (strlen(name) != 16 || sscanf(name, "month-%4d-%2d.%3s", &y, &m, tail) != 3 ||
+        strcmp(tail, "md") != 0 || m < 1 || m > 12) {
+        return -1;
+    }
+    return day_of(y, m + 1, 1) - 1;
+}
+
+/* ── Scan ───────────────────────────────────────────────────── */
+
+static int cmp_by_day(const void *a, const void *b)
+{
+    const rollup_file_t *fa = a, *fb = b;
+    int c = strcmp(fa->group, fb->group);
+    return c ? c : fa->day - fb->day;
+}
+
+/*
+ * Collect files under memory/ whose digest is due.
+ * weekly: daily notes older than the weekly threshold, grouped by ISO week
+ * !weekly: weekly digests whose week ended before the monthly threshold,
+ *          grouped by the month of the week's Thursday
+ */
+typedef struct {
+    bool weekly;
+    int today;
+    rollup_file_t *files;
+    int count;
+} collect_ctx_t;
+
+static bool on_memory_file(const char *path, void *arg)
+{
+    collect_ctx_t *cc = arg;
+    const char *name = path + strlen(MIMI_SPIFFS_MEMORY_DIR "/");
+    rollup_file_t *f = &cc->files[cc->count];
+    struct tm tm;
+
+    if (cc->weekly) {
+        int day = parse_note_name(name);
+        if (day < 0 || cc->today - day <= MIMI_ROLLUP_WEEKLY_AFTER_DAYS) return true;
+        day_to_tm(day, &tm);
+        strftime(f->group, sizeof(f->group), "%G-W%V", &tm);
+        f->day = day;
+    } else {
+        int monday = parse_week_name(name);
+        if (monday < 0 || cc->today - (monday + 6) <= MIMI_ROLLUP_MONTHLY_AFTER_DAYS) return true;
+        day_to_tm(monday + 3, &tm);
+        strftime(f->group, sizeof(f->group), "%Y-%m", &tm);
+        f->day = monday;
+    }
+    strncpy(f->name, name, sizeof(f->name) - 1);
+    f->name[sizeof(f->name) - 1] = '\0';
+    cc->count++;
+    return cc->count < ROLLUP_MAX_FILES;
+}
+
+static int collect(bool weekly, int today, rollup_file_t *files)
+{
+    collect_ctx_t cc = { .weekly = weekly, .today = today, .files = files, .count = 0 };
+    fs_list(MIMI_SPIFFS_MEMORY_DIR "/", on_memory_file, &cc);
+
+    qsort(files, cc.count, sizeof(rollup_file_t), cmp_by_day);
+    return cc.count;
+}
+
+/* ── Merge ──────────────────────────────────────────────────── */
+
+/*
+ * Append a file's body, without its "# title" line, under a "## label" heading.
+ * With demote, the body's own "## " headings become "### ".
+ */
+static bool append_section(text_buf_t *tb, const char *path, const char *label, bool demote)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[256];
+    bool first = true;
+    bool ok = text_buf_append(tb, "## ", 3) && text_buf_append(tb, label, strlen(label)) &&
+              text_buf_append(tb, "\n", 1);
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (first && line[0] == '#' && line[1] == ' ') {
+            first = false;
+            continue;
+        }
+        first = false;
+        if (demote && strncmp(line, "## ", 3) == 0) {
+            ok = text_buf_append(tb, "#", 1);
+        }
+        ok = ok && text_buf_append(tb, line, strlen(line));
+    }
+    fclose(f);
+
+    /* Exactly one blank line between sections */
+    while (tb->len && (tb->data[tb->len - 1] == '\n' || tb->data[tb->len - 1] == ' ')) {
+        tb->data[--tb->len] = '\0';
+    }
+    return ok && text_buf_append(tb, "\n\n", 2);
+}
+
+static char *summarize(const char *text, const char *first, const char *last)
+{
+    cJSON *msgs = cJSON_CreateArray();
+    cJSON *user = cJSON_CreateObject();
+    cJSON_AddStringToObject(user, "role", "user");
+    cJSON_AddStringToObject(user, "content", text);
+    cJSON_AddItemToArray(msgs, user);
+    char *msgs_json = cJSON_PrintUnformatted(msgs);
+    cJSON_Delete(msgs);
+    if (!msgs_json) return NULL;
+
+    char *summary = heap_caps_calloc(1, MIMI_SESSION_SUMMARY_MAX, MALLOC_CAP_SPIRAM);
+    if (!summary) {
+        free(msgs_json);
+        return NULL;
+    }
+    esp_err_t err = llm_chat_model(MIMI_SESSION_SUMMARY_MODEL, ROLLUP_SYSTEM_PROMPT,
+                                   msgs_json, summary, MIMI_SESSION_SUMMARY_MAX);
+    free(msgs_json);
+    if (err != ESP_OK || summary[0] == '\0') {
+        ESP_LOGW(TAG, "Summary of %s..%s failed: %s", first, last, esp_err_to_name(err));
+        free(summary);
+        return NULL;
+    }
+    return summary;
+}
+
+static esp_err_t append_digest(const char *path, const char *title, const char *body, size_t len)
+{
+    FILE *probe = fopen(path, "r");
+    bool exists = probe != NULL;
+    if (probe) fclose(probe);
+
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_FAIL;
+    }
+    bool ok = (exists || fprintf(f, "# %s\n\n", title) > 0) && fwrite(body, 1, len, f) == len;
+    fclose(f);
+    if (!ok) return ESP_FAIL;
+
+    storage_notify(STORAGE_EVT_CHANGED, path);
+    return ESP_OK;
+}
+
+/* Merge files[0..n) (one group) into its digest, then delete them. */
+static esp_err_t roll_group(bool weekly, const rollup_file_t *files, int n,
+                            bool summarize_group, memory_rollup_result_t *res)
+{
+    char path[96];
+    char title[48];
+    if (weekly) {
+        snprintf(path, sizeof(path), "%s/week-%s.md", MIMI_SPIFFS_MEMORY_DIR, files[0].group);
+        snprintf(title, sizeof(title), "Week %s", files[0].group);
+    } else {
+        snprintf(path, sizeof(path), "%s/month-%s.md", MIMI_SPIFFS_MEMORY_DIR, files[0].group);
+        snprintf(title, sizeof(title), "Month %s", files[0].group);
+    }
+
+    text_buf_t tb = {0};
+    bool ok = true;
+    for (int i = 0; i < n && ok; i++) {
+        char src[96];
+        char label[24];
+        snprintf(src, sizeof(src), "%s/%s", MIMI_SPIFFS_MEMORY_DIR, files[i].name);
+        /* Notes are labelled by date, weekly digests by week */
+        const char *base = weekly ? files[i].name : files[i].name + 5;
+        snprintf(label, sizeof(label), "%.*s", (int)strcspn(base, "."), base);
+        ok = append_section(&tb, src, label, !weekly);
+    }
+    if (!ok || tb.len == 0) {
+        free(tb.data);
+        return ESP_FAIL;
+    }
+
+    /* The summary must cover every source deleted below, so a week too
+       long for one request is merged verbatim instead of cut */
+    char *summary = NULL;
+    if (summarize_group && tb.len > ROLLUP_SUMMARY_INPUT) {
+        ESP_LOGW(TAG, "%s is %u bytes, too long to summarize; merging verbatim",
+                 files[0].group, (unsigned)tb.len);
+    } else if (summarize_group && tb.len >= ROLLUP_SUMMARY_MIN) {
+        summary = summarize(tb.data, files[0].name, files[n - 1].name);
+    }
+
+    esp_err_t err;
+    bool summarized = summary != NULL;
+    if (summarized) {
+        text_buf_t sb = {0};
+        char heading[64];
+        int hl = snprintf(heading, sizeof(heading), "## %.10s to %.10s (summary)\n",
+                          files[0].name, files[n - 1].name);
+        ok = text_buf_append(&sb, heading, hl) &&
+             text_buf_append(&sb, summary, strlen(summary)) && text_buf_append(&sb, "\n\n", 2);
+        err = ok ? append_digest(path, title, sb.data, sb.len) : ESP_ERR_NO_MEM;
+        free(sb.data);
+        free(summary);
+        if (err == ESP_OK) res->summaries++;
+    } else {
+        err = append_digest(path, title, tb.data, tb.len);
+    }
+    free(tb.data);
+    if (err != ESP_OK) return err;
+
+    /* Only delete the sources once the digest holds their content */
+    for (int i = 0; i < n; i++) {
+        char src[96];
+        snprintf(src, sizeof(src), "%s/%s", MIMI_SPIFFS_MEMORY_DIR, files[i].name);
+        if (remove(src) == 0) {
+            storage_notify(STORAGE_EVT_REMOVED, src);
+        }
+    }
+    if (weekly) {
+        res->notes_rolled += n;
+    } else {
+        res->weeks_rolled += n;
+    }
+    ESP_LOGI(TAG, "Rolled %d file(s) into %s%s", n, path, summarized ? " (summarized)" : "");
+    return ESP_OK;
+}
+
+static void roll_stage(bool weekly, int today, bool summarize_groups,
+                       rollup_file_t *files, memory_rollup_result_t *res)
+{
+    int count = collect(weekly, today, files);
+    for (int i = 0; i < count;) {
+        int j = i + 1;
+        while (j < count && strcmp(files[j].group, files[i].group) == 0) j++;
+        /* Weeks are summarized once; monthly digests just gather them */
+        bool summarize_group = weekly && summarize_groups && res->summaries < ROLLUP_MAX_SUMMARIES;
+        if (roll_group(weekly, &files[i], j - i, summarize_group, res) != ESP_OK) {
+            ESP_LOGW(TAG, "Rollup of %s failed; sources kept", files[i].group);
+        }
+        i = j;
+    }
+}
+
+/* ── Archive ────────────────────────────────────────────────── */
+
+typedef struct {
+    int today;
+    int archived;
+} archive_ctx_t;
+
+/* Monthly digests nobody has added to in months: deflate them in place. */
+static bool on_month_file(const char *path, void *arg)
+{
+    archive_ctx_t *ac = arg;
+    int last = parse_month_name(path + strlen(MIMI_SPIFFS_MEMORY_DIR "/"));
+    if (last < 0 || ac->today - last <= MIMI_ROLLUP_ARCHIVE_AFTER_DAYS) return true;
+
+    if (fs_compress_archive(path) == ESP_OK) ac->archived++;
+    return true;
+}
+
+static int archive_stage(int today)
+{
+    archive_ctx_t ac = { .today = today, .archived = 0 };
+#if MIMI_FS_COMPRESS
+    fs_list(MIMI_SPIFFS_MEMORY_DIR "/", on_month_file, &ac);
+#endif
+    return ac.archived;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t memory_rollup_run(bool summarize_notes, memory_rollup_result_t *out)
+{
+    memory_rollup_result_t res = {0};
+    if (out) *out = res;
+
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    if (tm.tm_year + 1900 < 2024) {
+        ESP_LOGD(TAG, "Clock not set, skipping rollup");
+        return ESP_ERR_INVALID_STATE;
+    }
+    int today = (int)(now / SECS_PER_DAY);
+
+    rollup_file_t *files = heap_caps_calloc(ROLLUP_MAX_FILES, sizeof(rollup_file_t), MALLOC_CAP_SPIRAM);
+    if (!files) return ESP_ERR_NO_MEM;
+
+    roll_stage(true, today, summarize_notes, files, &res);
+    roll_stage(false, today, false, files, &res);
+    free(files);
+    res.months_archived = archive_stage(today);
+
+    if (res.notes_rolled || res.weeks_rolled || res.months_archived) {
+        ESP_LOGI(TAG, "Rollup: %d notes -> weekly, %d weeks -> monthly, %d summarized, %d archived",
+                 res.notes_rolled, res.weeks_rolled, res.summaries, res.months_archived);
+    }
+    if (out) *out = res;
+    return ESP_OK;
+}
+
+void memory_rollup_maybe_run(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_last_run_us && now - s_last_run_us < (int64_t)MIMI_ROLLUP_INTERVAL_MS * 1000) {
+        return;
+    }
+    if (memory_rollup_run(MIMI_ROLLUP_SUMMARIZE, NULL) != ESP_ERR_INVALID_STATE) {
+        s_last_run_us = now;
+    }
+}
+
+static void on_storage_event(storage_evt_t evt, const char *path)
+{
+    if (evt == STORAGE_EVT_IDLE) memory_rollup_maybe_run();
+}
+
+esp_err_t memory_rollup_init(void)
+{
+    return storage_add_listener(on_storage_event);
+}
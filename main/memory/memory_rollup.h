@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+
+/*
+ * Rollup of old daily notes into digests under /spiffs/memory/. Daily notes
+ * sit directly in that directory as YYYY-MM-DD.md (no daily/ subdirectory);
+ * memory_read_recent() and storage eviction match the same names.
+ *
+ *   YYYY-MM-DD.md  older than MIMI_ROLLUP_WEEKLY_AFTER_DAYS  -> week-YYYY-Www.md
+ *   week-*.md      older than MIMI_ROLLUP_MONTHLY_AFTER_DAYS -> month-YYYY-MM.md
+ *   month-*.md     older than MIMI_ROLLUP_ARCHIVE_AFTER_DAYS -> month-YYYY-MM.md.z
+ *
+ * Notes are appended to the digest (optionally as an LLM summary) and the
+ * originals deleted. Digests are plain markdown, so search_files finds them;
+ * archived months are compressed (see fs_compress.h) but stay indexed and
+ * readable under their plain name.
+ */
+
+typedef struct {
+    int notes_rolled;       /* Daily notes merged into weekly digests */
+    int weeks_rolled;       /* Weekly digests merged into monthly digests */
+    int summaries;          /* Groups written as an LLM summary */
+    int months_archived;    /* Monthly digests compressed */
+} memory_rollup_result_t;
+
+/**
+ * Run one rollup pass now.
+ * @param summarize  Summarize each week with the LLM (needs network and a
+ *                   task stack large enough for TLS); raw merge otherwise
+ * @return ESP_ERR_INVALID_STATE if the clock has not been set yet
+ */
+esp_err_t memory_rollup_run(bool summarize, memory_rollup_result_t *out);
+
+/**
+ * Run a pass if MIMI_ROLLUP_INTERVAL_MS has passed since the last one.
+ * Called on STORAGE_EVT_IDLE, between turns, so summaries can use the LLM
+ * without holding up a reply.
+ */
+void memory_rollup_maybe_run(void);
+
+/**
+ * Register the storage listener that runs memory_rollup_maybe_run().
+ */
+esp_err_t memory_rollup_init(void);
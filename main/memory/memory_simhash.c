@@ -0,0 +1,70 @@
+#include "memory/memory_dedup.h"
+#include "search/tokenizer.h"
+
+#include <string.h>
+
+/*
+ * Kept apart from memory_dedup.c, which needs the RTOS and flash, so the
+ * host benchmarks in bench/ can build it.
+ */
+
+typedef struct {
+    int16_t acc[64];
+    uint64_t prev;
+    int tokens;
+} simhash_ctx_t;
+
+static uint64_t fnv1a64(const char *s, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* splitmix64 finalizer: spreads word and shingle hashes over all 64 bits */
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void add_feature(simhash_ctx_t *c, uint64_t h)
+{
+    for (int b = 0; b < 64; b++) {
+        c->acc[b] += ((h >> b) & 1) ? 1 : -1;
+    }
+}
+
+static bool on_token(const char *token, size_t len, size_t offset, void *arg)
+{
+    simhash_ctx_t *c = arg;
+    uint64_t h = fnv1a64(token, len);
+    add_feature(c, mix64(h));
+    if (c->tokens > 0) {
+        add_feature(c, mix64(c->prev * 0x9e3779b97f4a7c15ULL ^ h));
+    }
+    c->prev = h;
+    c->tokens++;
+    return c->tokens < INT16_MAX;
+}
+
+uint64_t memory_simhash(const char *text, size_t len, int *tokens)
+{
+    simhash_ctx_t c;
+    memset(&c, 0, sizeof(c));
+    tokenize(text, len, on_token, &c);
+
+    uint64_t fp = 0;
+    for (int b = 0; b < 64; b++) {
+        if (c.acc[b] > 0) fp |= 1ULL << b;
+    }
+    if (tokens) *tokens = c.tokens;
+    return fp;
+}
@@ -1,7 +1,12 @@
 #include "memory_store.h"
 #include "mimi_config.h"
+#include "storage/storage_mgr.h"
+#include "storage/file_cache.h"
+#include "storage/fs_writer.h"
+#include "memory/memory_dedup.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <sys/stat.h>
@@ -29,20 +34,13 @@ esp_err_t memory_store_init(void)
 
 esp_err_t memory_read_long_term(char *buf, size_t size)
 {
-    FILE *f = fopen(MIMI_MEMORY_FILE, "r");
-    if (!f) {
-        buf[0] = '\0';
-        return ESP_ERR_NOT_FOUND;
-    }
-
-    size_t n = fread(buf, 1, size - 1, f);
-    buf[n] = '\0';
-    fclose(f);
-    return ESP_OK;
+    return file_cache_read(MIMI_MEMORY_FILE, buf, size) < 0 ? ESP_ERR_NOT_FOUND : ESP_OK;
 }
 
 esp_err_t memory_write_long_term(const char *content)
 {
+    /* Settle a pending write_file first, or it would land on top of this */
+    fs_writer_flush(MIMI_MEMORY_FILE);
     FILE *f = fopen(MIMI_MEMORY_FILE, "w");
     if (!f) {
         ESP_LOGE(TAG, "Cannot write %s", MIMI_MEMORY_FILE);
@@ -50,6 +48,7 @@ esp_err_t memory_write_long_term(const char *content)
     }
     fputs(content, f);
     fclose(f);
+    storage_notify(STORAGE_EVT_CHANGED, MIMI_MEMORY_FILE);
     ESP_LOGI(TAG, "Long-term memory updated (%d bytes)", (int)strlen(content));
     return ESP_OK;
 }
@@ -62,19 +61,32 @@ esp_err_t memory_append_today(const char *note)
     char path[64];
     snprintf(path, sizeof(path), "%s/%s.md", MIMI_SPIFFS_MEMORY_DIR, date_str);
 
+    /* Drop entries that only restate ones already saved */
+    char *copy = strdup(note);
+    memory_dedup_report_t dedup;
+    if (copy && memory_dedup_filter(path, false, copy, strlen(copy), &dedup) == 0) {
+        ESP_LOGI(TAG, "Note already in memory (%s), not appended", dedup.detail);
+        free(copy);
+        return ESP_OK;
+    }
+
+    fs_writer_flush(path);
     FILE *f = fopen(path, "a");
     if (!f) {
         /* Try creating — if file doesn't exist yet, write header */
         f = fopen(path, "w");
         if (!f) {
             ESP_LOGE(TAG, "Cannot open %s", path);
+            free(copy);
             return ESP_FAIL;
         }
         fprintf(f, "# %s\n\n", date_str);
     }
 
-    fprintf(f, "%s\n", note);
+    fprintf(f, "%s\n", copy ? copy : note);
     fclose(f);
+    free(copy);
+    storage_notify(STORAGE_EVT_CHANGED, path);
     return ESP_OK;
 }
 
@@ -90,17 +102,17 @@ esp_err_t memory_read_recent(char *buf, size_t size, int days)
         char path[64];
         snprintf(path, sizeof(path), "%s/%s.md", MIMI_SPIFFS_MEMORY_DIR, date_str);
 
-        FILE *f = fopen(path, "r");
-        if (!f) continue;
-
-        if (offset > 0 && offset < size - 4) {
-            offset += snprintf(buf + offset, size - offset, "\n---\n");
+        /* The separator is dropped again if the note does not exist */
+        size_t sep = 0;
+        if (offset > 0 && offset + 6 < size) {
+            sep = snprintf(buf + offset, size - offset, "\n---\n");
         }
-
-        size_t n = fread(buf + offset, 1, size - offset - 1, f);
-        offset += n;
-        buf[offset] = '\0';
-        fclose(f);
+        int n = file_cache_read(path, buf + offset + sep, size - offset - sep);
+        if (n < 0) {
+            buf[offset] = '\0';
+            continue;
+        }
+        offset += sep + n;
     }
 
     return ESP_OK;
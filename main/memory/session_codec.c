@@ -0,0 +1,514 @@
+#include "session_codec.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "cJSON.h"
+
+static const char *TAG = "session_codec";
+
+#define BIN_HDR_MAX      11   /* role + two 5-byte varints */
+#define BIN_TRAILER      8    /* crc + size */
+#define BIN_REC_MIN      (1 + 1 + 1 + BIN_TRAILER)
+#define TAIL_CHUNK       512
+
+static const char *const s_role_names[] = { "user", "assistant", "tool", "summary" };
+
+#define ROLE_COUNT  (sizeof(s_role_names) / sizeof(s_role_names[0]))
+
+const char *session_role_name(uint8_t role)
+{
+    return role < ROLE_COUNT ? s_role_names[role] : "user";
+}
+
+bool session_role_parse(const char *name, uint8_t *out)
+{
+    if (!name) return false;
+    for (uint8_t i = 0; i < ROLE_COUNT; i++) {
+        if (strcmp(name, s_role_names[i]) == 0) {
+            *out = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t session_codec_header(session_fmt_t fmt, uint8_t *buf)
+{
+    if (fmt != SESSION_FMT_BIN) return 0;
+    memcpy(buf, SESSION_BIN_MAGIC, SESSION_BIN_MAGIC_LEN);
+    return SESSION_BIN_MAGIC_LEN;
+}
+
+/* ── Byte helpers ──────────────────────────────────────────── */
+
+static size_t put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Returns bytes consumed, 0 if truncated or over-long */
+static size_t get_varint(const uint8_t *p, size_t avail, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < avail && i < 5; i++) {
+        v |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *out = v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static void put_u32le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ── JSONL ─────────────────────────────────────────────────── */
+
+static uint8_t *jsonl_encode(const session_rec_t *rec, size_t *len_out)
+{
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "role", session_role_name(rec->role));
+    cJSON_AddStringToObject(obj, "content", rec->content);
+    cJSON_AddNumberToObject(obj, "ts", (double)rec->ts);
+    char *line = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    if (!line) return NULL;
+
+    size_t n = strlen(line);
+    uint8_t *out = heap_caps_malloc(n + 1, MALLOC_CAP_SPIRAM);
+    if (out) {
+        memcpy(out, line, n);
+        out[n] = '\n';
+        *len_out = n + 1;
+    }
+    free(line);
+    return out;
+}
+
+/* Parse one line and hand it to cb. Returns false if cb asked to stop. */
+static bool jsonl_emit(const char *line, session_rec_cb_t cb, void *ctx)
+{
+    cJSON *obj = line[0] ? cJSON_Parse(line) : NULL;
+    if (!obj) return true;
+
+    bool more = true;
+    session_rec_t rec;
+    const char *role = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "role"));
+    const char *content = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "content"));
+    cJSON *ts = cJSON_GetObjectItem(obj, "ts");
+    if (content && session_role_parse(role, &rec.role)) {
+        rec.ts = cJSON_IsNumber(ts) ? (uint32_t)ts->valuedouble : 0;
+        rec.content = content;
+        rec.len = strlen(content);
+        more = cb(&rec, ctx);
+    }
+    cJSON_Delete(obj);
+    return more;
+}
+
+static esp_err_t jsonl_read_all(FILE *f, session_rec_cb_t cb, void *ctx)
+{
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    fseek(f, 0, SEEK_SET);
+    while ((n = getline(&line, &cap, f)) > 0) {
+        if (line[n - 1] == '\n') line[n - 1] = '\0';
+        if (!jsonl_emit(line, cb, ctx)) break;
+    }
+    free(line);
+    return ESP_OK;
+}
+
+/* Offset where the last max_lines lines of the file begin, found by
+ * scanning backwards from EOF so the cost does not grow with file size. */
+static long jsonl_tail_offset(FILE *f, long size, int max_lines)
+{
+    char chunk[TAIL_CHUNK];
+    long pos = size;
+    int lines = 0;
+
+    while (pos > 0) {
+        long n = pos > (long)sizeof(chunk) ? (long)sizeof(chunk) : pos;
+        pos -= n;
+        if (fseek(f, pos, SEEK_SET) != 0 || fread(chunk, 1, n, f) != (size_t)n) {
+            return 0;
+        }
+        for (long i = n - 1; i >= 0; i--) {
+            if (chunk[i] != '\n') continue;
+            if (pos + i == size - 1) continue;  /* terminator of the last line */
+            if (++lines == max_lines) {
+                return pos + i + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* A compacted session keeps its summary on the first line. */
+static bool jsonl_emit_head_summary(FILE *f, session_rec_cb_t cb, void *ctx)
+{
+    static const char prefix[] = "{\"role\":\"summary\"";
+    char head[sizeof(prefix)];
+
+    if (fseek(f, 0, SEEK_SET) != 0 ||
+        fread(head, 1, sizeof(prefix) - 1, f) != sizeof(prefix) - 1 ||
+        memcmp(head, prefix, sizeof(prefix) - 1) != 0) {
+        return true;
+    }
+
+    fseek(f, 0, SEEK_SET);
+    char *line = NULL;
+    size_t cap = 0;
+    bool more = true;
+    if (getline(&line, &cap, f) > 0) {
+        more = jsonl_emit(line, cb, ctx);
+    }
+    free(line);
+    return more;
+}
+
+static esp_err_t jsonl_read_tail(FILE *f, int max_records, session_rec_cb_t cb, void *ctx)
+{
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    long tail_off = size > 0 ? jsonl_tail_offset(f, size, max_records) : 0;
+
+    if (tail_off > 0 && !jsonl_emit_head_summary(f, cb, ctx)) {
+        return ESP_OK;
+    }
+
+    /* Read just the tail region in one go; lines may be any length */
+    size_t tail_len = (size_t)(size - tail_off);
+    char *tail = heap_caps_malloc(tail_len + 1, MALLOC_CAP_SPIRAM);
+    if (!tail) return ESP_ERR_NO_MEM;
+    fseek(f, tail_off, SEEK_SET);
+    size_t got = fread(tail, 1, tail_len, f);
+    tail[got] = '\0';
+
+    char *line = tail;
+    while (line && *line) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        if (!jsonl_emit(line, cb, ctx)) break;
+        line = nl ? nl + 1 : NULL;
+    }
+    free(tail);
+    return ESP_OK;
+}
+
+/* ── Binary ────────────────────────────────────────────────── */
+
+static uint8_t *bin_encode(const session_rec_t *rec, size_t *len_out)
+{
+    uint8_t *buf = heap_caps_malloc(BIN_HDR_MAX + rec->len + BIN_TRAILER, MALLOC_CAP_SPIRAM);
+    if (!buf) return NULL;
+
+    size_t n = 0;
+    buf[n++] = rec->role;
+    n += put_varint(buf + n, rec->ts);
+    n += put_varint(buf + n, (uint32_t)rec->len);
+    memcpy(buf + n, rec->content, rec->len);
+    n += rec->len;
+    put_u32le(buf + n, esp_rom_crc32_le(0, buf, n));
+    n += 4;
+    put_u32le(buf + n, (uint32_t)n);
+    n += 4;
+
+    *len_out = n;
+    return buf;
+}
+
+/* Decode the record at the start of buf. Returns its full length, or 0 if
+ * buf does not start with a complete, valid record. The payload is
+ * NUL-terminated in place, over the CRC, once the CRC has been checked. */
+static size_t bin_decode(uint8_t *buf, size_t avail, session_rec_t *rec)
+{
+    if (avail < BIN_REC_MIN || buf[0] >= ROLE_COUNT) return 0;
+
+    uint32_t ts, len;
+    size_t off = 1;
+    size_t k = get_varint(buf + off, avail - off, &ts);
+    if (!k) return 0;
+    off += k;
+    k = get_varint(buf + off, avail - off, &len);
+    if (!k) return 0;
+    off += k;
+    if (len > avail - off || avail - off - len < BIN_TRAILER) return 0;
+
+    size_t body = off + len;
+    if (get_u32le(buf + body) != esp_rom_crc32_le(0, buf, body) ||
+        get_u32le(buf + body + 4) != body + 4) {
+        return 0;
+    }
+
+    buf[body] = '\0';
+    rec->role = buf[0];
+    rec->ts = ts;
+    rec->content = (const char *)buf + off;
+    rec->len = len;
+    return body + BIN_TRAILER;
+}
+
+/* Read and decode the record at pos. Returns the PSRAM buffer backing
+ * rec (caller frees), or NULL at EOF or on a bad record. */
+static uint8_t *bin_read_at(FILE *f, long pos, long size, session_rec_t *rec, long *next)
+{
+    uint8_t hdr[BIN_HDR_MAX];
+    long avail = size - pos;
+    size_t want = avail < BIN_HDR_MAX ? (size_t)avail : BIN_HDR_MAX;
+    if (avail <= 0 || fseek(f, pos, SEEK_SET) != 0 || fread(hdr, 1, want, f) != want) {
+        return NULL;
+    }
+
+    uint32_t ts, len;
+    size_t k1 = get_varint(hdr + 1, want - 1, &ts);
+    size_t k2 = k1 ? get_varint(hdr + 1 + k1, want - 1 - k1, &len) : 0;
+    if (!k2) return NULL;
+
+    size_t total = 1 + k1 + k2 + (size_t)len + BIN_TRAILER;
+    if ((long)total > avail) return NULL;
+
+    uint8_t *buf = heap_caps_malloc(total, MALLOC_CAP_SPIRAM);
+    if (!buf) return NULL;
+    if (fseek(f, pos, SEEK_SET) != 0 || fread(buf, 1, total, f) != total ||
+        bin_decode(buf, total, rec) != total) {
+        free(buf);
+        return NULL;
+    }
+    *next = pos + (long)total;
+    return buf;
+}
+
+/* Length of the record at pos, checked against its size trailer; 0 if bad. */
+static long bin_record_len_at(FILE *f, long pos, long size)
+{
+    uint8_t hdr[BIN_HDR_MAX];
+    long avail = size - pos;
+    size_t want = avail < BIN_HDR_MAX ? (size_t)avail : BIN_HDR_MAX;
+    if (avail < (long)BIN_REC_MIN || fseek(f, pos, SEEK_SET) != 0 ||
+        fread(hdr, 1, want, f) != want) {
+        return 0;
+    }
+
+    uint32_t ts, len;
+    size_t k1 = get_varint(hdr + 1, want - 1, &ts);
+    size_t k2 = k1 ? get_varint(hdr + 1 + k1, want - 1 - k1, &len) : 0;
+    if (!k2) return 0;
+    long total = (long)(1 + k1 + k2 + len + BIN_TRAILER);
+    if (total > avail) return 0;
+
+    uint8_t trailer[4];
+    if (fseek(f, pos + total - 4, SEEK_SET) != 0 || fread(trailer, 1, 4, f) != 4 ||
+        get_u32le(trailer) != (uint32_t)(total - 4)) {
+        return 0;
+    }
+    return total;
+}
+
+/* Forward fallback for when the file does not end on a whole record
+ * (e.g. a write cut short by a reset): skip from record to record and
+ * return where the last max_records good ones begin. */
+static long bin_scan_tail_offset(FILE *f, long size, int max_records)
+{
+    int total = 0;
+    long pos = SESSION_BIN_MAGIC_LEN;
+    long len;
+    while ((len = bin_record_len_at(f, pos, size)) > 0) {
+        pos += len;
+        total++;
+    }
+
+    pos = SESSION_BIN_MAGIC_LEN;
+    for (int i = 0; i < total - max_records; i++) {
+        pos += bin_record_len_at(f, pos, size);
+    }
+    return pos;
+}
+
+static bool bin_check_magic(FILE *f)
+{
+    char magic[SESSION_BIN_MAGIC_LEN];
+    return fseek(f, 0, SEEK_SET) == 0 &&
+           fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+           memcmp(magic, SESSION_BIN_MAGIC, sizeof(magic)) == 0;
+}
+
+static esp_err_t bin_read_all(FILE *f, session_rec_cb_t cb, void *ctx)
+{
+    if (!bin_check_magic(f)) return ESP_ERR_INVALID_STATE;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+
+    long pos = SESSION_BIN_MAGIC_LEN;
+    while (pos < size) {
+        session_rec_t rec;
+        uint8_t *buf = bin_read_at(f, pos, size, &rec, &pos);
+        if (!buf) {
+            ESP_LOGW(TAG, "Bad record, ignoring the rest of the file");
+            break;
+        }
+        bool more = cb(&rec, ctx);
+        free(buf);
+        if (!more) break;
+    }
+    return ESP_OK;
+}
+
+/* Start of the last max_records records, walking the size trailers back
+ * from EOF. An implausible trailer ends the walk early: the records after
+ * it are still checked when decoded. -1 if the last trailer is bad. */
+static long bin_walk_back(FILE *f, long size, int max_records)
+{
+    long start = size;
+    for (int n = 0; n < max_records && start > SESSION_BIN_MAGIC_LEN; n++) {
+        uint8_t trailer[4];
+        uint32_t rec_len = 0;
+        if (start >= SESSION_BIN_MAGIC_LEN + BIN_REC_MIN &&
+            fseek(f, start - 4, SEEK_SET) == 0 && fread(trailer, 1, 4, f) == 4) {
+            rec_len = get_u32le(trailer);
+        }
+        if (rec_len + 4 < BIN_REC_MIN || rec_len + 4 > (uint32_t)(start - SESSION_BIN_MAGIC_LEN)) {
+            return n ? start : -1;
+        }
+        start -= rec_len + 4;
+    }
+    return start;
+}
+
+/* Length of the record framed at the start of buf by its header and size
+ * trailer, whatever its CRC; 0 if the framing is broken too. */
+static size_t bin_frame_len(const uint8_t *buf, size_t avail)
+{
+    uint32_t ts, len;
+    size_t k1 = avail > 1 ? get_varint(buf + 1, avail - 1, &ts) : 0;
+    size_t k2 = k1 ? get_varint(buf + 1 + k1, avail - 1 - k1, &len) : 0;
+    if (!k2 || len > avail) return 0;
+    size_t total = 1 + k1 + k2 + (size_t)len + BIN_TRAILER;
+    if (total > avail || get_u32le(buf + total - 4) != total - 4) return 0;
+    return total;
+}
+
+/* Read [start, size) and decode up to max records from it into recs.
+ * A record with a bad CRC but intact framing is skipped (the records
+ * around it are still where the trailers say); anything else bad ends
+ * the tail. Returns the buffer backing recs (caller frees);
+ * *clean is set when every byte decoded. */
+static uint8_t *bin_decode_tail(FILE *f, long start, long size, session_rec_t *recs,
+                                int max, int *count, bool *clean)
+{
+    size_t tail_len = (size_t)(size - start);
+    uint8_t *tail = heap_caps_malloc(tail_len ? tail_len : 1, MALLOC_CAP_SPIRAM);
+    *count = 0;
+    *clean = false;
+    if (!tail) return NULL;
+    fseek(f, start, SEEK_SET);
+    size_t got = fread(tail, 1, tail_len, f);
+
+    size_t off = 0;
+    while (off < got && *count < max) {
+        size_t n = bin_decode(tail + off, got - off, &recs[*count]);
+        if (n) {
+            (*count)++;
+        } else if ((n = bin_frame_len(tail + off, got - off)) != 0) {
+            ESP_LOGW(TAG, "Skipping record with a bad CRC at %ld", start + (long)off);
+        } else {
+            break;
+        }
+        off += n;
+    }
+    *clean = got == tail_len && off == got;
+    return tail;
+}
+
+static esp_err_t bin_read_tail(FILE *f, int max_records, session_rec_cb_t cb, void *ctx)
+{
+    if (!bin_check_magic(f)) return ESP_ERR_INVALID_STATE;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    if (max_records <= 0) return ESP_OK;
+
+    session_rec_t *recs = heap_caps_malloc(max_records * sizeof(session_rec_t), MALLOC_CAP_SPIRAM);
+    if (!recs) return ESP_ERR_NO_MEM;
+
+    /* Decode the tail before handing anything out, so a bad trailer,
+       length or CRC anywhere in it can still send us to the forward scan */
+    int count = 0;
+    bool clean = false;
+    uint8_t *tail = NULL;
+    long start = bin_walk_back(f, size, max_records);
+    if (start >= SESSION_BIN_MAGIC_LEN) {
+        tail = bin_decode_tail(f, start, size, recs, max_records, &count, &clean);
+        if (!tail) {
+            free(recs);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (!clean) {
+        ESP_LOGW(TAG, "Tail of the file does not decode, scanning forward");
+        free(tail);
+        start = bin_scan_tail_offset(f, size, max_records);
+        tail = bin_decode_tail(f, start, size, recs, max_records, &count, &clean);
+        if (!tail) {
+            free(recs);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    bool more = true;
+    if (start > SESSION_BIN_MAGIC_LEN) {
+        session_rec_t rec;
+        long next;
+        uint8_t *head = bin_read_at(f, SESSION_BIN_MAGIC_LEN, size, &rec, &next);
+        if (head && rec.role == SESSION_ROLE_SUMMARY) {
+            more = cb(&rec, ctx);
+        }
+        free(head);
+    }
+    for (int i = 0; more && i < count; i++) {
+        more = cb(&recs[i], ctx);
+    }
+    free(tail);
+    free(recs);
+    return ESP_OK;
+}
+
+/* ── Public ────────────────────────────────────────────────── */
+
+uint8_t *session_codec_encode(session_fmt_t fmt, const session_rec_t *rec, size_t *len_out)
+{
+    return fmt == SESSION_FMT_BIN ? bin_encode(rec, len_out) : jsonl_encode(rec, len_out);
+}
+
+esp_err_t session_codec_read_all(session_fmt_t fmt, FILE *f, session_rec_cb_t cb, void *ctx)
+{
+    return fmt == SESSION_FMT_BIN ? bin_read_all(f, cb, ctx) : jsonl_read_all(f, cb, ctx);
+}
+
+esp_err_t session_codec_read_tail(session_fmt_t fmt, FILE *f, int max_records,
+                                  session_rec_cb_t cb, void *ctx)
+{
+    return fmt == SESSION_FMT_BIN ? bin_read_tail(f, max_records, cb, ctx)
+                                  : jsonl_read_tail(f, max_records, cb, ctx);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * On-flash session record formats.
+ *
+ * JSONL: one {"role":...,"content":...,"ts":...} object per line.
+ *
+ * BIN: a magic header followed by length-prefixed records:
+ *
+ *   file   := "MSB1" record*
+ *   record := role:u8 ts:varint len:varint payload[len] crc:u32le size:u32le
+ *
+ * crc is CRC-32 over role..payload; size is the record length excluding
+ * the size field itself, so the tail can be found by walking back from EOF.
+ *
+ * In both formats a compacted file keeps its summary as the first record.
+ */
+
+#define SESSION_BIN_MAGIC      "MSB1"
+#define SESSION_BIN_MAGIC_LEN  4
+
+typedef enum {
+    SESSION_FMT_JSONL = 0,
+    SESSION_FMT_BIN,
+} session_fmt_t;
+
+typedef enum {
+    SESSION_ROLE_USER = 0,
+    SESSION_ROLE_ASSISTANT,
+    SESSION_ROLE_TOOL,
+    SESSION_ROLE_SUMMARY,
+} session_role_t;
+
+typedef struct {
+    uint8_t role;           /* session_role_t */
+    uint32_t ts;
+    const char *content;    /* NUL-terminated; valid only during a callback */
+    size_t len;
+} session_rec_t;
+
+/** Record callback; return false to stop reading. */
+typedef bool (*session_rec_cb_t)(const session_rec_t *rec, void *ctx);
+
+const char *session_role_name(uint8_t role);
+bool session_role_parse(const char *name, uint8_t *out);
+
+/**
+ * Bytes that start a new file of this format (BIN magic, nothing for JSONL).
+ * @return length written to buf (at most SESSION_BIN_MAGIC_LEN)
+ */
+size_t session_codec_header(session_fmt_t fmt, uint8_t *buf);
+
+/**
+ * Encode one record.
+ * @return PSRAM buffer owned by the caller, or NULL on allocation failure
+ */
+uint8_t *session_codec_encode(session_fmt_t fmt, const session_rec_t *rec, size_t *len_out);
+
+/**
+ * Call cb for every record of the file in order.
+ * Stops quietly at a truncated or corrupt BIN record.
+ */
+esp_err_t session_codec_read_all(session_fmt_t fmt, FILE *f, session_rec_cb_t cb, void *ctx);
+
+/**
+ * Call cb for the head summary record (when it lies outside the tail),
+ * then for the last max_records records. Cost does not grow with file size.
+ */
+esp_err_t session_codec_read_tail(session_fmt_t fmt, FILE *f, int max_records,
+                                  session_rec_cb_t cb, void *ctx);
@@ -1,163 +1,962 @@
 #include "session_mgr.h"
+#include "session_codec.h"
 #include "mimi_config.h"
+#include "storage/fs_backend.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_compress.h"
+#include "storage/fs_writer.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dirent.h>
 #include <time.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "cJSON.h"
+#include "llm/llm_proxy.h"
 
 static const char *TAG = "session";
 
+#if MIMI_SESSION_BINARY
+#define SESSION_FMT           SESSION_FMT_BIN
+#define SESSION_EXT           ".bin"
+#else
+#define SESSION_FMT           SESSION_FMT_JSONL
+#define SESSION_EXT           ".jsonl"
+#endif
+
+#define SUMMARY_MSG_CLIP      1500   /* Per-message cap in the summarizer transcript */
+#define SESSION_LOAD_RETRIES  2      /* Unlocked history loads before one under the lock */
+
+/* Tool transcript records share the tail with messages: at most one per turn. */
+#define TAIL_RECORDS  (MIMI_SESSION_LOG_TOOLS ? MIMI_SESSION_MAX_MSGS * 3 / 2 : MIMI_SESSION_MAX_MSGS)
+
+#define SUMMARY_SYSTEM_PROMPT \
+    "You maintain a running summary of a chat between a user and MimiClaw, " \
+    "a personal AI assistant. Merge the previous summary (if any) with the new " \
+    "conversation excerpt into one concise summary of at most 250 words. Keep names, " \
+    "preferences, decisions, open tasks and facts the assistant may need later. " \
+    "Write plain text in the third person, with no preamble."
+
 static void session_path(const char *chat_id, char *buf, size_t size)
 {
-    snprintf(buf, size, "%s/tg_%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
+    snprintf(buf, size, "%s/tg_%s" SESSION_EXT, MIMI_SPIFFS_SESSION_DIR, chat_id);
 }
 
-esp_err_t session_mgr_init(void)
+static bool is_chat_role(uint8_t role)
 {
-    ESP_LOGI(TAG, "Session manager initialized at %s", MIMI_SPIFFS_SESSION_DIR);
-    return ESP_OK;
+    return role == SESSION_ROLE_USER || role == SESSION_ROLE_ASSISTANT;
 }
 
-esp_err_t session_append(const char *chat_id, const char *role, const char *content)
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} text_buf_t;
+
+static bool text_buf_append(text_buf_t *tb, const char *s, size_t n)
+{
+    if (tb->len + n + 1 > tb->cap) {
+        size_t new_cap = tb->cap ? tb->cap * 2 : 4096;
+        while (new_cap < tb->len + n + 1) new_cap *= 2;
+        char *tmp = heap_caps_realloc(tb->data, new_cap, MALLOC_CAP_SPIRAM);
+        if (!tmp) return false;
+        tb->data = tmp;
+        tb->cap = new_cap;
+    }
+    memcpy(tb->data + tb->len, s, n);
+    tb->len += n;
+    tb->data[tb->len] = '\0';
+    return true;
+}
+
+static bool text_buf_append_record(text_buf_t *tb, const session_rec_t *rec)
+{
+    size_t n = 0;
+    uint8_t *enc = session_codec_encode(SESSION_FMT, rec, &n);
+    if (!enc) return false;
+    bool ok = text_buf_append(tb, (const char *)enc, n);
+    free(enc);
+    return ok;
+}
+
+static bool text_buf_append_header(text_buf_t *tb)
+{
+    uint8_t hdr[SESSION_BIN_MAGIC_LEN];
+    size_t n = session_codec_header(SESSION_FMT, hdr);
+    return n == 0 || text_buf_append(tb, (const char *)hdr, n);
+}
+
+/* ── Legacy migration ──────────────────────────────────────────
+ * With MIMI_SESSION_BINARY, a chat's JSONL file from older firmware is
+ * converted the first time the session is read or written. */
+
+#if MIMI_SESSION_BINARY
+static bool migrate_cb(const session_rec_t *rec, void *arg)
+{
+    return text_buf_append_record(arg, rec);
+}
+
+static void migrate_legacy(const char *chat_id)
+{
+    char old_path[64], path[64];
+    snprintf(old_path, sizeof(old_path), "%s/tg_%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
+
+    FILE *in = fopen(old_path, "r");
+    if (!in) return;
+
+    fseek(in, 0, SEEK_END);
+    long old_size = ftell(in);
+
+    text_buf_t tb = {0};
+    bool ok = text_buf_append_header(&tb);
+    if (ok) session_codec_read_all(SESSION_FMT_JSONL, in, migrate_cb, &tb);
+    fclose(in);
+
+    session_path(chat_id, path, sizeof(path));
+    if (ok && fs_write_atomic(path, tb.data, tb.len, FS_WRITER_SESSIONS) == ESP_OK) {
+        remove(old_path);
+        storage_notify(STORAGE_EVT_REMOVED, old_path);
+        ESP_LOGI(TAG, "Migrated session %s to binary (%ld -> %u bytes)",
+                 chat_id, old_size, (unsigned)tb.len);
+    } else {
+        ESP_LOGW(TAG, "Migration of session %s failed, keeping JSONL", chat_id);
+    }
+    free(tb.data);
+}
+#else
+static void migrate_legacy(const char *chat_id)
+{
+    (void)chat_id;
+}
+#endif
+
+/* ── Archive ───────────────────────────────────────────────────
+ * Sessions idle for MIMI_SESSION_ARCHIVE_DAYS are deflated to "<file>.z"
+ * by the storage maintenance pass, and inflated back the first time the
+ * chat is read or written again. */
+
+/* Bring an archived or legacy-format session back as the current file. */
+static void session_prepare(const char *chat_id)
 {
     char path[64];
     session_path(chat_id, path, sizeof(path));
+    fs_compress_restore(path);
+    migrate_legacy(chat_id);
+}
 
-    FILE *f = fopen(path, "a");
-    if (!f) {
-        ESP_LOGE(TAG, "Cannot open session file %s", path);
-        return ESP_FAIL;
+/* Held while a session file is appended to, rewritten or archived */
+static SemaphoreHandle_t s_file_lock = NULL;
+
+static bool chat_active(const char *chat_id);
+
+typedef struct {
+    time_t cutoff;
+    int archived;
+} archive_ctx_t;
+
+static bool on_archive_file(const char *path, void *arg)
+{
+    archive_ctx_t *ac = arg;
+    const char *name = path + strlen(MIMI_SPIFFS_SESSION_DIR "/tg_");
+    size_t len = strlen(path);
+    size_t ext_len = strlen(SESSION_EXT);
+    if (strncmp(path, MIMI_SPIFFS_SESSION_DIR "/tg_", name - path) != 0 ||
+        len <= (size_t)(name - path) + ext_len || strcmp(path + len - ext_len, SESSION_EXT) != 0) {
+        return true;
     }
+    char chat_id[32];
+    snprintf(chat_id, sizeof(chat_id), "%.*s", (int)(path + len - ext_len - name), name);
+
+    /* A chat in the history cache or with queued writes is in use */
+    if (chat_active(chat_id)) return true;
 
-    cJSON *obj = cJSON_CreateObject();
-    cJSON_AddStringToObject(obj, "role", role);
-    cJSON_AddStringToObject(obj, "content", content);
-    cJSON_AddNumberToObject(obj, "ts", (double)time(NULL));
+    xSemaphoreTake(s_file_lock, portMAX_DELAY);
+    struct stat st;
+    if (stat(path, &st) == 0 && st.st_mtime <= ac->cutoff &&
+        fs_compress_archive(path) == ESP_OK) {
+        ac->archived++;
+    }
+    xSemaphoreGive(s_file_lock);
+    return true;
+}
 
-    char *line = cJSON_PrintUnformatted(obj);
-    cJSON_Delete(obj);
+int session_archive_idle(void)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    if (tm.tm_year + 1900 < 2024) return 0;     /* Clock not set */
 
-    if (line) {
-        fprintf(f, "%s\n", line);
-        free(line);
+    session_flush();
+    archive_ctx_t ac = { .cutoff = now - (time_t)MIMI_SESSION_ARCHIVE_DAYS * 86400, .archived = 0 };
+    fs_list(MIMI_SPIFFS_SESSION_DIR "/", on_archive_file, &ac);
+    if (ac.archived) {
+        ESP_LOGI(TAG, "Archived %d idle session(s)", ac.archived);
     }
+    return ac.archived;
+}
 
-    fclose(f);
-    return ESP_OK;
+static void compact_cached(void);
+
+static void on_storage_event(storage_evt_t evt, const char *path)
+{
+#if MIMI_FS_COMPRESS
+    if (evt == STORAGE_EVT_MAINTENANCE) session_archive_idle();
+#endif
+    if (evt == STORAGE_EVT_IDLE) compact_cached();
 }
 
-esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs)
+/* ── History cache ─────────────────────────────────────────────
+ * Recent tails of active chats live in PSRAM, keyed by chat_id.
+ * session_append_turn() writes through, so a hit needs no flash read and
+ * no record decoding. Bounded by MIMI_SESSION_CACHE_BYTES, LRU eviction. */
+
+typedef struct {
+    uint8_t role;       /* SESSION_ROLE_USER or SESSION_ROLE_ASSISTANT */
+    char *content;
+} cached_msg_t;
+
+typedef struct {
+    bool valid;
+    char chat_id[32];
+    char *summary;
+    cached_msg_t msgs[MIMI_SESSION_MAX_MSGS];   /* ring buffer */
+    int head;
+    int count;
+    size_t bytes;
+    uint32_t last_used;
+} cache_entry_t;
+
+static cache_entry_t s_cache[MIMI_SESSION_CACHE_SLOTS];
+static uint32_t s_cache_tick = 0;
+static uint32_t s_cache_gen = 0;    /* Bumped when a chat's file changes behind the cache */
+static session_cache_stats_t s_stats = {0};
+static SemaphoreHandle_t s_cache_lock = NULL;
+
+static char *psram_strdup(const char *src, size_t *len_out)
 {
+    size_t len = strlen(src);
+    char *dst = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (dst) {
+        memcpy(dst, src, len + 1);
+        *len_out = len + 1;
+    }
+    return dst;
+}
+
+static void cache_entry_reset(cache_entry_t *e)
+{
+    for (int i = 0; i < e->count; i++) {
+        free(e->msgs[(e->head + i) % MIMI_SESSION_MAX_MSGS].content);
+    }
+    free(e->summary);
+    memset(e, 0, sizeof(*e));
+}
+
+static void cache_push(cache_entry_t *e, uint8_t role, const char *content)
+{
+    size_t len = 0;
+    char *copy = psram_strdup(content, &len);
+    if (!copy) return;
+
+    int slot;
+    if (e->count < MIMI_SESSION_MAX_MSGS) {
+        slot = (e->head + e->count) % MIMI_SESSION_MAX_MSGS;
+        e->count++;
+    } else {
+        slot = e->head;
+        e->bytes -= strlen(e->msgs[slot].content) + 1;
+        free(e->msgs[slot].content);
+        e->head = (e->head + 1) % MIMI_SESSION_MAX_MSGS;
+    }
+    e->msgs[slot].role = role;
+    e->msgs[slot].content = copy;
+    e->bytes += len;
+}
+
+static void cache_set_summary(cache_entry_t *e, const char *summary)
+{
+    if (e->summary) {
+        e->bytes -= strlen(e->summary) + 1;
+        free(e->summary);
+        e->summary = NULL;
+    }
+    size_t len = 0;
+    e->summary = psram_strdup(summary, &len);
+    e->bytes += len;
+}
+
+static cache_entry_t *cache_find(const char *chat_id)
+{
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (s_cache[i].valid && strcmp(s_cache[i].chat_id, chat_id) == 0) {
+            s_cache[i].last_used = ++s_cache_tick;
+            return &s_cache[i];
+        }
+    }
+    return NULL;
+}
+
+static cache_entry_t *cache_lru(const cache_entry_t *keep)
+{
+    cache_entry_t *victim = NULL;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        cache_entry_t *e = &s_cache[i];
+        if (!e->valid || e == keep) continue;
+        if (!victim || e->last_used < victim->last_used) victim = e;
+    }
+    return victim;
+}
+
+static void cache_evict(cache_entry_t *e)
+{
+    ESP_LOGD(TAG, "Evicting cached session %s (%u bytes)", e->chat_id, (unsigned)e->bytes);
+    cache_entry_reset(e);
+    s_stats.evictions++;
+}
+
+static size_t cache_bytes(void)
+{
+    size_t total = 0;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (s_cache[i].valid) total += s_cache[i].bytes;
+    }
+    return total;
+}
+
+/* Keep total cached bytes under budget; never evicts the entry in use. */
+static void cache_trim(const cache_entry_t *keep)
+{
+    while (cache_bytes() > MIMI_SESSION_CACHE_BYTES) {
+        cache_entry_t *victim = cache_lru(keep);
+        if (!victim) break;
+        cache_evict(victim);
+    }
+}
+
+/* Caller holds s_cache_lock. Moves a loaded entry into a slot. */
+static cache_entry_t *cache_insert(const cache_entry_t *loaded)
+{
+    cache_entry_t *slot = NULL;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (!s_cache[i].valid) {
+            slot = &s_cache[i];
+            break;
+        }
+    }
+    if (!slot) {
+        slot = cache_lru(NULL);
+        cache_evict(slot);
+    }
+
+    *slot = *loaded;
+    slot->valid = true;
+    slot->last_used = ++s_cache_tick;
+    return slot;
+}
+
+static void cache_invalidate(const char *chat_id)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    cache_entry_t *e = cache_find(chat_id);
+    if (e) cache_entry_reset(e);
+    s_cache_gen++;
+    xSemaphoreGive(s_cache_lock);
+}
+
+static bool cache_load_cb(const session_rec_t *rec, void *arg)
+{
+    cache_entry_t *e = arg;
+    if (rec->role == SESSION_ROLE_SUMMARY) {
+        if (rec->content[0]) cache_set_summary(e, rec->content);
+    } else if (is_chat_role(rec->role)) {
+        cache_push(e, rec->role, rec->content);
+    }
+    return true;
+}
+
+/*
+ * Fill a detached cache entry from the head summary and last TAIL_RECORDS
+ * records. Reads flash, so it runs without s_cache_lock.
+ */
+static esp_err_t cache_load(cache_entry_t *e, const char *chat_id)
+{
+    strncpy(e->chat_id, chat_id, sizeof(e->chat_id) - 1);
+
     char path[64];
     session_path(chat_id, path, sizeof(path));
 
+    /* The archive pass must not pack the file while it is restored or read */
+    xSemaphoreTake(s_file_lock, portMAX_DELAY);
+    session_prepare(chat_id);
     FILE *f = fopen(path, "r");
     if (!f) {
-        /* No history yet */
-        snprintf(buf, size, "[]");
+        /* No history yet: cache the empty session too */
+        xSemaphoreGive(s_file_lock);
         return ESP_OK;
     }
+    esp_err_t err = session_codec_read_tail(SESSION_FMT, f, TAIL_RECORDS, cache_load_cb, e);
+    fclose(f);
+    xSemaphoreGive(s_file_lock);
+    return err;
+}
 
-    /* Read all lines into a ring buffer of cJSON objects */
-    cJSON *messages[MIMI_SESSION_MAX_MSGS];
-    int count = 0;
-    int write_idx = 0;
+/* ── Write path ────────────────────────────────────────────────
+ * A turn is serialized into one buffer and written with a single
+ * fopen/fwrite/fclose. Unless the caller asks for SESSION_WRITE_SYNC,
+ * the buffer is handed to a low-priority writer task so the flash write
+ * happens while the agent is idle. Readers of the file call
+ * session_flush() first, so they never see it behind the cache. */
 
-    char line[2048];
-    while (fgets(line, sizeof(line), f)) {
-        /* Strip newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
-        if (line[0] == '\0') continue;
+typedef struct {
+    char chat_id[32];
+    char *data;         /* Encoded records, PSRAM */
+    size_t len;
+} pending_write_t;
 
-        cJSON *obj = cJSON_Parse(line);
-        if (!obj) continue;
+static QueueHandle_t s_write_queue = NULL;
+static atomic_int s_writes_pending = 0;
+static atomic_int s_bytes_pending = 0;     /* Queued bytes, all chats */
+
+static esp_err_t write_records(const char *chat_id, const char *data, size_t len)
+{
+    char path[64];
+    session_path(chat_id, path, sizeof(path));
 
-        /* Ring buffer: overwrite oldest if full */
-        if (count >= max_msgs) {
-            cJSON_Delete(messages[write_idx]);
+    /* A new file starts with the format header. The archive pass must not
+       pack the file between the restore and the append. */
+    xSemaphoreTake(s_file_lock, portMAX_DELAY);
+    uint8_t hdr[SESSION_BIN_MAGIC_LEN];
+    size_t hdr_len = 0;
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size == 0) {
+        session_prepare(chat_id);
+        if (stat(path, &st) != 0 || st.st_size == 0) {
+            hdr_len = session_codec_header(SESSION_FMT, hdr);
         }
-        messages[write_idx] = obj;
-        write_idx = (write_idx + 1) % max_msgs;
-        if (count < max_msgs) count++;
     }
+
+    int64_t start = esp_timer_get_time();
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        xSemaphoreGive(s_file_lock);
+        ESP_LOGE(TAG, "Cannot open session file %s", path);
+        return ESP_FAIL;
+    }
+    size_t written = hdr_len ? fwrite(hdr, 1, hdr_len, f) : 0;
+    written += fwrite(data, 1, len, f);
     fclose(f);
+    xSemaphoreGive(s_file_lock);
+    storage_note_write(path, start);
+    storage_notify(STORAGE_EVT_CHANGED, path);
+
+    if (written != hdr_len + len) {
+        ESP_LOGE(TAG, "Short write to %s (%u of %u bytes)", path,
+                 (unsigned)written, (unsigned)(hdr_len + len));
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+#if MIMI_SESSION_WRITE_BEHIND
+static void session_writer_task(void *arg)
+{
+    pending_write_t w;
+    while (1) {
+        if (xQueueReceive(s_write_queue, &w, portMAX_DELAY) != pdTRUE) continue;
+        write_records(w.chat_id, w.data, w.len);
+        free(w.data);
+        atomic_fetch_sub(&s_bytes_pending, (int)w.len);
+        atomic_fetch_sub(&s_writes_pending, 1);
+    }
+}
+#endif
 
-    /* Build JSON array with only role + content */
-    cJSON *arr = cJSON_CreateArray();
-    int start = (count < max_msgs) ? 0 : write_idx;
+/* True if the chat has a cached tail or any session write is queued. */
+static bool chat_active(const char *chat_id)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    bool active = atomic_load(&s_writes_pending) > 0;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS && !active; i++) {
+        active = s_cache[i].valid && strcmp(s_cache[i].chat_id, chat_id) == 0;
+    }
+    xSemaphoreGive(s_cache_lock);
+    return active;
+}
+
+void session_flush(void)
+{
+    while (atomic_load(&s_writes_pending) > 0) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+esp_err_t session_mgr_init(void)
+{
+    s_cache_lock = xSemaphoreCreateMutex();
+    s_file_lock = xSemaphoreCreateMutex();
+    if (!s_cache_lock || !s_file_lock) return ESP_ERR_NO_MEM;
+
+#if MIMI_SESSION_WRITE_BEHIND
+    s_write_queue = xQueueCreate(MIMI_SESSION_WRITE_QUEUE, sizeof(pending_write_t));
+    if (!s_write_queue ||
+        xTaskCreatePinnedToCore(session_writer_task, "session_wr",
+                                MIMI_SESSION_WRITER_STACK, NULL,
+                                MIMI_SESSION_WRITER_PRIO, NULL,
+                                MIMI_SESSION_WRITER_CORE) != pdPASS) {
+        /* Not fatal: every write just goes through synchronously */
+        ESP_LOGW(TAG, "Session writer unavailable, using synchronous writes");
+        if (s_write_queue) vQueueDelete(s_write_queue);
+        s_write_queue = NULL;
+    }
+#endif
+
+    ESP_LOGI(TAG, "Session manager initialized at %s (%s, cache: %d slots, %d KB, %s writes)",
+             MIMI_SPIFFS_SESSION_DIR, SESSION_FMT == SESSION_FMT_BIN ? "binary" : "jsonl",
+             MIMI_SESSION_CACHE_SLOTS, MIMI_SESSION_CACHE_BYTES / 1024,
+             s_write_queue ? "write-behind" : "sync");
+    storage_add_listener(on_storage_event);
+    return ESP_OK;
+}
+
+esp_err_t session_append_turn(const char *chat_id, const session_record_t *records,
+                              int count, uint32_t flags)
+{
+    if (!chat_id || !records || count <= 0) return ESP_ERR_INVALID_ARG;
+
+    text_buf_t tb = {0};
+    uint32_t now = (uint32_t)time(NULL);
     for (int i = 0; i < count; i++) {
-        int idx = (start + i) % max_msgs;
-        cJSON *src = messages[idx];
+        session_rec_t rec = { .ts = now, .content = records[i].content };
+        if (!rec.content || !session_role_parse(records[i].role, &rec.role)) {
+            ESP_LOGW(TAG, "Skipping record with role %s",
+                     records[i].role ? records[i].role : "(null)");
+            continue;
+        }
+        rec.len = strlen(rec.content);
+        if (!text_buf_append_record(&tb, &rec)) {
+            free(tb.data);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (tb.len == 0) return ESP_OK;
 
-        cJSON *entry = cJSON_CreateObject();
-        cJSON *role = cJSON_GetObjectItem(src, "role");
-        cJSON *content = cJSON_GetObjectItem(src, "content");
-        if (role && content) {
-            cJSON_AddStringToObject(entry, "role", role->valuestring);
-            cJSON_AddStringToObject(entry, "content", content->valuestring);
+    bool queued = false;
+    if (!(flags & SESSION_WRITE_SYNC) && s_write_queue) {
+        pending_write_t w = { .data = tb.data, .len = tb.len };
+        strncpy(w.chat_id, chat_id, sizeof(w.chat_id) - 1);
+        atomic_fetch_add(&s_writes_pending, 1);
+        atomic_fetch_add(&s_bytes_pending, (int)tb.len);
+        if (xQueueSend(s_write_queue, &w, 0) == pdTRUE) {
+            queued = true;
+        } else {
+            atomic_fetch_sub(&s_bytes_pending, (int)tb.len);
+            atomic_fetch_sub(&s_writes_pending, 1);
         }
-        cJSON_AddItemToArray(arr, entry);
     }
 
-    /* Cleanup ring buffer */
-    int cleanup_start = (count < max_msgs) ? 0 : write_idx;
-    for (int i = 0; i < count; i++) {
-        int idx = (cleanup_start + i) % max_msgs;
-        cJSON_Delete(messages[idx]);
+    if (!queued) {
+        /* Land behind any queued turns so the file stays in order */
+        session_flush();
+        esp_err_t err = write_records(chat_id, tb.data, tb.len);
+        free(tb.data);
+        if (err != ESP_OK) return err;
     }
 
-    char *json_str = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
+    /* Write-through: keep a cached tail in step with the file */
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    cache_entry_t *e = cache_find(chat_id);
+    if (e) {
+        for (int i = 0; i < count; i++) {
+            uint8_t role;
+            if (records[i].content && session_role_parse(records[i].role, &role) &&
+                is_chat_role(role)) {
+                cache_push(e, role, records[i].content);
+            }
+        }
+        cache_trim(e);
+    } else {
+        /* A history load in progress for this chat may have missed it */
+        s_cache_gen++;
+    }
+    xSemaphoreGive(s_cache_lock);
+    return ESP_OK;
+}
+
+esp_err_t session_append(const char *chat_id, const char *role, const char *content)
+{
+    session_record_t rec = { .role = role, .content = content };
+    return session_append_turn(chat_id, &rec, 1, SESSION_WRITE_SYNC);
+}
+
+/* The summary is replayed as a user/assistant exchange so roles keep alternating. */
+static void add_summary_messages(cJSON *arr, const char *summary)
+{
+    size_t len = strlen(summary) + 64;
+    char *text = malloc(len);
+    if (!text) return;
+    snprintf(text, len, "[Summary of our earlier conversation]\n%s", summary);
+
+    cJSON *user = cJSON_CreateObject();
+    cJSON_AddStringToObject(user, "role", "user");
+    cJSON_AddStringToObject(user, "content", text);
+    cJSON_AddItemToArray(arr, user);
+    free(text);
+
+    cJSON *asst = cJSON_CreateObject();
+    cJSON_AddStringToObject(asst, "role", "assistant");
+    cJSON_AddStringToObject(asst, "content", "Got it, I'll keep that context in mind.");
+    cJSON_AddItemToArray(arr, asst);
+}
 
-    if (json_str) {
-        strncpy(buf, json_str, size - 1);
-        buf[size - 1] = '\0';
-        free(json_str);
+esp_err_t session_get_history(const char *chat_id, cJSON *messages, int max_msgs)
+{
+    if (!messages || !cJSON_IsArray(messages)) return ESP_ERR_INVALID_ARG;
+    if (max_msgs > MIMI_SESSION_MAX_MSGS) max_msgs = MIMI_SESSION_MAX_MSGS;
+
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    cache_entry_t *e = cache_find(chat_id);
+    if (e) {
+        s_stats.hits++;
     } else {
-        snprintf(buf, size, "[]");
+        s_stats.misses++;
+    }
+
+    /* A miss reads flash without the lock, so other chats are served
+       meanwhile. If a write or compaction lands behind the load, it may
+       be stale: load again, and after SESSION_LOAD_RETRIES under the lock. */
+    for (int attempt = 0; !e; attempt++) {
+        bool locked = attempt == SESSION_LOAD_RETRIES;
+        uint32_t gen = s_cache_gen;
+        if (!locked) xSemaphoreGive(s_cache_lock);
+
+        session_flush();
+        cache_entry_t loaded = {0};
+        if (cache_load(&loaded, chat_id) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to load session %s", chat_id);
+        }
+
+        if (!locked) {
+            xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+            /* Another caller cached it first, or the load is stale */
+            e = cache_find(chat_id);
+            if (e || gen != s_cache_gen) {
+                cache_entry_reset(&loaded);
+                continue;
+            }
+        }
+        e = cache_insert(&loaded);
+        cache_trim(e);
+    }
+
+    /* Append role + content records straight into the caller's array */
+    if (e->summary) {
+        add_summary_messages(messages, e->summary);
+    }
+    int skip = e->count > max_msgs ? e->count - max_msgs : 0;
+    for (int i = skip; i < e->count; i++) {
+        const cached_msg_t *m = &e->msgs[(e->head + i) % MIMI_SESSION_MAX_MSGS];
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "role", session_role_name(m->role));
+        cJSON_AddStringToObject(entry, "content", m->content);
+        cJSON_AddItemToArray(messages, entry);
+    }
+
+    xSemaphoreGive(s_cache_lock);
+    return ESP_OK;
+}
+
+void session_cache_get_stats(session_cache_stats_t *out)
+{
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    *out = s_stats;
+    out->bytes = cache_bytes();
+    out->entries = 0;
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (s_cache[i].valid) out->entries++;
+    }
+    xSemaphoreGive(s_cache_lock);
+}
+
+/* ── Compaction ───────────────────────────────────────────────── */
+
+typedef struct {
+    uint8_t role;
+    uint32_t ts;
+    char *content;
+} stored_rec_t;
+
+typedef struct {
+    stored_rec_t *items;
+    int count;
+    int cap;
+    char *summary;
+} rec_list_t;
+
+static bool collect_cb(const session_rec_t *rec, void *arg)
+{
+    rec_list_t *list = arg;
+    size_t len = 0;
+
+    if (rec->role == SESSION_ROLE_SUMMARY) {
+        free(list->summary);
+        list->summary = psram_strdup(rec->content, &len);
+        return true;
+    }
+
+    if (list->count == list->cap) {
+        int new_cap = list->cap ? list->cap * 2 : 32;
+        stored_rec_t *tmp = heap_caps_realloc(list->items, new_cap * sizeof(stored_rec_t),
+                                              MALLOC_CAP_SPIRAM);
+        if (!tmp) return false;
+        list->items = tmp;
+        list->cap = new_cap;
+    }
+    char *copy = psram_strdup(rec->content, &len);
+    if (!copy) return false;
+    list->items[list->count++] = (stored_rec_t){ rec->role, rec->ts, copy };
+    return true;
+}
+
+static void rec_list_free(rec_list_t *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].content);
+    }
+    free(list->items);
+    free(list->summary);
+}
+
+static char *summarize_records(const rec_list_t *list, int fold_count)
+{
+    text_buf_t tb = {0};
+    static const char intro[] = "Update the running summary with this conversation excerpt.\n\n";
+    bool ok = text_buf_append(&tb, intro, sizeof(intro) - 1);
+
+    if (ok && list->summary && list->summary[0]) {
+        ok = text_buf_append(&tb, "Previous summary:\n", 18) &&
+             text_buf_append(&tb, list->summary, strlen(list->summary)) &&
+             text_buf_append(&tb, "\n\n", 2);
+    }
+    ok = ok && text_buf_append(&tb, "Conversation:\n", 14);
+
+    for (int i = 0; ok && i < fold_count; i++) {
+        const stored_rec_t *rec = &list->items[i];
+        const char *role = session_role_name(rec->role);
+
+        size_t clen = strlen(rec->content);
+        bool clipped = clen > SUMMARY_MSG_CLIP;
+        if (clipped) clen = SUMMARY_MSG_CLIP;
+
+        ok = text_buf_append(&tb, role, strlen(role)) &&
+             text_buf_append(&tb, ": ", 2) &&
+             text_buf_append(&tb, rec->content, clen) &&
+             (!clipped || text_buf_append(&tb, " ...", 4)) &&
+             text_buf_append(&tb, "\n", 1);
+    }
+
+    if (!ok) {
+        free(tb.data);
+        return NULL;
+    }
+
+    cJSON *msgs = cJSON_CreateArray();
+    cJSON *user = cJSON_CreateObject();
+    cJSON_AddStringToObject(user, "role", "user");
+    cJSON_AddStringToObject(user, "content", tb.data);
+    cJSON_AddItemToArray(msgs, user);
+    free(tb.data);
+
+    char *msgs_json = cJSON_PrintUnformatted(msgs);
+    cJSON_Delete(msgs);
+    if (!msgs_json) return NULL;
+
+    char *summary = heap_caps_calloc(1, MIMI_SESSION_SUMMARY_MAX, MALLOC_CAP_SPIRAM);
+    if (!summary) {
+        free(msgs_json);
+        return NULL;
+    }
+
+    esp_err_t err = llm_chat_model(MIMI_SESSION_SUMMARY_MODEL, SUMMARY_SYSTEM_PROMPT,
+                                   msgs_json, summary, MIMI_SESSION_SUMMARY_MAX);
+    free(msgs_json);
+    if (err != ESP_OK || summary[0] == '\0') {
+        ESP_LOGW(TAG, "Summarizer call failed: %s", esp_err_to_name(err));
+        free(summary);
+        return NULL;
+    }
+    return summary;
+}
+
+esp_err_t session_compact(const char *chat_id)
+{
+    char path[64];
+    session_path(chat_id, path, sizeof(path));
+
+    /* Called after every turn: decide from the file size plus what is
+       still queued before waiting for the writer, so a session under the
+       threshold costs one stat and write-behind keeps working. An archived
+       session has no current file and nothing to fold. */
+    struct stat st;
+    if (stat(path, &st) != 0 ||
+        st.st_size + atomic_load(&s_bytes_pending) < MIMI_SESSION_COMPACT_BYTES) {
+        return ESP_OK;
     }
 
+    session_flush();
+    xSemaphoreTake(s_file_lock, portMAX_DELAY);
+    session_prepare(chat_id);
+    if (stat(path, &st) != 0 || st.st_size < MIMI_SESSION_COMPACT_BYTES) {
+        xSemaphoreGive(s_file_lock);
+        return ESP_OK;
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        xSemaphoreGive(s_file_lock);
+        return ESP_FAIL;
+    }
+    rec_list_t list = {0};
+    session_codec_read_all(SESSION_FMT, f, collect_cb, &list);
+    fclose(f);
+    xSemaphoreGive(s_file_lock);
+    off_t read_size = st.st_size;
+
+    /* Only fold once there is a meaningful batch, so we do not pay
+       for a summarizer call on every turn of a chatty session. */
+    int total = list.count;
+    int fold = total - MIMI_SESSION_COMPACT_KEEP;
+    if (fold < MIMI_SESSION_COMPACT_KEEP) {
+        rec_list_free(&list);
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Compacting session %s (%ld bytes, folding %d of %d records)",
+             chat_id, (long)st.st_size, fold, total);
+
+    char *summary = summarize_records(&list, fold);
+    if (!summary) {
+        rec_list_free(&list);
+        return ESP_FAIL;
+    }
+
+    /* Rewrite as: summary record + recent tail */
+    text_buf_t tb = {0};
+    session_rec_t sum_rec = {
+        .role = SESSION_ROLE_SUMMARY,
+        .ts = (uint32_t)time(NULL),
+        .content = summary,
+        .len = strlen(summary),
+    };
+    bool ok = text_buf_append_header(&tb) && text_buf_append_record(&tb, &sum_rec);
+    free(summary);
+
+    for (int i = fold; ok && i < total; i++) {
+        const stored_rec_t *src = &list.items[i];
+        session_rec_t rec = { src->role, src->ts, src->content, strlen(src->content) };
+        ok = text_buf_append_record(&tb, &rec);
+    }
+    rec_list_free(&list);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Out of memory compacting session %s", chat_id);
+        free(tb.data);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Turns keep running during the summary: if one was appended since the
+       read, the rewrite would lose it, so leave it to the next pass */
+    xSemaphoreTake(s_file_lock, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    if (stat(path, &st) == 0 && st.st_size == read_size) {
+        err = fs_write_atomic(path, tb.data, tb.len, FS_WRITER_SESSIONS);
+    }
+    xSemaphoreGive(s_file_lock);
+    free(tb.data);
+    if (err == ESP_ERR_INVALID_STATE) {
+        ESP_LOGI(TAG, "Session %s grew while compacting, retrying later", chat_id);
+        return ESP_OK;
+    }
+    cache_invalidate(chat_id);
+    if (err != ESP_OK) return err;
+
+    if (stat(path, &st) == 0) {
+        ESP_LOGI(TAG, "Session %s compacted to %ld bytes", chat_id, (long)st.st_size);
+    }
     return ESP_OK;
 }
 
+/* Every chat with a cached tail has been active recently enough to have grown. */
+static void compact_cached(void)
+{
+    char ids[MIMI_SESSION_CACHE_SLOTS][32];
+    int n = 0;
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    for (int i = 0; i < MIMI_SESSION_CACHE_SLOTS; i++) {
+        if (s_cache[i].valid) strcpy(ids[n++], s_cache[i].chat_id);
+    }
+    xSemaphoreGive(s_cache_lock);
+
+    for (int i = 0; i < n; i++) {
+        if (session_compact(ids[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "Session compaction failed for chat %s", ids[i]);
+        }
+    }
+}
+
 esp_err_t session_clear(const char *chat_id)
 {
     char path[64];
     session_path(chat_id, path, sizeof(path));
 
+    session_flush();
+    cache_invalidate(chat_id);
+
+    bool removed = remove(path) == 0;
+    if (removed) storage_notify(STORAGE_EVT_REMOVED, path);
+    char zpath[72];
+    snprintf(zpath, sizeof(zpath), "%s" FS_COMPRESS_EXT, path);
+    if (remove(zpath) == 0) {
+        storage_notify(STORAGE_EVT_REMOVED, zpath);
+        removed = true;
+    }
+#if MIMI_SESSION_BINARY
+    snprintf(path, sizeof(path), "%s/tg_%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
     if (remove(path) == 0) {
+        storage_notify(STORAGE_EVT_REMOVED, path);
+        removed = true;
+    }
+#endif
+    if (removed) {
         ESP_LOGI(TAG, "Session %s cleared", chat_id);
         return ESP_OK;
     }
     return ESP_ERR_NOT_FOUND;
 }
 
-void session_list(void)
+static bool on_session_file(const char *path, void *arg)
 {
-    DIR *dir = opendir(MIMI_SPIFFS_SESSION_DIR);
-    if (!dir) {
-        /* SPIFFS is flat, so list all files matching pattern */
-        dir = opendir(MIMI_SPIFFS_BASE);
-        if (!dir) {
-            ESP_LOGW(TAG, "Cannot open SPIFFS directory");
-            return;
-        }
+    int *count = arg;
+    const char *name = path + strlen(MIMI_SPIFFS_SESSION_DIR "/");
+    if (strstr(name, "tg_") && (strstr(name, ".jsonl") || strstr(name, ".bin"))) {
+        ESP_LOGI(TAG, "  Session: %s", name);
+        (*count)++;
     }
+    return true;
+}
 
-    struct dirent *entry;
+void session_list(void)
+{
     int count = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strstr(entry->d_name, "tg_") && strstr(entry->d_name, ".jsonl")) {
-            ESP_LOGI(TAG, "  Session: %s", entry->d_name);
-            count++;
-        }
-    }
-    closedir(dir);
+    fs_list(MIMI_SPIFFS_SESSION_DIR "/", on_session_file, &count);
 
     if (count == 0) {
         ESP_LOGI(TAG, "  No sessions found");
@@ -1,15 +1,34 @@
 #pragma once
 
 #include "esp_err.h"
+#include "cJSON.h"
 #include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    size_t bytes;       /* PSRAM held by cached history */
+    int entries;
+} session_cache_stats_t;
+
+/** One record of a turn, written in order by session_append_turn(). */
+typedef struct {
+    const char *role;       /* "user", "assistant" or "tool" */
+    const char *content;
+} session_record_t;
+
+/* session_append_turn() flags */
+#define SESSION_WRITE_SYNC   (1u << 0)   /* On flash before returning */
 
 /**
- * Initialize session manager.
+ * Initialize session manager (and the write-behind task if enabled).
  */
 esp_err_t session_mgr_init(void);
 
 /**
- * Append a message to a session file (JSONL format).
+ * Append a message to a session file (JSONL format). Written synchronously.
  * @param chat_id   Session identifier (e.g., "12345")
  * @param role      "user" or "assistant"
  * @param content   Message text
@@ -17,19 +36,65 @@ esp_err_t session_mgr_init(void);
 esp_err_t session_append(const char *chat_id, const char *role, const char *content);
 
 /**
- * Load session history as a JSON array string suitable for LLM messages.
- * Returns the last max_msgs messages as:
- * [{"role":"user","content":"..."},{"role":"assistant","content":"..."},...]
+ * Append all records of one turn with a single open and write.
+ * "tool" records are kept in the file as a transcript but are not
+ * replayed by session_get_history().
+ *
+ * Without SESSION_WRITE_SYNC the write is queued to a background task
+ * (MIMI_SESSION_WRITE_BEHIND); the history cache is updated either way.
  *
  * @param chat_id   Session identifier
- * @param buf       Output buffer (caller allocates)
- * @param size      Buffer size
+ * @param records   Records in file order
+ * @param count     Number of records
+ * @param flags     SESSION_WRITE_SYNC or 0
+ */
+esp_err_t session_append_turn(const char *chat_id, const session_record_t *records,
+                              int count, uint32_t flags);
+
+/**
+ * Block until all queued session writes are on flash.
+ */
+void session_flush(void);
+
+/**
+ * Append the last max_msgs messages of a session to a cJSON messages array,
+ * each as {"role":"user"|"assistant","content":"..."}. If the session has
+ * been compacted, the summary is prepended as one user/assistant exchange.
+ * No intermediate JSON text is produced.
+ *
+ * @param chat_id   Session identifier
+ * @param messages  cJSON array to append to (caller owns)
  * @param max_msgs  Maximum number of messages to return
  */
-esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs);
+esp_err_t session_get_history(const char *chat_id, cJSON *messages, int max_msgs);
+
+/**
+ * Fold older messages into a single summary record once the session file
+ * grows past MIMI_SESSION_COMPACT_BYTES, keeping the last
+ * MIMI_SESSION_COMPACT_KEEP messages verbatim. Below the threshold it
+ * only stats the file, without waiting for queued writes. Makes a blocking
+ * LLM call; the storage task runs it for every cached chat on
+ * STORAGE_EVT_IDLE, and a turn appended meanwhile defers it to the next pass.
+ */
+esp_err_t session_compact(const char *chat_id);
+
+/**
+ * Compress session files untouched for MIMI_SESSION_ARCHIVE_DAYS into
+ * "<file>.z". They are inflated back on the chat's next read or write.
+ * Chats in the history cache, or any with writes still queued, are left
+ * for a later pass. Runs on each storage maintenance pass when
+ * MIMI_FS_COMPRESS is set.
+ * @return number of sessions archived
+ */
+int session_archive_idle(void);
+
+/**
+ * Snapshot of the in-memory history cache counters.
+ */
+void session_cache_get_stats(session_cache_stats_t *out);
 
 /**
- * Clear a session (delete the file).
+ * Clear a session (delete the file and any archive of it).
  */
 esp_err_t session_clear(const char *chat_id);
 
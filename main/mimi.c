@@ -6,7 +6,6 @@
 #include "esp_event.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
-#include "esp_spiffs.h"
 #include "nvs_flash.h"
 
 #include "mimi_config.h"
@@ -17,6 +16,13 @@
 #include "agent/agent_loop.h"
 #include "memory/memory_store.h"
 #include "memory/session_mgr.h"
+#include "memory/memory_kv.h"
+#include "memory/memory_dedup.h"
+#include "memory/memory_rollup.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/assets.h"
+#include "search/search_index.h"
 #include "gateway/ws_server.h"
 #include "cli/serial_cli.h"
 #include "proxy/http_proxy.h"
@@ -26,6 +32,7 @@
 #include "buttons/button_driver.h"
 #include "imu/imu_manager.h"
 #include "skills/skill_loader.h"
+#include "clock/clock_service.h"
 
 static const char *TAG = "mimi";
 
@@ -40,28 +47,6 @@ static esp_err_t init_nvs(void)
     return ret;
 }
 
-static esp_err_t init_spiffs(void)
-{
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = MIMI_SPIFFS_BASE,
-        .partition_label = NULL,
-        .max_files = 10,
-        .format_if_mount_failed = true,
-    };
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "SPIFFS mount failed: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    size_t total = 0, used = 0;
-    esp_spiffs_info(NULL, &total, &used);
-    ESP_LOGI(TAG, "SPIFFS: total=%d, used=%d", (int)total, (int)used);
-
-    return ESP_OK;
-}
-
 /* Outbound dispatch task: reads from outbound queue and routes to channels */
 static void outbound_dispatch_task(void *arg)
 {
@@ -118,13 +103,20 @@ void app_main(void)
     /* Phase 1: Core infrastructure */
     ESP_ERROR_CHECK(init_nvs());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    ESP_ERROR_CHECK(init_spiffs());
+    ESP_ERROR_CHECK(clock_service_init());
+    ESP_ERROR_CHECK(fs_mount());
+    assets_init();      /* Without it the device runs on user skills alone */
 
     /* Initialize subsystems */
     ESP_ERROR_CHECK(message_bus_init());
     ESP_ERROR_CHECK(memory_store_init());
     ESP_ERROR_CHECK(skill_loader_init());
     ESP_ERROR_CHECK(session_mgr_init());
+    ESP_ERROR_CHECK(storage_mgr_init());
+    ESP_ERROR_CHECK(search_index_init());
+    ESP_ERROR_CHECK(memory_kv_init());
+    ESP_ERROR_CHECK(memory_dedup_init());
+    ESP_ERROR_CHECK(memory_rollup_init());
     ESP_ERROR_CHECK(wifi_manager_init());
     ESP_ERROR_CHECK(http_proxy_init());
     ESP_ERROR_CHECK(telegram_bot_init());
@@ -137,6 +129,9 @@ void app_main(void)
     /* Start Serial CLI first (works without WiFi) */
     ESP_ERROR_CHECK(serial_cli_init());
 
+    /* Quota enforcement runs offline too */
+    storage_mgr_start();
+
     /* Start WiFi */
     esp_err_t wifi_err = wifi_manager_start();
     if (wifi_err == ESP_OK) {
@@ -145,6 +140,7 @@ void app_main(void)
         ESP_LOGI(TAG, "Waiting for WiFi connection...");
         if (wifi_manager_wait_connected(30000) == ESP_OK) {
             ESP_LOGI(TAG, "WiFi connected: %s", wifi_manager_get_ip());
+            clock_service_start();
 
             /* Outbound dispatch task should start first to avoid dropping early replies. */
             ESP_ERROR_CHECK((xTaskCreatePinnedToCore(
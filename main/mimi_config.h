@@ -1,5 +1,7 @@
 #pragma once
 
+#include "sdkconfig.h"
+
 /* MimiClaw Global Configuration */
 
 /* Build-time secrets (highest priority, override NVS) */
@@ -61,6 +63,13 @@
 /* Timezone (POSIX TZ format) */
 #define MIMI_TIMEZONE                "PST8PDT,M3.2.0,M11.1.0"
 
+/* Clock */
+#define MIMI_CLOCK_SNTP_SERVER1      "pool.ntp.org"
+#define MIMI_CLOCK_SNTP_SERVER2      "time.cloudflare.com"
+#define MIMI_CLOCK_SYNC_INTERVAL_MS  (6 * 60 * 60 * 1000)   /* SNTP re-sync period */
+#define MIMI_CLOCK_SNTP_WAIT_MS      (5 * 1000)   /* A turn waits this long for the first SNTP reply */
+#define MIMI_CLOCK_HTTP_RETRY_MS     (60 * 1000)  /* Minimum gap between HTTP Date fallbacks */
+
 /* LLM */
 #define MIMI_LLM_DEFAULT_MODEL       "claude-opus-4-5"
 #define MIMI_LLM_PROVIDER_DEFAULT    "anthropic"
@@ -79,6 +88,32 @@
 #define MIMI_OUTBOUND_CORE           0
 
 /* Memory / SPIFFS */
+#ifdef CONFIG_MIMI_FS_LITTLEFS
+#define MIMI_FS_LITTLEFS             1            /* LittleFS with real directories (menuconfig) */
+#else
+#define MIMI_FS_LITTLEFS             0
+#endif
+#define MIMI_FS_MIGRATE_MAX          (4 * 1024 * 1024)  /* SPIFFS bytes carried over to LittleFS */
+#define MIMI_FS_CATALOG_MAX          512          /* Files tracked by the in-RAM catalog (PSRAM) */
+#define MIMI_FS_CATALOG_PATH_MAX     96
+#define MIMI_FILE_CACHE_SLOTS        24           /* Small files cached whole in PSRAM */
+#define MIMI_FILE_CACHE_BYTES        (192 * 1024)
+#define MIMI_FILE_CACHE_MAX_FILE     (32 * 1024)  /* Larger files are always read from flash */
+#define MIMI_FILE_CACHE_ABSENT_SLOTS 8            /* Missing paths remembered while the catalog is not ready */
+#define MIMI_FS_WRITE_COALESCE_MS    2000         /* Rewrites of one file within this are flushed once */
+#define MIMI_FS_WRITE_SLOTS          4            /* Files with a pending coalesced write */
+#define MIMI_FS_WRITE_COALESCE_MAX   (64 * 1024)  /* Larger contents are written at once */
+/* Each flush runs every storage listener on this task: the worst case is
+ * swap_in -> storage_notify -> search_index reindex (tokenizer callbacks)
+ * or memory_dedup reindex (entry split + SimHash), about 3 KB on top of
+ * ~2 KB for the LittleFS rename and write path. */
+#define MIMI_FS_WRITER_STACK         (8 * 1024)
+#define MIMI_FS_WRITER_PRIO          2
+#define MIMI_FS_WRITER_CORE          0
+#define MIMI_FS_COMPRESS             1            /* Deflate idle sessions and old digests (ROM miniz) */
+#define MIMI_FS_COMPRESS_PROBES      128          /* tdefl match probes: more packs tighter, slower */
+#define MIMI_FS_COMPRESS_MAX         (256 * 1024) /* Largest file packed or inflated */
+#define MIMI_ASSETS_PARTITION        "assets"     /* Read-only built-in skills and prompts */
 #define MIMI_SPIFFS_BASE             "/spiffs"
 #define MIMI_SPIFFS_CONFIG_DIR       "/spiffs/config"
 #define MIMI_SPIFFS_MEMORY_DIR       "/spiffs/memory"
@@ -86,8 +121,80 @@
 #define MIMI_MEMORY_FILE             "/spiffs/memory/MEMORY.md"
 #define MIMI_SOUL_FILE               "/spiffs/config/SOUL.md"
 #define MIMI_USER_FILE               "/spiffs/config/USER.md"
+#define MIMI_PROMPT_ASSET            "prompts/system.md"  /* Base system prompt (assets_data/) */
 #define MIMI_CONTEXT_BUF_SIZE        (16 * 1024)
+#define MIMI_CONTEXT_MEMORY_BUDGET   (6 * 1024)   /* Memory entries injected per prompt */
+#define MIMI_MEMORY_RECENT_DAYS      3
+#define MIMI_MEMORY_RANK_SOURCE_MAX  (16 * 1024)  /* Bytes read from MEMORY.md / notes for ranking */
+#define MIMI_MEMORY_RANK_MAX_ENTRIES 256
+#define MIMI_ROLLUP_WEEKLY_AFTER_DAYS  14        /* Daily notes older than this go to week-*.md */
+#define MIMI_ROLLUP_MONTHLY_AFTER_DAYS 60        /* Weekly digests older than this go to month-*.md */
+#define MIMI_ROLLUP_ARCHIVE_AFTER_DAYS 180       /* Monthly digests older than this are compressed */
+#define MIMI_ROLLUP_SUMMARIZE        1            /* LLM-summarize each week instead of merging verbatim */
+#define MIMI_ROLLUP_INTERVAL_MS      (6 * 60 * 60 * 1000)
+#define MIMI_MEMORY_KV_FILE          "/spiffs/memory/facts.jsonl"
+#define MIMI_MEMORY_KV_MAX_KEYS      128          /* Power of two */
+#define MIMI_MEMORY_KV_KEY_MAX       48
+#define MIMI_MEMORY_KV_VALUE_MAX     512
+#define MIMI_MEMORY_KV_COMPACT_SLACK 32           /* Dead log records tolerated before rewriting */
+#define MIMI_DEDUP_MODE              1            /* Near-duplicate memory entries: 0 off, 1 warn, 2 drop */
+#define MIMI_DEDUP_HAMMING           6            /* Max SimHash bit distance for a near-duplicate */
+#define MIMI_DEDUP_MIN_TOKENS        4            /* Shorter entries must match exactly */
+#define MIMI_DEDUP_MAX_ENTRIES       2048         /* Fingerprinted entries across memory files */
 #define MIMI_SESSION_MAX_MSGS        20
+#define MIMI_SESSION_BINARY          0            /* 1 = compact binary records (.bin) instead of JSONL */
+#define MIMI_SESSION_COMPACT_BYTES   (16 * 1024)  /* Summarize once a session file grows past this */
+#define MIMI_SESSION_COMPACT_KEEP    10           /* Raw messages kept after summarizing */
+#define MIMI_SESSION_SUMMARY_MAX     2048
+#define MIMI_SESSION_SUMMARY_MODEL   ""           /* Empty = use the configured model */
+#define MIMI_SESSION_CACHE_SLOTS     8            /* Chats with a cached history tail */
+#define MIMI_SESSION_CACHE_BYTES     (256 * 1024) /* PSRAM budget for cached history */
+#define MIMI_SESSION_LOG_TOOLS       0            /* Keep a tool transcript record per turn */
+#define MIMI_SESSION_WRITE_BEHIND    1            /* Queue turn writes to a background task */
+#define MIMI_SESSION_WRITE_QUEUE     8
+#define MIMI_SESSION_WRITER_STACK    (4 * 1024)
+#define MIMI_SESSION_WRITER_PRIO     2
+#define MIMI_SESSION_WRITER_CORE     0
+#define MIMI_SESSION_ARCHIVE_DAYS    7            /* Sessions idle this long are compressed */
+
+/* Storage quotas */
+#define MIMI_STORAGE_QUOTA_SESSIONS  (3 * 1024 * 1024)  /* LRU sessions evicted above this */
+#define MIMI_STORAGE_QUOTA_MEMORY    (2 * 1024 * 1024)  /* Oldest daily notes evicted above this */
+#define MIMI_STORAGE_QUOTA_SKILLS    (1 * 1024 * 1024)  /* Warn only */
+#define MIMI_STORAGE_QUOTA_OTHER     (1 * 1024 * 1024)  /* Warn only */
+#define MIMI_STORAGE_HIGH_WATER_PCT  75                 /* Evict when the partition is fuller */
+#define MIMI_STORAGE_KEEP_SESSIONS   2                  /* Most recent sessions never evicted */
+#define MIMI_STORAGE_KEEP_NOTES      3                  /* Most recent daily notes never evicted */
+#define MIMI_STORAGE_CHECK_INTERVAL_MS (15 * 60 * 1000)
+#define MIMI_STORAGE_MIN_GAP_MS      (60 * 1000)
+#define MIMI_STORAGE_MAX_LISTENERS   6
+#define MIMI_STORAGE_GC_FREE_TARGET  (256 * 1024)       /* Idle GC keeps this much writable without inline GC */
+#define MIMI_STORAGE_GC_STEP         (32 * 1024)        /* GC goal per step; a new turn waits at most one step */
+#define MIMI_STORAGE_GC_IDLE_MS      (10 * 1000)        /* Quiet time after a turn before GC runs */
+#define MIMI_STORAGE_SLOW_WRITE_MS   50                 /* Writes slower than this are counted as stalls */
+#define MIMI_STORAGE_STACK           (12 * 1024)      /* Idle summaries make TLS calls, as web search does */
+#define MIMI_STORAGE_PRIO            1
+#define MIMI_STORAGE_CORE            0
+
+/* Web search */
+#define MIMI_WEB_SEARCH_MAX_QUERIES  4            /* Queries one web_search call runs in parallel */
+#define MIMI_WEB_SEARCH_TIMEOUT_MS   15000
+#define MIMI_WEB_SEARCH_POOL         2            /* Kept-alive API connections (direct, not proxied) */
+#define MIMI_WEB_SEARCH_IDLE_MS      (30 * 1000)  /* A pooled connection idle longer is reopened */
+#define MIMI_WEB_SEARCH_STACK        (12 * 1024)  /* Per extra query while it runs */
+#define MIMI_WEB_SEARCH_PRIO         5
+#define MIMI_WEB_SEARCH_CORE         0
+
+/* Full-text search */
+#define MIMI_SEARCH_INDEX_FILE       "/spiffs/search.idx"
+#define MIMI_SEARCH_MAX_FILES        128
+#define MIMI_SEARCH_MAX_FILE_BYTES   (64 * 1024)  /* Larger files are not indexed */
+#define MIMI_SEARCH_MAX_RESULTS      20
+#define MIMI_GREP_MAX_MATCHES        50
+#define MIMI_GREP_MAX_CONTEXT        5
+#define MIMI_GREP_LINE_MAX           256          /* Longer lines are cut in grep_file output */
+#define MIMI_EDIT_MAX_EDITS          16           /* Replacements one edit_file call may apply */
+#define MIMI_FILE_BATCH_MAX_OPS      8            /* Operations in one file_batch call */
 
 /* Cron / Heartbeat */
 #define MIMI_CRON_FILE               "/spiffs/cron.json"
@@ -0,0 +1,369 @@
+#include "proxy/http_body.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "rom/miniz.h"
+
+static const char *TAG = "http_body";
+
+#define HB_LINE_MAX     256     /* Longer header lines are cut */
+
+enum { STAGE_HEAD = 0, STAGE_BODY, STAGE_DONE };
+enum { CH_SIZE = 0, CH_EXT, CH_DATA, CH_DATA_END };
+enum { GZ_FIXED = 0, GZ_EXTRA_LEN, GZ_EXTRA, GZ_NAME, GZ_COMMENT, GZ_HCRC, GZ_DEFLATE };
+
+/* gzip header flags (RFC 1952) */
+#define GZ_FHCRC        0x02
+#define GZ_FEXTRA       0x04
+#define GZ_FNAME        0x08
+#define GZ_FCOMMENT     0x10
+
+struct http_body {
+    http_body_sink_t sink;
+    void *ctx;
+    bool raw;
+    int stage;
+    int status;
+    bool stopped;
+    esp_err_t err;
+    size_t wire;
+    size_t decoded;
+
+    /* Raw mode: status line and headers */
+    char line[HB_LINE_MAX];
+    size_t line_len;
+    bool status_seen;
+
+    /* Chunked transfer coding */
+    bool chunked;
+    int ch_state;
+    size_t ch_left;
+    int ch_digits;
+
+    /* gzip content coding */
+    bool gzip;
+    int gz_state;
+    uint8_t gz_hdr[10];
+    size_t gz_pos;
+    size_t gz_skip;
+    tinfl_decompressor *inflator;
+    uint8_t *dict;              /* TINFL_LZ_DICT_SIZE ring, the inflate window */
+    size_t dict_ofs;
+};
+
+static void fail(http_body_t *hb, esp_err_t err, const char *why)
+{
+    if (hb->err == ESP_OK) ESP_LOGW(TAG, "%s", why);
+    hb->err = err;
+}
+
+static void deliver(http_body_t *hb, const char *data, size_t len)
+{
+    if (len == 0 || hb->stopped) return;
+    hb->decoded += len;
+    if (!hb->sink(data, len, hb->ctx)) hb->stopped = true;
+}
+
+/* ── gzip ───────────────────────────────────────────────────── */
+
+static void inflate_feed(http_body_t *hb, const uint8_t *in, size_t len)
+{
+    while (!hb->stopped) {
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - hb->dict_ofs;
+        tinfl_status st = tinfl_decompress(hb->inflator, in, &in_bytes, hb->dict,
+                                           hb->dict + hb->dict_ofs, &out_bytes,
+                                           TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_bytes;
+        len -= in_bytes;
+        deliver(hb, (const char *)hb->dict + hb->dict_ofs, out_bytes);
+        hb->dict_ofs = (hb->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+        if (st < TINFL_STATUS_DONE) {
+            fail(hb, ESP_ERR_INVALID_RESPONSE, "Corrupt gzip body");
+            return;
+        }
+        if (st == TINFL_STATUS_DONE) {
+            /* The CRC-32 and size trailer are not checked; TLS already was */
+            hb->stage = STAGE_DONE;
+            return;
+        }
+        if (st == TINFL_STATUS_NEEDS_MORE_INPUT && (len == 0 || (in_bytes == 0 && out_bytes == 0))) {
+            return;
+        }
+    }
+}
+
+static void inflate_start(http_body_t *hb)
+{
+    hb->inflator = heap_caps_malloc(sizeof(tinfl_decompressor), MALLOC_CAP_SPIRAM);
+    hb->dict = heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_SPIRAM);
+    if (!hb->inflator || !hb->dict) {
+        fail(hb, ESP_ERR_NO_MEM, "No memory to inflate");
+        return;
+    }
+    tinfl_init(hb->inflator);
+    hb->gz_state = GZ_DEFLATE;
+}
+
+/* Move to the next gzip header field the flags say is present. */
+static void gzip_advance(http_body_t *hb)
+{
+    uint8_t flags = hb->gz_hdr[3];
+    switch (hb->gz_state) {
+    case GZ_FIXED:
+        hb->gz_state = GZ_EXTRA_LEN;
+        hb->gz_pos = 0;
+        hb->gz_skip = 0;
+        if (flags & GZ_FEXTRA) return;
+        /* fall through */
+    case GZ_EXTRA_LEN:
+    case GZ_EXTRA:
+        hb->gz_state = GZ_NAME;
+        if (flags & GZ_FNAME) return;
+        /* fall through */
+    case GZ_NAME:
+        hb->gz_state = GZ_COMMENT;
+        if (flags & GZ_FCOMMENT) return;
+        /* fall through */
+    case GZ_COMMENT:
+        hb->gz_state = GZ_HCRC;
+        hb->gz_skip = 2;
+        if (flags & GZ_FHCRC) return;
+        /* fall through */
+    default:
+        inflate_start(hb);
+    }
+}
+
+/* Skip the gzip member header byte by byte, then inflate in bulk. */
+static void gzip_feed(http_body_t *hb, const uint8_t *in, size_t len)
+{
+    while (len > 0 && hb->gz_state != GZ_DEFLATE && hb->err == ESP_OK) {
+        uint8_t c = *in++;
+        len--;
+        switch (hb->gz_state) {
+        case GZ_FIXED:
+            hb->gz_hdr[hb->gz_pos++] = c;
+            if (hb->gz_pos < sizeof(hb->gz_hdr)) break;
+            if (hb->gz_hdr[0] != 0x1F || hb->gz_hdr[1] != 0x8B || hb->gz_hdr[2] != 8) {
+                fail(hb, ESP_ERR_INVALID_RESPONSE, "Not a gzip body");
+                return;
+            }
+            gzip_advance(hb);
+            break;
+        case GZ_EXTRA_LEN:
+            hb->gz_skip |= (size_t)c << (8 * hb->gz_pos++);
+            if (hb->gz_pos < 2) break;
+            if (hb->gz_skip) {
+                hb->gz_state = GZ_EXTRA;
+            } else {
+                gzip_advance(hb);
+            }
+            break;
+        case GZ_NAME:
+        case GZ_COMMENT:
+            if (c == 0) gzip_advance(hb);
+            break;
+        default:
+            /* GZ_EXTRA, GZ_HCRC */
+            if (--hb->gz_skip == 0) gzip_advance(hb);
+            break;
+        }
+    }
+    if (hb->gz_state == GZ_DEFLATE && hb->err == ESP_OK && len > 0) inflate_feed(hb, in, len);
+}
+
+/* ── Transfer and content codings ───────────────────────────── */
+
+static void content_feed(http_body_t *hb, const char *data, size_t len)
+{
+    if (hb->gzip) {
+        gzip_feed(hb, (const uint8_t *)data, len);
+    } else {
+        deliver(hb, data, len);
+    }
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void chunked_feed(http_body_t *hb, const char *data, size_t len)
+{
+    while (len > 0 && hb->stage == STAGE_BODY && hb->err == ESP_OK && !hb->stopped) {
+        if (hb->ch_state == CH_DATA) {
+            size_t n = len < hb->ch_left ? len : hb->ch_left;
+            content_feed(hb, data, n);
+            data += n;
+            len -= n;
+            hb->ch_left -= n;
+            if (hb->ch_left == 0) hb->ch_state = CH_DATA_END;
+            continue;
+        }
+
+        char c = *data++;
+        len--;
+        if (hb->ch_state == CH_DATA_END) {
+            if (c == '\n') hb->ch_state = CH_SIZE;
+        } else if (hb->ch_state == CH_SIZE && hex_value(c) >= 0) {
+            if (++hb->ch_digits > 8) {
+                fail(hb, ESP_ERR_INVALID_RESPONSE, "Bad chunk size");
+                return;
+            }
+            hb->ch_left = (hb->ch_left << 4) | (size_t)hex_value(c);
+        } else if (c == '\n') {
+            if (hb->ch_digits == 0) {
+                fail(hb, ESP_ERR_INVALID_RESPONSE, "Bad chunk size");
+                return;
+            }
+            /* The last chunk; trailers are not needed */
+            if (hb->ch_left == 0) hb->stage = STAGE_DONE;
+            hb->ch_state = CH_DATA;
+            hb->ch_digits = 0;
+        } else {
+            /* ";extension" or the '\r' before '\n' */
+            hb->ch_state = CH_EXT;
+        }
+    }
+}
+
+static void body_feed(http_body_t *hb, const char *data, size_t len)
+{
+    if (hb->chunked) {
+        chunked_feed(hb, data, len);
+    } else {
+        content_feed(hb, data, len);
+    }
+}
+
+/* ── Raw head ───────────────────────────────────────────────── */
+
+/* Whether a comma-separated header value lists token. */
+static bool has_token(const char *value, const char *token)
+{
+    size_t tlen = strlen(token);
+    const char *p = value;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        size_t n = strcspn(p, ", ;");
+        if (n == tlen && strncasecmp(p, token, n) == 0) return true;
+        p += n;
+        while (*p && *p != ',') p++;
+    }
+    return false;
+}
+
+static void head_line(http_body_t *hb)
+{
+    hb->line[hb->line_len] = '\0';
+    if (hb->line_len > 0 && hb->line[hb->line_len - 1] == '\r') hb->line[--hb->line_len] = '\0';
+
+    if (!hb->status_seen) {
+        hb->status_seen = true;
+        const char *sp = strchr(hb->line, ' ');
+        if (strncmp(hb->line, "HTTP/", 5) != 0 || !sp) {
+            fail(hb, ESP_ERR_INVALID_RESPONSE, "Bad status line");
+            return;
+        }
+        hb->status = atoi(sp + 1);
+        return;
+    }
+    if (hb->line_len == 0) {
+        hb->stage = STAGE_BODY;
+        return;
+    }
+    char *colon = strchr(hb->line, ':');
+    if (!colon) return;
+    *colon = '\0';
+    const char *value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+    http_body_header(hb, hb->line, value);
+}
+
+static size_t head_feed(http_body_t *hb, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && hb->stage == STAGE_HEAD && hb->err == ESP_OK) {
+        char c = data[i++];
+        if (c == '\n') {
+            head_line(hb);
+            hb->line_len = 0;
+        } else if (hb->line_len < sizeof(hb->line) - 1) {
+            hb->line[hb->line_len++] = c;
+        }
+    }
+    return i;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+http_body_t *http_body_create(bool raw, http_body_sink_t sink, void *ctx)
+{
+    http_body_t *hb = heap_caps_calloc(1, sizeof(*hb), MALLOC_CAP_SPIRAM);
+    if (!hb) return NULL;
+    hb->sink = sink;
+    hb->ctx = ctx;
+    hb->raw = raw;
+    hb->stage = raw ? STAGE_HEAD : STAGE_BODY;
+    return hb;
+}
+
+void http_body_header(http_body_t *hb, const char *key, const char *value)
+{
+    if (strcasecmp(key, "Content-Encoding") == 0) {
+        if (has_token(value, "gzip")) {
+            hb->gzip = true;
+        } else if (value[0] && !has_token(value, "identity")) {
+            ESP_LOGW(TAG, "Unsupported Content-Encoding: %s", value);
+            hb->err = ESP_ERR_NOT_SUPPORTED;
+        }
+    } else if (hb->raw && strcasecmp(key, "Transfer-Encoding") == 0) {
+        hb->chunked = has_token(value, "chunked");
+    }
+}
+
+esp_err_t http_body_feed(http_body_t *hb, const char *data, size_t len)
+{
+    hb->wire += len;
+    if (hb->stage == STAGE_HEAD) {
+        size_t used = head_feed(hb, data, len);
+        data += used;
+        len -= used;
+    }
+    if (hb->stage == STAGE_BODY && hb->err == ESP_OK && !hb->stopped && len > 0) {
+        body_feed(hb, data, len);
+    }
+    return hb->err;
+}
+
+bool http_body_finished(const http_body_t *hb)
+{
+    return hb->stopped || hb->stage == STAGE_DONE || hb->err != ESP_OK;
+}
+
+int http_body_status(const http_body_t *hb)
+{
+    return hb->status;
+}
+
+void http_body_sizes(const http_body_t *hb, size_t *wire, size_t *decoded)
+{
+    if (wire) *wire = hb->wire;
+    if (decoded) *decoded = hb->decoded;
+}
+
+void http_body_destroy(http_body_t *hb)
+{
+    if (!hb) return;
+    free(hb->inflator);
+    free(hb->dict);
+    free(hb);
+}
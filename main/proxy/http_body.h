@@ -0,0 +1,53 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Incremental decoder for an HTTP/1.1 response body read in pieces.
+ *
+ * In raw mode (a proxied connection, see proxy_conn_read()) the input
+ * starts with the status line and headers, and the body may use chunked
+ * transfer coding. Otherwise the caller passes body bytes as
+ * esp_http_client delivers them (already de-chunked) and forwards
+ * response headers with http_body_header().
+ *
+ * A gzip content coding is inflated on the fly with the ROM inflater and
+ * a 32 KB window, both in PSRAM and only allocated for gzipped bodies, so
+ * memory stays the same whatever the response size. Decoded bytes go to
+ * the sink as they come.
+ */
+
+/** Decoded body callback. Return false when no more is wanted. */
+typedef bool (*http_body_sink_t)(const char *data, size_t len, void *ctx);
+
+typedef struct http_body http_body_t;
+
+/**
+ * @param raw  input includes the status line and headers
+ * @return NULL if out of memory
+ */
+http_body_t *http_body_create(bool raw, http_body_sink_t sink, void *ctx);
+
+/** Note a response header (Content-Encoding, Transfer-Encoding). */
+void http_body_header(http_body_t *hb, const char *key, const char *value);
+
+/**
+ * Decode the next piece of the response.
+ * @return ESP_OK, ESP_ERR_INVALID_RESPONSE if it is malformed,
+ *         ESP_ERR_NOT_SUPPORTED for a content coding other than gzip,
+ *         ESP_ERR_NO_MEM
+ */
+esp_err_t http_body_feed(http_body_t *hb, const char *data, size_t len);
+
+/** True once the body is complete or the sink asked to stop. */
+bool http_body_finished(const http_body_t *hb);
+
+/** Raw mode: status code from the status line, 0 until it was read. */
+int http_body_status(const http_body_t *hb);
+
+/** Bytes fed in and bytes passed to the sink so far. */
+void http_body_sizes(const http_body_t *hb, size_t *wire, size_t *decoded);
+
+void http_body_destroy(http_body_t *hb);
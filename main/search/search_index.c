@@ -0,0 +1,636 @@
+#include "search/search_index.h"
+#include "search/tokenizer.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/fs_writer.h"
+#include "storage/fs_compress.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "search";
+
+#define IDX_MAGIC          "MSI1"
+#define IDX_PATH_MAX       64
+#define TERM_SLOTS_MIN     512
+#define LINE_MAX_TERMS     48       /* Per-line dedup window */
+#define QUERY_MAX_TERMS    8
+
+/* Posting: file slot in the high half, 1-based line number in the low half */
+#define POSTING(file, line)  (((uint32_t)(file) << 16) | (uint16_t)(line))
+#define POSTING_FILE(p)      ((int)((p) >> 16))
+#define POSTING_LINE(p)      ((uint16_t)((p) & 0xFFFF))
+
+typedef struct {
+    char path[IDX_PATH_MAX];    /* "" = free slot */
+    uint32_t mtime;
+    uint32_t size;
+} idx_file_t;
+
+typedef struct {
+    uint32_t hash;              /* 0 = empty slot */
+    uint32_t count;
+    uint32_t cap;
+    uint32_t *postings;
+} idx_term_t;
+
+typedef struct {
+    char magic[4];
+    uint16_t max_files;
+    uint16_t path_max;
+    uint32_t term_count;
+} idx_header_t;
+
+static idx_file_t *s_files = NULL;      /* MIMI_SEARCH_MAX_FILES slots */
+static idx_term_t *s_terms = NULL;
+static uint32_t s_term_slots = 0;
+static uint32_t s_term_used = 0;
+static SemaphoreHandle_t s_lock = NULL;
+static SemaphoreHandle_t s_save_lock = NULL;    /* Taken before s_lock, never by the listener */
+static bool s_dirty = false;
+static uint32_t s_queries = 0;
+static uint32_t s_reindexed = 0;
+
+static const char *const s_scopes[] = {
+    MIMI_SPIFFS_CONFIG_DIR "/", MIMI_SPIFFS_MEMORY_DIR "/", MIMI_SKILLS_PREFIX, NULL,
+};
+
+static bool in_scope(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+    if (!ext || (strcmp(ext, ".md") != 0 && strcmp(ext, ".txt") != 0 &&
+                 strcmp(ext, ".json") != 0)) {
+        return false;
+    }
+    if (strlen(path) >= IDX_PATH_MAX) return false;
+    for (int i = 0; s_scopes[i]; i++) {
+        if (strncmp(path, s_scopes[i], strlen(s_scopes[i])) == 0) return true;
+    }
+    return false;
+}
+
+/*
+ * Archives are indexed under their plain name, which read_file still
+ * accepts, so packing a digest does not drop it from search.
+ */
+static bool index_name(const char *path, char *name)
+{
+    size_t n = strlen(path);
+    size_t e = sizeof(FS_COMPRESS_EXT) - 1;
+    if (n >= e && strcmp(path + n - e, FS_COMPRESS_EXT) == 0) n -= e;
+    if (n >= IDX_PATH_MAX) return false;
+    memcpy(name, path, n);
+    name[n] = '\0';
+    return in_scope(name);
+}
+
+/* The file behind an index name: plain, or its archive. */
+static bool file_stat(const char *name, struct stat *st)
+{
+    char zpath[IDX_PATH_MAX + sizeof(FS_COMPRESS_EXT)];
+    snprintf(zpath, sizeof(zpath), "%s" FS_COMPRESS_EXT, name);
+    return stat(name, st) == 0 || stat(zpath, st) == 0;
+}
+
+static uint32_t term_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;           /* FNV-1a */
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+/* ── Term table ─────────────────────────────────────────────── */
+
+static idx_term_t *term_find(uint32_t hash)
+{
+    if (!s_terms) return NULL;
+    uint32_t mask = s_term_slots - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        if (s_terms[i].hash == hash) return &s_terms[i];
+        if (s_terms[i].hash == 0) return NULL;
+    }
+}
+
+static bool term_table_grow(void)
+{
+    uint32_t new_slots = s_term_slots ? s_term_slots * 2 : TERM_SLOTS_MIN;
+    idx_term_t *tbl = heap_caps_calloc(new_slots, sizeof(idx_term_t), MALLOC_CAP_SPIRAM);
+    if (!tbl) return false;
+
+    uint32_t mask = new_slots - 1;
+    for (uint32_t i = 0; i < s_term_slots; i++) {
+        if (s_terms[i].hash == 0) continue;
+        uint32_t j = s_terms[i].hash & mask;
+        while (tbl[j].hash) j = (j + 1) & mask;
+        tbl[j] = s_terms[i];
+    }
+    free(s_terms);
+    s_terms = tbl;
+    s_term_slots = new_slots;
+    return true;
+}
+
+static idx_term_t *term_get(uint32_t hash)
+{
+    idx_term_t *t = term_find(hash);
+    if (t) return t;
+
+    if ((s_term_used + 1) * 4 > s_term_slots * 3 && !term_table_grow()) {
+        return NULL;
+    }
+    uint32_t mask = s_term_slots - 1;
+    uint32_t i = hash & mask;
+    while (s_terms[i].hash) i = (i + 1) & mask;
+    s_terms[i].hash = hash;
+    s_term_used++;
+    return &s_terms[i];
+}
+
+static bool term_add(idx_term_t *t, uint32_t posting)
+{
+    if (t->count == t->cap) {
+        uint32_t new_cap = t->cap ? t->cap * 2 : 4;
+        uint32_t *p = heap_caps_realloc(t->postings, new_cap * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+        if (!p) return false;
+        t->postings = p;
+        t->cap = new_cap;
+    }
+    t->postings[t->count++] = posting;
+    return true;
+}
+
+static void index_clear(void)
+{
+    for (uint32_t i = 0; i < s_term_slots; i++) {
+        free(s_terms[i].postings);
+    }
+    free(s_terms);
+    s_terms = NULL;
+    s_term_slots = 0;
+    s_term_used = 0;
+    memset(s_files, 0, MIMI_SEARCH_MAX_FILES * sizeof(idx_file_t));
+}
+
+/* ── Per-file indexing ──────────────────────────────────────── */
+
+static int file_find(const char *path)
+{
+    for (int i = 0; i < MIMI_SEARCH_MAX_FILES; i++) {
+        if (strcmp(s_files[i].path, path) == 0) return i;
+    }
+    return -1;
+}
+
+static int file_alloc(const char *path)
+{
+    for (int i = 0; i < MIMI_SEARCH_MAX_FILES; i++) {
+        if (s_files[i].path[0] == '\0') {
+            strncpy(s_files[i].path, path, IDX_PATH_MAX - 1);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void file_drop_postings(int id)
+{
+    for (uint32_t i = 0; i < s_term_slots; i++) {
+        idx_term_t *t = &s_terms[i];
+        uint32_t out = 0;
+        for (uint32_t j = 0; j < t->count; j++) {
+            if (POSTING_FILE(t->postings[j]) != id) t->postings[out++] = t->postings[j];
+        }
+        t->count = out;
+    }
+}
+
+typedef struct {
+    int file;
+    uint16_t line;
+    uint32_t seen[LINE_MAX_TERMS];
+    int seen_count;
+} line_ctx_t;
+
+static bool on_token(const char *token, size_t len, size_t offset, void *arg)
+{
+    line_ctx_t *lc = arg;
+    uint32_t h = term_hash(token, len);
+    for (int i = 0; i < lc->seen_count; i++) {
+        if (lc->seen[i] == h) return true;
+    }
+    if (lc->seen_count < LINE_MAX_TERMS) lc->seen[lc->seen_count++] = h;
+
+    idx_term_t *t = term_get(h);
+    return t && term_add(t, POSTING(lc->file, lc->line));
+}
+
+/* Caller holds s_lock. Removes the entry if the file is gone or too big. */
+static void file_reindex(const char *path)
+{
+    int id = file_find(path);
+    if (id >= 0) file_drop_postings(id);
+    s_dirty = true;
+
+    struct stat st;
+    if (!file_stat(path, &st) || st.st_size > MIMI_SEARCH_MAX_FILE_BYTES) {
+        if (id >= 0) s_files[id].path[0] = '\0';
+        return;
+    }
+    if (id < 0) id = file_alloc(path);
+    if (id < 0) {
+        ESP_LOGW(TAG, "Index full, skipping %s", path);
+        return;
+    }
+    s_files[id].mtime = (uint32_t)st.st_mtime;
+    s_files[id].size = (uint32_t)st.st_size;
+
+    /* Inflates an archive; its inflated size is held to the same limit */
+    size_t n = 0;
+    char *buf = fs_compress_read_alloc(path, MIMI_SEARCH_MAX_FILE_BYTES, &n);
+    if (!buf) {
+        s_files[id].path[0] = '\0';
+        return;
+    }
+
+    line_ctx_t lc = { .file = id, .line = 0 };
+    const char *p = buf;
+    const char *end = buf + n;
+    while (p < end && lc.line < UINT16_MAX) {
+        const char *nl = memchr(p, '\n', end - p);
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        lc.line++;
+        lc.seen_count = 0;
+        tokenize(p, len, on_token, &lc);
+        p += len + 1;
+    }
+    free(buf);
+    s_reindexed++;
+}
+
+static void file_remove(const char *path)
+{
+    int id = file_find(path);
+    if (id < 0) return;
+    file_drop_postings(id);
+    s_files[id].path[0] = '\0';
+    s_dirty = true;
+}
+
+/* ── Persistence ────────────────────────────────────────────── */
+
+/*
+ * Serialized into PSRAM under s_lock and written after it is released:
+ * fs_writer notifies listeners, this one included, while holding its flush
+ * lock, so writing with s_lock held would invert the lock order.
+ */
+static uint8_t *index_serialize_locked(size_t *out_len)
+{
+    idx_header_t hdr = { .max_files = MIMI_SEARCH_MAX_FILES, .path_max = IDX_PATH_MAX };
+    memcpy(hdr.magic, IDX_MAGIC, 4);
+    size_t len = sizeof(hdr) + MIMI_SEARCH_MAX_FILES * sizeof(idx_file_t);
+    for (uint32_t i = 0; i < s_term_slots; i++) {
+        if (!s_terms[i].count) continue;
+        hdr.term_count++;
+        len += 2 * sizeof(uint32_t) + s_terms[i].count * sizeof(uint32_t);
+    }
+
+    uint8_t *buf = heap_caps_malloc(len, MALLOC_CAP_SPIRAM);
+    if (!buf) {
+        ESP_LOGE(TAG, "No memory to save index (%u bytes)", (unsigned)len);
+        return NULL;
+    }
+    uint8_t *p = buf;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p, s_files, MIMI_SEARCH_MAX_FILES * sizeof(idx_file_t));
+    p += MIMI_SEARCH_MAX_FILES * sizeof(idx_file_t);
+    for (uint32_t i = 0; i < s_term_slots; i++) {
+        const idx_term_t *t = &s_terms[i];
+        if (!t->count) continue;
+        memcpy(p, &t->hash, sizeof(uint32_t));
+        memcpy(p + sizeof(uint32_t), &t->count, sizeof(uint32_t));
+        memcpy(p + 2 * sizeof(uint32_t), t->postings, t->count * sizeof(uint32_t));
+        p += 2 * sizeof(uint32_t) + t->count * sizeof(uint32_t);
+    }
+    *out_len = len;
+    return buf;
+}
+
+/* Takes and releases s_lock; s_save_lock keeps an older snapshot from landing last */
+static esp_err_t index_save(bool force)
+{
+    xSemaphoreTake(s_save_lock, portMAX_DELAY);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!force && !s_dirty) {
+        xSemaphoreGive(s_lock);
+        xSemaphoreGive(s_save_lock);
+        return ESP_OK;
+    }
+    size_t len = 0;
+    uint8_t *buf = index_serialize_locked(&len);
+    if (buf) s_dirty = false;
+    xSemaphoreGive(s_lock);
+
+    esp_err_t err = buf ? fs_write_atomic(MIMI_SEARCH_INDEX_FILE, buf, len, FS_WRITER_INDEX) : ESP_ERR_NO_MEM;
+    free(buf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot save %s", MIMI_SEARCH_INDEX_FILE);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_dirty = true;
+        xSemaphoreGive(s_lock);
+    } else {
+        ESP_LOGD(TAG, "Index saved (%u bytes)", (unsigned)len);
+    }
+    xSemaphoreGive(s_save_lock);
+    return err;
+}
+
+static bool index_load(void)
+{
+    FILE *f = fopen(MIMI_SEARCH_INDEX_FILE, "rb");
+    if (!f) return false;
+
+    idx_header_t hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              memcmp(hdr.magic, IDX_MAGIC, 4) == 0 &&
+              hdr.max_files == MIMI_SEARCH_MAX_FILES && hdr.path_max == IDX_PATH_MAX &&
+              fread(s_files, sizeof(idx_file_t), MIMI_SEARCH_MAX_FILES, f) == MIMI_SEARCH_MAX_FILES;
+
+    for (uint32_t i = 0; ok && i < hdr.term_count; i++) {
+        uint32_t hash, count;
+        ok = fread(&hash, sizeof(hash), 1, f) == 1 && fread(&count, sizeof(count), 1, f) == 1 &&
+             hash != 0 && count > 0 && count <= MIMI_SEARCH_MAX_FILES * (uint32_t)UINT16_MAX;
+        if (!ok) break;
+
+        idx_term_t *t = term_get(hash);
+        uint32_t *p = t ? heap_caps_malloc(count * sizeof(uint32_t), MALLOC_CAP_SPIRAM) : NULL;
+        if (!p) {
+            ok = false;
+            break;
+        }
+        free(t->postings);
+        t->postings = p;
+        t->cap = t->count = count;
+        ok = fread(p, sizeof(uint32_t), count, f) == count;
+    }
+    fclose(f);
+
+    if (!ok) {
+        ESP_LOGW(TAG, "Index file invalid, rebuilding");
+        index_clear();
+    }
+    return ok;
+}
+
+/* ── Reconcile ──────────────────────────────────────────────── */
+
+static bool on_new_file(const char *path, void *arg)
+{
+    char name[IDX_PATH_MAX];
+    if (index_name(path, name) && file_find(name) < 0) {
+        file_reindex(name);
+    }
+    return true;
+}
+
+static void reconcile(void)
+{
+    for (int i = 0; i < MIMI_SEARCH_MAX_FILES; i++) {
+        idx_file_t *fe = &s_files[i];
+        if (fe->path[0] == '\0') continue;
+
+        struct stat st;
+        if (!file_stat(fe->path, &st)) {
+            file_remove(fe->path);
+        } else if ((uint32_t)st.st_mtime != fe->mtime || (uint32_t)st.st_size != fe->size) {
+            char path[IDX_PATH_MAX];
+            strcpy(path, fe->path);
+            file_reindex(path);
+        }
+    }
+    fs_list(MIMI_SPIFFS_BASE "/", on_new_file, NULL);
+}
+
+static void on_storage_event(storage_evt_t evt, const char *path)
+{
+    if (evt == STORAGE_EVT_MAINTENANCE) {
+        search_index_save();
+        return;
+    }
+    char name[IDX_PATH_MAX];
+    if (!path || !index_name(path, name)) return;
+
+    /* Archiving or restoring removes one form after writing the other */
+    struct stat st;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (evt == STORAGE_EVT_CHANGED || file_stat(name, &st)) {
+        file_reindex(name);
+    } else {
+        file_remove(name);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/* ── Query ──────────────────────────────────────────────────── */
+
+typedef struct {
+    uint32_t posting;
+    uint8_t term;
+} cand_t;
+
+typedef struct {
+    uint32_t hashes[QUERY_MAX_TERMS];
+    int count;
+} query_terms_t;
+
+static bool on_query_token(const char *token, size_t len, size_t offset, void *arg)
+{
+    query_terms_t *q = arg;
+    uint32_t h = term_hash(token, len);
+    for (int i = 0; i < q->count; i++) {
+        if (q->hashes[i] == h) return true;
+    }
+    q->hashes[q->count++] = h;
+    return q->count < QUERY_MAX_TERMS;
+}
+
+static int cmp_cand(const void *a, const void *b)
+{
+    const cand_t *ca = a, *cb = b;
+    if (ca->posting != cb->posting) return ca->posting < cb->posting ? -1 : 1;
+    return (int)ca->term - (int)cb->term;
+}
+
+static void hits_insert(search_hit_t *hits, int *count, int max, const search_hit_t *h)
+{
+    int pos = *count;
+    while (pos > 0 && (hits[pos - 1].score < h->score ||
+                       (hits[pos - 1].score == h->score && hits[pos - 1].matched < h->matched))) {
+        pos--;
+    }
+    if (pos >= max) return;
+    int last = *count < max ? *count : max - 1;
+    memmove(&hits[pos + 1], &hits[pos], (last - pos) * sizeof(search_hit_t));
+    hits[pos] = *h;
+    if (*count < max) (*count)++;
+}
+
+int search_index_query(const char *query, const char *prefix,
+                       search_hit_t *hits, int max_hits)
+{
+    if (!s_files || !query || max_hits <= 0) return -1;
+
+    query_terms_t q = {0};
+    tokenize(query, strlen(query), on_query_token, &q);
+    if (q.count == 0) return 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_queries++;
+
+    int live = 0;
+    for (int i = 0; i < MIMI_SEARCH_MAX_FILES; i++) {
+        if (s_files[i].path[0]) live++;
+    }
+
+    /* idf per term from the number of distinct files it appears in */
+    float idf[QUERY_MAX_TERMS] = {0};
+    const idx_term_t *terms[QUERY_MAX_TERMS] = {0};
+    size_t total = 0;
+    for (int k = 0; k < q.count; k++) {
+        const idx_term_t *t = term_find(q.hashes[k]);
+        if (!t || !t->count) continue;
+        uint32_t seen[(MIMI_SEARCH_MAX_FILES + 31) / 32] = {0};
+        int df = 0;
+        for (uint32_t j = 0; j < t->count; j++) {
+            int fid = POSTING_FILE(t->postings[j]);
+            if (!(seen[fid / 32] & (1u << (fid % 32)))) {
+                seen[fid / 32] |= 1u << (fid % 32);
+                df++;
+            }
+        }
+        terms[k] = t;
+        idf[k] = logf(1.0f + (live - df + 0.5f) / (df + 0.5f));
+        total += t->count;
+    }
+
+    cand_t *cands = total ? heap_caps_malloc(total * sizeof(cand_t), MALLOC_CAP_SPIRAM) : NULL;
+    if (total && !cands) {
+        xSemaphoreGive(s_lock);
+        return -1;
+    }
+
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    size_t n = 0;
+    for (int k = 0; k < q.count; k++) {
+        const idx_term_t *t = terms[k];
+        for (uint32_t j = 0; t && j < t->count; j++) {
+            const char *path = s_files[POSTING_FILE(t->postings[j])].path;
+            if (prefix_len && strncmp(path, prefix, prefix_len) != 0) continue;
+            cands[n].posting = t->postings[j];
+            cands[n].term = k;
+            n++;
+        }
+    }
+    if (n) qsort(cands, n, sizeof(cand_t), cmp_cand);
+
+    /* Each run of equal postings is one line; score it by the terms it holds */
+    int count = 0;
+    for (size_t i = 0; i < n;) {
+        search_hit_t h = {0};
+        size_t j = i;
+        for (; j < n && cands[j].posting == cands[i].posting; j++) {
+            h.score += idf[cands[j].term];
+            h.matched++;
+        }
+        h.line = POSTING_LINE(cands[i].posting);
+        /* Lines that match every query term rank above partial matches */
+        if (h.matched == q.count) h.score *= 1.5f;
+        strncpy(h.path, s_files[POSTING_FILE(cands[i].posting)].path, sizeof(h.path) - 1);
+        hits_insert(hits, &count, max_hits, &h);
+        i = j;
+    }
+
+    xSemaphoreGive(s_lock);
+    free(cands);
+    return count;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t search_index_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    s_save_lock = xSemaphoreCreateMutex();
+    s_files = heap_caps_calloc(MIMI_SEARCH_MAX_FILES, sizeof(idx_file_t), MALLOC_CAP_SPIRAM);
+    if (!s_lock || !s_save_lock || !s_files) {
+        ESP_LOGE(TAG, "Failed to allocate search index");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Left by saves before they went through fs_writer */
+    remove(MIMI_SEARCH_INDEX_FILE ".tmp");
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool loaded = index_load();
+    uint32_t before = s_reindexed;
+    reconcile();
+    uint32_t changed = s_reindexed - before;
+    s_dirty = !loaded || changed > 0 || s_dirty;
+    xSemaphoreGive(s_lock);
+
+    storage_add_listener(on_storage_event);
+    if (!loaded) search_index_save();
+
+    ESP_LOGI(TAG, "Search index ready (%s, %u files reindexed, %u terms)",
+             loaded ? "loaded" : "built", (unsigned)changed, (unsigned)s_term_used);
+    return ESP_OK;
+}
+
+esp_err_t search_index_save(void)
+{
+    if (!s_files) return ESP_ERR_INVALID_STATE;
+    return index_save(false);
+}
+
+esp_err_t search_index_rebuild(void)
+{
+    if (!s_files) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    index_clear();
+    fs_list(MIMI_SPIFFS_BASE "/", on_new_file, NULL);
+    xSemaphoreGive(s_lock);
+    return index_save(true);
+}
+
+void search_index_get_stats(search_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!s_files) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    out->bytes = MIMI_SEARCH_MAX_FILES * sizeof(idx_file_t) + s_term_slots * sizeof(idx_term_t);
+    for (int i = 0; i < MIMI_SEARCH_MAX_FILES; i++) {
+        if (s_files[i].path[0]) out->files++;
+    }
+    for (uint32_t i = 0; i < s_term_slots; i++) {
+        if (!s_terms[i].count) continue;
+        out->terms++;
+        out->postings += s_terms[i].count;
+        out->bytes += s_terms[i].cap * sizeof(uint32_t);
+    }
+    out->queries = s_queries;
+    out->reindexed = s_reindexed;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Inverted index over the agent's text files (config/, memory/, skills/).
+ *
+ * Each term maps to a posting list of (file, line) pairs. The index is
+ * loaded from MIMI_SEARCH_INDEX_FILE at boot, reconciled against file
+ * mtimes/sizes, kept current through storage_notify() events and written
+ * back lazily on the storage maintenance pass.
+ */
+
+typedef struct {
+    char path[64];
+    uint16_t line;          /* 1-based */
+    uint8_t matched;        /* Distinct query terms on this line */
+    float score;
+} search_hit_t;
+
+typedef struct {
+    int files;
+    int terms;
+    int postings;
+    size_t bytes;           /* PSRAM held by the index */
+    uint32_t queries;
+    uint32_t reindexed;     /* Files (re)indexed since boot */
+} search_stats_t;
+
+/**
+ * Load the persisted index, reindex files that changed while it was not
+ * running, and register for storage events. Call after storage_mgr_init().
+ */
+esp_err_t search_index_init(void);
+
+/**
+ * Rank lines against a free-text query.
+ * @param prefix   Only return hits whose path starts with this (NULL = all)
+ * @return number of hits written (best first), or -1 on error
+ */
+int search_index_query(const char *query, const char *prefix,
+                       search_hit_t *hits, int max_hits);
+
+/**
+ * Write the index to flash now if it has unsaved changes.
+ */
+esp_err_t search_index_save(void);
+
+/**
+ * Drop and rebuild the whole index from the files on flash.
+ */
+esp_err_t search_index_rebuild(void);
+
+void search_index_get_stats(search_stats_t *out);
@@ -0,0 +1,72 @@
+#include "search/tokenizer.h"
+
+#include <string.h>
+
+static const char *const s_stopwords[] = {
+    "a", "an", "and", "are", "as", "at", "be", "by", "for", "from", "has",
+    "in", "is", "it", "of", "on", "or", "that", "the", "this", "to", "was",
+    "with", NULL,
+};
+
+static bool is_word_byte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+static bool is_stopword(const char *w)
+{
+    for (int i = 0; s_stopwords[i]; i++) {
+        if (strcmp(w, s_stopwords[i]) == 0) return true;
+    }
+    return false;
+}
+
+/* Lowercase in place, strip a plural 's' and reject stopwords. */
+static size_t finish_token(char *tok, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (tok[i] >= 'A' && tok[i] <= 'Z') tok[i] += 'a' - 'A';
+    }
+    /* "notes" -> "note", but keep "ss" endings ("class") and short words */
+    if (len > 3 && tok[len - 1] == 's' && tok[len - 2] != 's') {
+        len--;
+    }
+    tok[len] = '\0';
+    if (len < TOKEN_MIN_LEN || is_stopword(tok)) return 0;
+    return len;
+}
+
+int tokenize(const char *text, size_t len, token_cb_t cb, void *ctx)
+{
+    char tok[TOKEN_MAX_LEN + 1];
+    int count = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        while (i < len && !is_word_byte((unsigned char)text[i])) i++;
+        size_t start = i;
+        while (i < len && is_word_byte((unsigned char)text[i])) i++;
+        if (i == start) break;
+
+        size_t n = i - start;
+        if (n > TOKEN_MAX_LEN) n = TOKEN_MAX_LEN;
+        memcpy(tok, text + start, n);
+        n = finish_token(tok, n);
+        if (n == 0) continue;
+
+        count++;
+        if (!cb(tok, n, start, ctx)) break;
+    }
+    return count;
+}
+
+bool token_normalize(char *word)
+{
+    size_t len = strlen(word);
+    for (size_t i = 0; i < len; i++) {
+        if (!is_word_byte((unsigned char)word[i])) return false;
+    }
+    if (len > TOKEN_MAX_LEN) len = TOKEN_MAX_LEN;
+    return finish_token(word, len) > 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TOKEN_MIN_LEN  2
+#define TOKEN_MAX_LEN  31
+
+/**
+ * Token callback. token is lowercase and NUL-terminated; offset is the
+ * byte position of the token in the input. Return false to stop.
+ */
+typedef bool (*token_cb_t)(const char *token, size_t len, size_t offset, void *ctx);
+
+/**
+ * Split text into search terms: runs of ASCII letters, digits, '_' and
+ * UTF-8 bytes, lowercased, with common stopwords dropped and a trailing
+ * plural 's' stripped. Longer runs are truncated to TOKEN_MAX_LEN.
+ * @return number of tokens passed to cb
+ */
+int tokenize(const char *text, size_t len, token_cb_t cb, void *ctx);
+
+/**
+ * Tokenize a single word in place (e.g. a query term).
+ * @return true if it produced a usable token
+ */
+bool token_normalize(char *word);
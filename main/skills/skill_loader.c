@@ -1,142 +1,57 @@
 #include "skills/skill_loader.h"
 #include "mimi_config.h"
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/file_cache.h"
+#include "storage/file_catalog.h"
+#include "storage/fs_compress.h"
+#include "storage/assets.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <dirent.h>
+#include <sys/stat.h>
 #include "esp_log.h"
 
 static const char *TAG = "skills";
 
-/* ── Built-in skill contents ─────────────────────────────────── */
+#define BUILTIN_PREFIX  "skills/"
 
-#define BUILTIN_WEATHER \
-    "# Weather\n" \
-    "\n" \
-    "Get current weather and forecasts using web_search.\n" \
-    "\n" \
-    "## When to use\n" \
-    "When the user asks about weather, temperature, or forecasts.\n" \
-    "\n" \
-    "## How to use\n" \
-    "1. Use get_current_time to know the current date\n" \
-    "2. Use web_search with a query like \"weather in [city] today\"\n" \
-    "3. Extract temperature, conditions, and forecast from results\n" \
-    "4. Present in a concise, friendly format\n" \
-    "\n" \
-    "## Example\n" \
-    "User: \"What's the weather in Tokyo?\"\n" \
-    "→ get_current_time\n" \
-    "→ web_search \"weather Tokyo today February 2026\"\n" \
-    "→ \"Tokyo: 8°C, partly cloudy. High 12°C, low 4°C. Light wind from the north.\"\n"
+/* ── Built-in skills ─────────────────────────────────────────
+ * Built-ins live in the assets partition as "skills/<name>.md" and are
+ * read in place. A file of the same name under /spiffs/skills/ overrides
+ * one; file_cache_read() falls back to the asset when there is none. */
 
-#define BUILTIN_DAILY_BRIEFING \
-    "# Daily Briefing\n" \
-    "\n" \
-    "Compile a personalized daily briefing for the user.\n" \
-    "\n" \
-    "## When to use\n" \
-    "When the user asks for a daily briefing, morning update, or \"what's new today\".\n" \
-    "Also useful as a heartbeat/cron task.\n" \
-    "\n" \
-    "## How to use\n" \
-    "1. Use get_current_time for today's date\n" \
-    "2. Read /spiffs/memory/MEMORY.md for user preferences and context\n" \
-    "3. Read today's daily note if it exists\n" \
-    "4. Use web_search for relevant news based on user interests\n" \
-    "5. Compile a concise briefing covering:\n" \
-    "   - Date and time\n" \
-    "   - Weather (if location known from USER.md)\n" \
-    "   - Relevant news/updates based on user interests\n" \
-    "   - Any pending tasks from memory\n" \
-    "   - Any scheduled cron jobs\n" \
-    "\n" \
-    "## Format\n" \
-    "Keep it brief — 5-10 bullet points max. Use the user's preferred language.\n"
-
-#define BUILTIN_SKILL_CREATOR \
-    "# Skill Creator\n" \
-    "\n" \
-    "Create new skills for MimiClaw.\n" \
-    "\n" \
-    "## When to use\n" \
-    "When the user asks to create a new skill, teach the bot something, or add a new capability.\n" \
-    "\n" \
-    "## How to create a skill\n" \
-    "1. Choose a short, descriptive name (lowercase, hyphens ok)\n" \
-    "2. Write a SKILL.md file with this structure:\n" \
-    "   - `# Title` — clear name\n" \
-    "   - Brief description paragraph\n" \
-    "   - `## When to use` — trigger conditions\n" \
-    "   - `## How to use` — step-by-step instructions\n" \
-    "   - `## Example` — concrete example (optional but helpful)\n" \
-    "3. Save to `/spiffs/skills/<name>.md` using write_file\n" \
-    "4. The skill will be automatically available after the next conversation\n" \
-    "\n" \
-    "## Best practices\n" \
-    "- Keep skills concise — the context window is limited\n" \
-    "- Focus on WHAT to do, not HOW (the agent is smart)\n" \
-    "- Include specific tool calls the agent should use\n" \
-    "- Test by asking the agent to use the new skill\n" \
-    "\n" \
-    "## Example\n" \
-    "To create a \"translate\" skill:\n" \
-    "write_file path=\"/spiffs/skills/translate.md\" content=\"# Translate\\n\\nTranslate text between languages.\\n\\n" \
-    "## When to use\\nWhen the user asks to translate text.\\n\\n" \
-    "## How to use\\n1. Identify source and target languages\\n" \
-    "2. Translate directly using your language knowledge\\n" \
-    "3. For specialized terms, use web_search to verify\\n\"\n"
-
-/* Built-in skill registry */
-typedef struct {
-    const char *filename;   /* e.g. "weather" */
-    const char *content;
-} builtin_skill_t;
-
-static const builtin_skill_t s_builtins[] = {
-    { "weather",        BUILTIN_WEATHER        },
-    { "daily-briefing", BUILTIN_DAILY_BRIEFING },
-    { "skill-creator",  BUILTIN_SKILL_CREATOR  },
-};
-
-#define NUM_BUILTINS (sizeof(s_builtins) / sizeof(s_builtins[0]))
-
-/* ── Install built-in skills if missing ──────────────────────── */
-
-static void install_builtin(const builtin_skill_t *skill)
+/* Older firmware copied the built-ins to SPIFFS on every boot. An
+ * unmodified copy would shadow newer built-ins, so drop it. */
+static bool on_builtin_copy(const char *name, const char *data, size_t len, void *ctx)
 {
+    int *dropped = ctx;
     char path[64];
-    snprintf(path, sizeof(path), "%s%s.md", MIMI_SKILLS_PREFIX, skill->filename);
-
-    /* Check if already exists */
-    FILE *f = fopen(path, "r");
-    if (f) {
-        fclose(f);
-        ESP_LOGD(TAG, "Skill exists: %s", path);
-        return;
+    snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, name);
+    if (file_catalog_ready() && !file_catalog_stat(path, NULL)) return true;
+
+    size_t cur_len = 0;
+    char *cur = fs_compress_read_alloc(path, len, &cur_len);
+    if (cur && cur_len == len && memcmp(cur, data, len) == 0 && remove(path) == 0) {
+        storage_notify(STORAGE_EVT_REMOVED, path);
+        (*dropped)++;
     }
-
-    /* Write built-in skill */
-    f = fopen(path, "w");
-    if (!f) {
-        ESP_LOGE(TAG, "Cannot write skill: %s", path);
-        return;
-    }
-
-    fputs(skill->content, f);
-    fclose(f);
-    ESP_LOGI(TAG, "Installed built-in skill: %s", path);
+    free(cur);
+    return true;
 }
 
 esp_err_t skill_loader_init(void)
 {
     ESP_LOGI(TAG, "Initializing skills system");
 
-    for (size_t i = 0; i < NUM_BUILTINS; i++) {
-        install_builtin(&s_builtins[i]);
+    int dropped = 0;
+    int builtins = assets_list(BUILTIN_PREFIX, on_builtin_copy, &dropped);
+    if (dropped) {
+        ESP_LOGI(TAG, "Removed %d stale copies of built-in skills", dropped);
     }
 
-    ESP_LOGI(TAG, "Skills system ready (%d built-in)", (int)NUM_BUILTINS);
+    ESP_LOGI(TAG, "Skills system ready (%d built-in)", builtins);
     return ESP_OK;
 }
 
@@ -167,14 +82,20 @@ static const char *extract_title(const char *line, size_t len, char *out, size_t
 
 /**
  * Extract description: text between the first line and the first blank line.
+ * text starts after the title line.
  */
-static void extract_description(FILE *f, char *out, size_t out_size)
+static void extract_description(const char *text, char *out, size_t out_size)
 {
     size_t off = 0;
     char line[256];
 
-    while (fgets(line, sizeof(line), f) && off < out_size - 1) {
-        size_t len = strlen(line);
+    while (*text && off < out_size - 1) {
+        size_t len = strcspn(text, "\n");
+        if (text[len] == '\n') len++;
+        if (len > sizeof(line) - 1) len = sizeof(line) - 1;
+        memcpy(line, text, len);
+        line[len] = '\0';
+        text += len;
 
         /* Stop at blank line or section header */
         if (len == 0 || (len == 1 && line[0] == '\n') ||
@@ -200,63 +121,72 @@ static void extract_description(FILE *f, char *out, size_t out_size)
     out[off] = '\0';
 }
 
-size_t skill_loader_build_summary(char *buf, size_t size)
-{
-    DIR *dir = opendir(MIMI_SPIFFS_BASE);
-    if (!dir) {
-        ESP_LOGW(TAG, "Cannot open SPIFFS for skill enumeration");
-        buf[0] = '\0';
-        return 0;
-    }
-
-    size_t off = 0;
-    struct dirent *ent;
-    /* SPIFFS readdir returns filenames relative to the mount point (e.g. "skills/weather.md").
-       We match entries that start with "skills/" and end with ".md". */
-    const char *skills_subdir = "skills/";
-    const size_t subdir_len = strlen(skills_subdir);
-
-    while ((ent = readdir(dir)) != NULL && off < size - 1) {
-        const char *name = ent->d_name;
-
-        /* Match files under skills/ with .md extension */
-        if (strncmp(name, skills_subdir, subdir_len) != 0) continue;
-
-        size_t name_len = strlen(name);
-        if (name_len < subdir_len + 4) continue;  /* at least "skills/x.md" */
-        if (strcmp(name + name_len - 3, ".md") != 0) continue;
-
-        /* Build full path */
-        char full_path[296];
-        snprintf(full_path, sizeof(full_path), "%s/%s", MIMI_SPIFFS_BASE, name);
-
-        FILE *f = fopen(full_path, "r");
-        if (!f) continue;
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t off;
+} summary_ctx_t;
 
-        /* Read first line for title */
-        char first_line[128];
-        if (!fgets(first_line, sizeof(first_line), f)) {
-            fclose(f);
-            continue;
-        }
+/* Append one "- **Title**: description" line for the skill at path. */
+static void append_skill(summary_ctx_t *sc, const char *path, const char *text)
+{
+    /* First line is the title */
+    size_t first_len = strcspn(text, "\n");
+    char title[64];
+    extract_title(text, first_len, title, sizeof(title));
+
+    /* Description runs until a blank line */
+    char desc[256];
+    extract_description(text + first_len + (text[first_len] == '\n'), desc, sizeof(desc));
+
+    /* Append to summary */
+    sc->off += snprintf(sc->buf + sc->off, sc->size - sc->off,
+        "- **%s**: %s (read with: read_file %s)\n",
+        title, desc, path);
+    if (sc->off > sc->size - 1) sc->off = sc->size - 1;
+}
 
-        char title[64];
-        extract_title(first_line, strlen(first_line), title, sizeof(title));
+static bool on_skill_file(const char *path, void *arg)
+{
+    summary_ctx_t *sc = arg;
+    if (sc->off >= sc->size - 1) return false;
+
+    /* Match files under skills/ with .md extension */
+    size_t len = strlen(path);
+    if (len < strlen(MIMI_SKILLS_PREFIX) + 4) return true;  /* at least "skills/x.md" */
+    if (strcmp(path + len - 3, ".md") != 0) return true;
+
+    /* Title and description fit in the head of the file */
+    char head[640];
+    if (file_cache_read(path, head, sizeof(head)) <= 0) return true;
+    append_skill(sc, path, head);
+    return true;
+}
 
-        /* Read description (until blank line) */
-        char desc[256];
-        extract_description(f, desc, sizeof(desc));
-        fclose(f);
+static bool on_builtin_skill(const char *name, const char *data, size_t len, void *arg)
+{
+    summary_ctx_t *sc = arg;
+    if (sc->off >= sc->size - 1) return false;
 
-        /* Append to summary */
-        off += snprintf(buf + off, size - off,
-            "- **%s**: %s (read with: read_file %s)\n",
-            title, desc, full_path);
+    /* Overridden built-ins were listed with the user's skills */
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, name);
+    struct stat st;
+    bool overridden = file_catalog_ready() ? file_catalog_stat(path, NULL) : stat(path, &st) == 0;
+    if (!overridden && len > 0) {
+        append_skill(sc, path, data);
     }
+    return true;
+}
 
-    closedir(dir);
-
-    buf[off] = '\0';
-    ESP_LOGI(TAG, "Skills summary: %d bytes", (int)off);
-    return off;
+size_t skill_loader_build_summary(char *buf, size_t size)
+{
+    summary_ctx_t sc = { .buf = buf, .size = size, .off = 0 };
+    buf[0] = '\0';
+    fs_list(MIMI_SKILLS_PREFIX, on_skill_file, &sc);
+    assets_list(BUILTIN_PREFIX, on_builtin_skill, &sc);
+
+    buf[sc.off] = '\0';
+    ESP_LOGI(TAG, "Skills summary: %d bytes", (int)sc.off);
+    return sc.off;
 }
@@ -5,13 +5,15 @@
 
 /**
  * Initialize skills system.
- * Installs built-in skill files to SPIFFS if they don't already exist.
+ * Built-in skills are read in place from the assets partition; this only
+ * drops unmodified SPIFFS copies left by older firmware.
  */
 esp_err_t skill_loader_init(void);
 
 /**
  * Build a summary of all available skills for the system prompt.
- * Lists each skill with its title and description.
+ * Lists each skill with its title and description: the user's skills,
+ * then the built-ins they do not override.
  *
  * @param buf   Output buffer
  * @param size  Buffer size
@@ -0,0 +1,138 @@
+#include "storage/assets.h"
+#include "mimi_config.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "assets";
+
+/* Image layout, written by scripts/pack_assets.py (little-endian) */
+#define ASSETS_MAGIC     "MAS1"
+#define ASSETS_NAME_MAX  56
+
+typedef struct {
+    char magic[4];
+    uint32_t count;
+    uint32_t length;            /* Header, table and data */
+    uint32_t crc32;             /* Of bytes 16..length */
+} assets_header_t;
+
+typedef struct {
+    char name[ASSETS_NAME_MAX]; /* NUL-padded, entries sorted by name */
+    uint32_t offset;            /* From the start of the image */
+    uint32_t length;            /* Without the NUL that follows the data */
+} assets_entry_t;
+
+static const uint8_t *s_base = NULL;
+static const assets_entry_t *s_entries = NULL;
+static int s_count = 0;
+
+static bool image_valid(const uint8_t *base, size_t part_size)
+{
+    const assets_header_t *h = (const assets_header_t *)base;
+    if (memcmp(h->magic, ASSETS_MAGIC, 4) != 0) return false;
+    if (h->length > part_size ||
+        sizeof(*h) + (size_t)h->count * sizeof(assets_entry_t) > h->length) {
+        return false;
+    }
+    if (esp_rom_crc32_le(0, base + sizeof(*h), h->length - sizeof(*h)) != h->crc32) return false;
+
+    const assets_entry_t *e = (const assets_entry_t *)(base + sizeof(*h));
+    for (uint32_t i = 0; i < h->count; i++) {
+        if (e[i].name[ASSETS_NAME_MAX - 1] != '\0' ||
+            (uint64_t)e[i].offset + e[i].length >= h->length ||
+            base[e[i].offset + e[i].length] != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t assets_init(void)
+{
+    if (s_base) return ESP_OK;
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY,
+                                                           MIMI_ASSETS_PARTITION);
+    if (!part) {
+        ESP_LOGW(TAG, "No '%s' partition; built-in skills and prompts unavailable",
+                 MIMI_ASSETS_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    /* Stays mapped for the life of the firmware */
+    if (!image_valid(ptr, part->size)) {
+        ESP_LOGE(TAG, "Assets image missing or corrupt; run idf.py flash");
+        esp_partition_munmap(handle);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const assets_header_t *h = ptr;
+    s_base = ptr;
+    s_entries = (const assets_entry_t *)(s_base + sizeof(*h));
+    s_count = (int)h->count;
+    ESP_LOGI(TAG, "Mapped %d assets, %u bytes", s_count, (unsigned)h->length);
+    return ESP_OK;
+}
+
+/* Index of the first entry whose name is >= name */
+static int lower_bound(const char *name)
+{
+    int lo = 0, hi = s_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(s_entries[mid].name, name) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+const char *assets_get(const char *name, size_t *len)
+{
+    if (len) *len = 0;
+    if (!s_base) return NULL;
+
+    int i = lower_bound(name);
+    if (i >= s_count || strcmp(s_entries[i].name, name) != 0) return NULL;
+    if (len) *len = s_entries[i].length;
+    return (const char *)s_base + s_entries[i].offset;
+}
+
+const char *assets_get_path(const char *path, size_t *len)
+{
+    size_t base_len = strlen(MIMI_SPIFFS_BASE);
+    if (strncmp(path, MIMI_SPIFFS_BASE "/", base_len + 1) != 0) {
+        if (len) *len = 0;
+        return NULL;
+    }
+    return assets_get(path + base_len + 1, len);
+}
+
+int assets_list(const char *prefix, assets_list_cb_t cb, void *ctx)
+{
+    if (!s_base) return 0;
+
+    size_t plen = strlen(prefix);
+    int visited = 0;
+    for (int i = lower_bound(prefix); i < s_count; i++) {
+        const assets_entry_t *e = &s_entries[i];
+        if (strncmp(e->name, prefix, plen) != 0) break;
+        visited++;
+        if (!cb(e->name, (const char *)s_base + e->offset, e->length, ctx)) break;
+    }
+    return visited;
+}
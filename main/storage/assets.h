@@ -0,0 +1,44 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Read-only assets: built-in skills and prompt templates.
+ *
+ * scripts/pack_assets.py packs assets_data/ into the MIMI_ASSETS_PARTITION
+ * partition at build time. It is memory-mapped once at boot, and callers
+ * read the contents in place; nothing is copied to RAM or SPIFFS. An asset
+ * named "skills/weather.md" stands in for /spiffs/skills/weather.md until
+ * a file of that name is written to override it.
+ */
+
+/** Visitor for assets_list(); data is NUL-terminated. Return false to stop. */
+typedef bool (*assets_list_cb_t)(const char *name, const char *data, size_t len, void *ctx);
+
+/**
+ * Map the assets partition and check its table and CRC.
+ * @return ESP_ERR_NOT_FOUND when the partition table has no assets
+ *         partition, ESP_ERR_INVALID_CRC when the image is missing or bad
+ */
+esp_err_t assets_init(void);
+
+/**
+ * Contents of one asset, e.g. "prompts/system.md", in mapped flash.
+ * @param len  Out: length without the terminating NUL (may be NULL)
+ * @return NULL when there is no such asset
+ */
+const char *assets_get(const char *name, size_t *len);
+
+/**
+ * The asset standing in for a path under MIMI_SPIFFS_BASE, e.g.
+ * "/spiffs/skills/weather.md" -> "skills/weather.md".
+ */
+const char *assets_get_path(const char *path, size_t *len);
+
+/**
+ * Visit the assets whose name starts with prefix, in name order.
+ * @return number visited
+ */
+int assets_list(const char *prefix, assets_list_cb_t cb, void *ctx);
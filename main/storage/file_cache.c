@@ -0,0 +1,387 @@
+#include "storage/file_cache.h"
+#include "storage/file_catalog.h"
+#include "storage/fs_compress.h"
+#include "storage/assets.h"
+#include "storage/fs_writer.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "fcache";
+
+typedef struct {
+    char path[MIMI_FS_CATALOG_PATH_MAX];
+    char *data;                 /* PSRAM, len + 1 bytes, NULL when free */
+    size_t len;
+    uint32_t last_use;
+} cache_slot_t;
+
+static cache_slot_t *s_slots = NULL;
+static char (*s_absent)[MIMI_FS_CATALOG_PATH_MAX] = NULL;  /* Known missing, "" = free */
+static int s_absent_next = 0;
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_tick = 0;
+static uint32_t s_gen = 0;      /* Bumped by every invalidation */
+static file_cache_stats_t s_stats = {0};
+
+/* ── Slots ──────────────────────────────────────────────────── */
+
+/* Caller holds s_lock. */
+static cache_slot_t *slot_find(const char *path)
+{
+    for (int i = 0; i < MIMI_FILE_CACHE_SLOTS; i++) {
+        if (s_slots[i].data && strcmp(s_slots[i].path, path) == 0) return &s_slots[i];
+    }
+    return NULL;
+}
+
+/* Caller holds s_lock. */
+static void slot_free(cache_slot_t *s)
+{
+    s_stats.bytes -= s->len;
+    s_stats.entries--;
+    free(s->data);
+    s->data = NULL;
+    s->len = 0;
+}
+
+/* Caller holds s_lock. Takes ownership of data. */
+static void slot_insert(const char *path, char *data, size_t len)
+{
+    while (1) {
+        cache_slot_t *lru = NULL, *empty = NULL;
+        for (int i = 0; i < MIMI_FILE_CACHE_SLOTS; i++) {
+            cache_slot_t *s = &s_slots[i];
+            if (!s->data) {
+                if (!empty) empty = s;
+            } else if (!lru || s->last_use < lru->last_use) {
+                lru = s;
+            }
+        }
+        if (empty && s_stats.bytes + len <= MIMI_FILE_CACHE_BYTES) {
+            strcpy(empty->path, path);
+            empty->data = data;
+            empty->len = len;
+            empty->last_use = ++s_tick;
+            s_stats.bytes += len;
+            s_stats.entries++;
+            return;
+        }
+        if (!lru) {
+            free(data);
+            return;
+        }
+        slot_free(lru);
+        s_stats.evictions++;
+    }
+}
+
+/* ── Absent paths ───────────────────────────────────────────── */
+
+/* Caller holds s_lock. */
+static bool absent_find(const char *path)
+{
+    for (int i = 0; i < MIMI_FILE_CACHE_ABSENT_SLOTS; i++) {
+        if (s_absent[i][0] && strcmp(s_absent[i], path) == 0) return true;
+    }
+    return false;
+}
+
+/* Caller holds s_lock. */
+static void absent_add(const char *path)
+{
+    if (absent_find(path)) return;
+    strcpy(s_absent[s_absent_next], path);
+    s_absent_next = (s_absent_next + 1) % MIMI_FILE_CACHE_ABSENT_SLOTS;
+}
+
+/* Caller holds s_lock. A change to "<path>.z" forgets path too. */
+static void absent_drop(const char *path)
+{
+    size_t n = strlen(path);
+    size_t e = sizeof(FS_COMPRESS_EXT) - 1;
+    bool packed = n > e && strcmp(path + n - e, FS_COMPRESS_EXT) == 0;
+    for (int i = 0; i < MIMI_FILE_CACHE_ABSENT_SLOTS; i++) {
+        const char *a = s_absent[i];
+        if (strcmp(a, path) == 0 ||
+            (packed && strlen(a) == n - e && strncmp(a, path, n - e) == 0)) {
+            s_absent[i][0] = '\0';
+        }
+    }
+}
+
+/* ── Lookup ─────────────────────────────────────────────────── */
+
+typedef enum {
+    LOOKUP_HIT = 0,
+    LOOKUP_ABSENT,
+    LOOKUP_LOAD,
+    LOOKUP_LARGE,
+} lookup_t;
+
+/*
+ * Once built, the catalog hears of every write through storage_notify(),
+ * so a path it lists in neither plain nor packed form is missing. Before
+ * it is built, or after it overflowed, ask flash; lookup() then remembers
+ * the miss so a note that does not exist yet is not statted every turn.
+ */
+static bool exists_uncataloged(const char *path, file_catalog_entry_t *ent)
+{
+    char zpath[MIMI_FS_CATALOG_PATH_MAX + sizeof(FS_COMPRESS_EXT)];
+    snprintf(zpath, sizeof(zpath), "%s" FS_COMPRESS_EXT, path);
+    ent->size = 0;              /* Packed: the inflated size is checked on load */
+    if (file_catalog_ready()) return file_catalog_stat(zpath, NULL);
+
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        ent->size = (uint32_t)st.st_size;
+        return true;
+    }
+    return stat(zpath, &st) == 0;
+}
+
+/*
+ * On a hit, copy calls back with the cached bytes while the lock is held.
+ * Otherwise returns what the caller should do without the lock.
+ */
+static lookup_t lookup(const char *path, void (*copy)(const char *, size_t, void *), void *arg,
+                       uint32_t *gen)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    cache_slot_t *s = slot_find(path);
+    if (s) {
+        s->last_use = ++s_tick;
+        s_stats.hits++;
+        copy(s->data, s->len, arg);
+        xSemaphoreGive(s_lock);
+        return LOOKUP_HIT;
+    }
+    *gen = s_gen;
+    bool known_absent = absent_find(path);
+    xSemaphoreGive(s_lock);
+
+    /* Paths too long for the catalog are never cached: read them directly */
+    file_catalog_entry_t ent = {0};
+    lookup_t res = LOOKUP_LOAD;
+    bool statted = false;
+    if (strlen(path) >= MIMI_FS_CATALOG_PATH_MAX) {
+        res = LOOKUP_LARGE;
+    } else if (known_absent) {
+        res = LOOKUP_ABSENT;
+    } else if (!file_catalog_stat(path, &ent)) {
+        statted = !file_catalog_ready();
+        if (!exists_uncataloged(path, &ent)) res = LOOKUP_ABSENT;
+    }
+    if (res == LOOKUP_LOAD && ent.size > MIMI_FILE_CACHE_MAX_FILE) res = LOOKUP_LARGE;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (res == LOOKUP_ABSENT) {
+        s_stats.absent++;
+        /* Unless the path changed while flash was asked */
+        if (statted && *gen == s_gen) absent_add(path);
+    }
+    if (res == LOOKUP_LARGE) s_stats.bypass++;
+    xSemaphoreGive(s_lock);
+    return res;
+}
+
+/* Cache data unless the file was invalidated while it was being read. */
+static void publish(const char *path, const char *data, size_t len, uint32_t gen)
+{
+    char *copy = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (!copy) return;
+    memcpy(copy, data, len + 1);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.misses++;
+    if (gen == s_gen && !slot_find(path)) {
+        slot_insert(path, copy, len);
+    } else {
+        free(copy);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+typedef struct {
+    char *buf;
+    size_t size;
+    int n;
+} read_ctx_t;
+
+static void copy_to_buf(const char *data, size_t len, void *arg)
+{
+    read_ctx_t *rc = arg;
+    size_t n = len < rc->size - 1 ? len : rc->size - 1;
+    memcpy(rc->buf, data, n);
+    rc->buf[n] = '\0';
+    rc->n = (int)n;
+}
+
+typedef struct {
+    size_t max;
+    size_t len;
+    char *out;
+} alloc_ctx_t;
+
+static void copy_to_alloc(const char *data, size_t len, void *arg)
+{
+    alloc_ctx_t *ac = arg;
+    ac->len = len;
+    if (len > ac->max) return;
+    ac->out = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (ac->out) memcpy(ac->out, data, len + 1);
+}
+
+/* A file that does not exist may be a built-in asset (see assets.h). */
+static int read_asset(const char *path, char *buf, size_t size)
+{
+    read_ctx_t rc = { .buf = buf, .size = size, .n = -1 };
+    size_t len = 0;
+    const char *data = assets_get_path(path, &len);
+    if (!data) {
+        buf[0] = '\0';
+        return -1;
+    }
+    copy_to_buf(data, len, &rc);
+    return rc.n;
+}
+
+static char *alloc_asset(const char *path, size_t max, size_t *len)
+{
+    alloc_ctx_t ac = { .max = max };
+    const char *data = assets_get_path(path, &ac.len);
+    if (data) copy_to_alloc(data, ac.len, &ac);
+    *len = ac.len;
+    return ac.out;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t file_cache_init(void)
+{
+    if (s_slots) return ESP_OK;
+
+    s_lock = xSemaphoreCreateMutex();
+    s_slots = heap_caps_calloc(MIMI_FILE_CACHE_SLOTS, sizeof(cache_slot_t), MALLOC_CAP_SPIRAM);
+    s_absent = heap_caps_calloc(MIMI_FILE_CACHE_ABSENT_SLOTS, sizeof(*s_absent), MALLOC_CAP_SPIRAM);
+    if (!s_lock || !s_slots || !s_absent) {
+        ESP_LOGE(TAG, "Failed to allocate file cache");
+        free(s_slots);
+        free(s_absent);
+        s_slots = NULL;
+        s_absent = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "File cache: %d slots, %d KB, files up to %d KB", MIMI_FILE_CACHE_SLOTS,
+             MIMI_FILE_CACHE_BYTES / 1024, MIMI_FILE_CACHE_MAX_FILE / 1024);
+    return ESP_OK;
+}
+
+int file_cache_read(const char *path, char *buf, size_t size)
+{
+    if (size == 0) return -1;
+
+    read_ctx_t pending = { .buf = buf, .size = size, .n = -1 };
+    if (fs_writer_peek(path, copy_to_buf, &pending)) return pending.n;
+
+    uint32_t gen = 0;
+    if (s_slots) {
+        read_ctx_t rc = { .buf = buf, .size = size, .n = -1 };
+        lookup_t res = lookup(path, copy_to_buf, &rc, &gen);
+        if (res == LOOKUP_HIT) return rc.n;
+        if (res == LOOKUP_ABSENT) return read_asset(path, buf, size);
+        if (res == LOOKUP_LOAD) {
+            size_t len = 0;
+            char *data = fs_compress_read_alloc(path, MIMI_FILE_CACHE_MAX_FILE, &len);
+            if (data) {
+                publish(path, data, len, gen);
+                copy_to_buf(data, len, &rc);
+                free(data);
+                return rc.n;
+            }
+            /* Missing, or larger than the catalog knew: read it directly */
+        }
+    }
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        /* An archive inflates whole, so it has to fit the archive limit */
+        size_t len = 0;
+        char *data = fs_compress_read_alloc(path, MIMI_FS_COMPRESS_MAX, &len);
+        if (!data) return read_asset(path, buf, size);
+        read_ctx_t rc = { .buf = buf, .size = size, .n = -1 };
+        copy_to_buf(data, len, &rc);
+        free(data);
+        return rc.n;
+    }
+    size_t n = fread(buf, 1, size - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+    return (int)n;
+}
+
+char *file_cache_read_alloc(const char *path, size_t max, size_t *len)
+{
+    *len = 0;
+    alloc_ctx_t pending = { .max = max };
+    if (fs_writer_peek(path, copy_to_alloc, &pending)) {
+        *len = pending.len;
+        return pending.out;
+    }
+
+    uint32_t gen = 0;
+    if (s_slots) {
+        alloc_ctx_t ac = { .max = max };
+        lookup_t res = lookup(path, copy_to_alloc, &ac, &gen);
+        if (res == LOOKUP_HIT) {
+            *len = ac.len;
+            return ac.out;
+        }
+        if (res == LOOKUP_ABSENT) return alloc_asset(path, max, len);
+        if (res == LOOKUP_LOAD) {
+            char *data = fs_compress_read_alloc(path, MIMI_FILE_CACHE_MAX_FILE, len);
+            if (data) {
+                publish(path, data, *len, gen);
+                if (*len <= max) return data;
+                free(data);
+                return NULL;
+            }
+        }
+    }
+    char *data = fs_compress_read_alloc(path, max, len);
+    if (!data && *len == 0) return alloc_asset(path, max, len);
+    return data;
+}
+
+void file_cache_invalidate(const char *path)
+{
+    if (!s_slots || !path) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_gen++;
+    absent_drop(path);
+    cache_slot_t *s = slot_find(path);
+    if (s) {
+        slot_free(s);
+        s_stats.invalidations++;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void file_cache_get_stats(file_cache_stats_t *out)
+{
+    if (!s_slots) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Read-through PSRAM cache for small files under MIMI_SPIFFS_BASE.
+ *
+ * Files up to MIMI_FILE_CACHE_MAX_FILE bytes are kept whole, LRU within
+ * MIMI_FILE_CACHE_SLOTS / MIMI_FILE_CACHE_BYTES. storage_notify() drops a
+ * file's copy when it is written or removed. A file the catalog does not
+ * list is reported missing without touching flash, unless a built-in asset
+ * of the same name stands in for it (see assets.h). A file with a pending
+ * coalesced write (see fs_writer.h) reads as its new contents. Packed files (see
+ * fs_compress.h) come back inflated. Modules read config, memory, skill
+ * and heartbeat files through here instead of fopen().
+ */
+
+typedef struct {
+    uint32_t hits;              /* Served from PSRAM */
+    uint32_t absent;            /* Missing (catalog, absent list or flash) */
+    uint32_t misses;            /* Read from flash and cached */
+    uint32_t bypass;            /* Read from flash, too large to cache */
+    uint32_t evictions;
+    uint32_t invalidations;
+    int entries;
+    size_t bytes;
+} file_cache_stats_t;
+
+/** Allocate the cache. Called by fs_mount(). */
+esp_err_t file_cache_init(void);
+
+/**
+ * Copy up to size - 1 bytes of path into buf and NUL-terminate it.
+ * @return bytes copied, or -1 when neither the file nor an asset exists
+ */
+int file_cache_read(const char *path, char *buf, size_t size);
+
+/**
+ * Whole file in a new NUL-terminated buffer the caller frees.
+ * @param max  Refuse files larger than this
+ * @param len  Out: file length (also set when the file is too large)
+ * @return NULL when missing, larger than max, or out of memory
+ */
+char *file_cache_read_alloc(const char *path, size_t max, size_t *len);
+
+/** Drop the cached copy of path. storage_notify() calls this. */
+void file_cache_invalidate(const char *path);
+
+void file_cache_get_stats(file_cache_stats_t *out);
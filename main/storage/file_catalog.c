@@ -0,0 +1,295 @@
+#include "storage/file_catalog.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "catalog";
+
+static file_catalog_entry_t *s_entries = NULL;   /* Sorted by path */
+static int s_count = 0;
+static bool s_complete = false;
+static SemaphoreHandle_t s_lock = NULL;
+
+/* ── Sorted array ───────────────────────────────────────────── */
+
+/* First entry whose path is >= key. */
+static int lower_bound(const char *key)
+{
+    int lo = 0, hi = s_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(s_entries[mid].path, key) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int find(const char *path)
+{
+    int i = lower_bound(path);
+    return i < s_count && strcmp(s_entries[i].path, path) == 0 ? i : -1;
+}
+
+static bool tracked(const char *path)
+{
+    return strncmp(path, MIMI_SPIFFS_BASE "/", strlen(MIMI_SPIFFS_BASE "/")) == 0;
+}
+
+static void entry_set(file_catalog_entry_t *e, const char *path, const struct stat *st)
+{
+    strcpy(e->path, path);
+    e->size = (uint32_t)st->st_size;
+    e->mtime = (uint32_t)st->st_mtime;
+}
+
+/* Caller holds s_lock. */
+static void upsert(const char *path, const struct stat *st)
+{
+    if (strlen(path) >= MIMI_FS_CATALOG_PATH_MAX) {
+        if (s_complete) ESP_LOGW(TAG, "Path too long for catalog: %s", path);
+        s_complete = false;
+        return;
+    }
+
+    int i = lower_bound(path);
+    if (i < s_count && strcmp(s_entries[i].path, path) == 0) {
+        entry_set(&s_entries[i], path, st);
+        return;
+    }
+    if (s_count >= MIMI_FS_CATALOG_MAX) {
+        if (s_complete) ESP_LOGW(TAG, "Catalog full (%d files), listing falls back to scans", s_count);
+        s_complete = false;
+        return;
+    }
+    memmove(&s_entries[i + 1], &s_entries[i], (s_count - i) * sizeof(file_catalog_entry_t));
+    entry_set(&s_entries[i], path, st);
+    s_count++;
+}
+
+/* Caller holds s_lock. */
+static void drop(const char *path)
+{
+    int i = find(path);
+    if (i < 0) return;
+    s_count--;
+    memmove(&s_entries[i], &s_entries[i + 1], (s_count - i) * sizeof(file_catalog_entry_t));
+}
+
+/* ── Build ──────────────────────────────────────────────────── */
+
+static bool on_build_file(const char *path, void *arg)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return true;
+    if (strlen(path) >= MIMI_FS_CATALOG_PATH_MAX || s_count >= MIMI_FS_CATALOG_MAX) {
+        s_complete = false;
+        return true;
+    }
+    /* Appended unsorted; build_locked() sorts once at the end */
+    entry_set(&s_entries[s_count++], path, &st);
+    return true;
+}
+
+static int cmp_path(const void *a, const void *b)
+{
+    return strcmp(((const file_catalog_entry_t *)a)->path,
+                  ((const file_catalog_entry_t *)b)->path);
+}
+
+static void build_locked(void)
+{
+    s_count = 0;
+    s_complete = true;
+    fs_scan(MIMI_SPIFFS_BASE "/", on_build_file, NULL);
+    qsort(s_entries, s_count, sizeof(file_catalog_entry_t), cmp_path);
+}
+
+/* ── Check ──────────────────────────────────────────────────── */
+
+typedef struct {
+    file_catalog_check_t *out;
+    uint8_t *seen;
+} check_ctx_t;
+
+static void check_note(file_catalog_check_t *out, const char *what, const char *path)
+{
+    if (!out->first[0]) snprintf(out->first, sizeof(out->first), "%s %s", what, path);
+}
+
+static bool on_check_file(const char *path, void *arg)
+{
+    check_ctx_t *cc = arg;
+    struct stat st;
+    if (stat(path, &st) != 0) return true;
+    cc->out->scanned++;
+
+    int i = find(path);
+    if (i < 0) {
+        cc->out->missing++;
+        check_note(cc->out, "missing", path);
+        return true;
+    }
+    cc->seen[i] = 1;
+    if (s_entries[i].size != (uint32_t)st.st_size || s_entries[i].mtime != (uint32_t)st.st_mtime) {
+        cc->out->stale++;
+        check_note(cc->out, "stale", path);
+    }
+    return true;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t file_catalog_build(void)
+{
+    if (!s_entries) {
+        s_lock = xSemaphoreCreateMutex();
+        s_entries = heap_caps_calloc(MIMI_FS_CATALOG_MAX, sizeof(file_catalog_entry_t),
+                                     MALLOC_CAP_SPIRAM);
+        if (!s_lock || !s_entries) {
+            ESP_LOGE(TAG, "Failed to allocate file catalog");
+            free(s_entries);
+            s_entries = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    build_locked();
+    int count = s_count;
+    bool complete = s_complete;
+    xSemaphoreGive(s_lock);
+
+    if (complete) {
+        ESP_LOGI(TAG, "Catalog: %d files", count);
+    } else {
+        ESP_LOGW(TAG, "Catalog incomplete (%d files cataloged), listing falls back to scans", count);
+    }
+    return ESP_OK;
+}
+
+bool file_catalog_ready(void)
+{
+    return s_entries && s_complete;
+}
+
+void file_catalog_changed(const char *path)
+{
+    if (!s_entries || !path || !tracked(path)) return;
+
+    struct stat st;
+    bool exists = stat(path, &st) == 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (exists) {
+        upsert(path, &st);
+    } else {
+        drop(path);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void file_catalog_removed(const char *path)
+{
+    if (!s_entries || !path || !tracked(path)) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    drop(path);
+    xSemaphoreGive(s_lock);
+}
+
+int file_catalog_list(const char *prefix, fs_list_cb_t cb, void *ctx)
+{
+    if (!s_entries) return -1;
+
+    size_t prefix_len = strlen(prefix);
+    char (*paths)[MIMI_FS_CATALOG_PATH_MAX] = NULL;
+    int n = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_complete) {
+        xSemaphoreGive(s_lock);
+        return -1;
+    }
+    int first = lower_bound(prefix);
+    int end = first;
+    while (end < s_count && strncmp(s_entries[end].path, prefix, prefix_len) == 0) end++;
+    if (end > first) {
+        paths = heap_caps_malloc((end - first) * sizeof(*paths), MALLOC_CAP_SPIRAM);
+        if (!paths) {
+            xSemaphoreGive(s_lock);
+            return -1;
+        }
+        for (int i = first; i < end; i++) {
+            memcpy(paths[n++], s_entries[i].path, sizeof(*paths));
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    int visited = 0;
+    for (int i = 0; i < n; i++) {
+        visited++;
+        if (!cb(paths[i], ctx)) break;
+    }
+    free(paths);
+    return visited;
+}
+
+bool file_catalog_stat(const char *path, file_catalog_entry_t *out)
+{
+    if (!s_entries) return false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find(path);
+    if (i >= 0 && out) *out = s_entries[i];
+    xSemaphoreGive(s_lock);
+    return i >= 0;
+}
+
+esp_err_t file_catalog_check(bool repair, file_catalog_check_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!s_entries) return ESP_ERR_INVALID_STATE;
+
+    /* Held across the scan so entry indices stay put; the visitor only stats */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    check_ctx_t cc = { .out = out, .seen = calloc(s_count ? s_count : 1, 1) };
+    if (!cc.seen) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    out->entries = s_count;
+    fs_scan(MIMI_SPIFFS_BASE "/", on_check_file, &cc);
+    for (int i = 0; i < s_count; i++) {
+        if (cc.seen[i]) continue;
+        out->extra++;
+        check_note(out, "extra", s_entries[i].path);
+    }
+    free(cc.seen);
+
+    bool differs = out->missing || out->stale || out->extra || !s_complete;
+    if (repair && differs) {
+        build_locked();
+        ESP_LOGW(TAG, "Catalog rebuilt: %d missing, %d stale, %d extra",
+                 out->missing, out->stale, out->extra);
+    }
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+int file_catalog_count(void)
+{
+    if (!s_entries) return 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int n = s_count;
+    xSemaphoreGive(s_lock);
+    return n;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "esp_err.h"
+#include "mimi_config.h"
+#include "storage/fs_backend.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * In-RAM catalog of the files under MIMI_SPIFFS_BASE.
+ *
+ * Built once at mount from a full listing and kept current by
+ * storage_notify(), so fs_list() can answer from PSRAM instead of walking
+ * flash. Entries are sorted by path, which puts every directory (and any
+ * other prefix) in one contiguous run: a listing is a binary search plus
+ * the matches. If the catalog overflows, fs_list() falls back to scanning.
+ */
+
+typedef struct {
+    char path[MIMI_FS_CATALOG_PATH_MAX];
+    uint32_t size;
+    uint32_t mtime;
+} file_catalog_entry_t;
+
+typedef struct {
+    int entries;            /* Files in the catalog */
+    int scanned;            /* Files found on flash */
+    int missing;            /* On flash, not in the catalog */
+    int stale;              /* Size or mtime differs */
+    int extra;              /* In the catalog, gone from flash */
+    char first[64];         /* First mismatch, e.g. "missing /spiffs/cron.json" */
+} file_catalog_check_t;
+
+/**
+ * (Re)build the catalog from a full scan. Called by fs_mount().
+ */
+esp_err_t file_catalog_build(void);
+
+/**
+ * false until built, or after it overflowed MIMI_FS_CATALOG_MAX entries
+ * or met a path longer than MIMI_FS_CATALOG_PATH_MAX.
+ */
+bool file_catalog_ready(void);
+
+/** Re-stat path and add or update its entry (drops it if it is gone). */
+void file_catalog_changed(const char *path);
+
+void file_catalog_removed(const char *path);
+
+/**
+ * Visit the cataloged files whose path starts with prefix, in path order.
+ * Paths are copied out first, so the callback may write files.
+ * @return number of files visited, or -1 when the catalog is not ready
+ */
+int file_catalog_list(const char *prefix, fs_list_cb_t cb, void *ctx);
+
+/** Look up one file without touching flash. */
+bool file_catalog_stat(const char *path, file_catalog_entry_t *out);
+
+/**
+ * Compare the catalog against a fresh scan of the filesystem.
+ * @param repair  Rebuild the catalog when anything differs
+ */
+esp_err_t file_catalog_check(bool repair, file_catalog_check_t *out);
+
+int file_catalog_count(void);
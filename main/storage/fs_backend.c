@@ -0,0 +1,342 @@
+#include "storage/fs_backend.h"
+#include "storage/file_catalog.h"
+#include "storage/file_cache.h"
+#include "storage/fs_writer.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_spiffs.h"
+#if MIMI_FS_LITTLEFS
+#include "esp_littlefs.h"
+#endif
+
+static const char *TAG = "fs";
+
+#define FS_PART_LABEL       "spiffs"
+#define FS_MAX_FILES        10
+#define FS_PATH_MAX         128
+#define LIST_MAX_DEPTH      3
+
+static const char *const s_top_dirs[] = {
+    MIMI_SPIFFS_CONFIG_DIR, MIMI_SPIFFS_MEMORY_DIR, MIMI_SPIFFS_SESSION_DIR,
+    MIMI_SPIFFS_BASE "/skills", NULL,
+};
+
+/* LittleFS build left on SPIFFS because not every file could be migrated */
+static bool s_spiffs_kept = false;
+
+bool fs_has_dirs(void)
+{
+    return MIMI_FS_LITTLEFS && !s_spiffs_kept;
+}
+
+static esp_err_t mount_spiffs(bool format)
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = MIMI_SPIFFS_BASE,
+        .partition_label = NULL,
+        .max_files = FS_MAX_FILES,
+        .format_if_mount_failed = format,
+    };
+    return esp_vfs_spiffs_register(&conf);
+}
+
+/* ── Listing ────────────────────────────────────────────────── */
+
+static int list_flat(const char *prefix, fs_list_cb_t cb, void *ctx)
+{
+    DIR *dir = opendir(MIMI_SPIFFS_BASE);
+    if (!dir) return 0;
+
+    /* SPIFFS readdir returns names relative to the mount point, e.g. "memory/x.md" */
+    char path[FS_PATH_MAX];
+    size_t prefix_len = strlen(prefix);
+    int count = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        int n = snprintf(path, sizeof(path), "%s/%s", MIMI_SPIFFS_BASE, ent->d_name);
+        if (n < 0 || n >= (int)sizeof(path)) continue;
+        if (strncmp(path, prefix, prefix_len) != 0) continue;
+        count++;
+        if (!cb(path, ctx)) break;
+    }
+    closedir(dir);
+    return count;
+}
+
+/* Returns false once the callback asked to stop. */
+static bool list_tree(const char *dir, const char *prefix, int depth,
+                      fs_list_cb_t cb, void *ctx, int *count)
+{
+    DIR *d = opendir(dir);
+    if (!d) return true;
+
+    char path[FS_PATH_MAX];
+    size_t prefix_len = strlen(prefix);
+    bool more = true;
+    struct dirent *ent;
+    while (more && (ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        int n = snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        if (n < 0 || n >= (int)sizeof(path)) continue;
+
+        if (ent->d_type == DT_DIR) {
+            if (depth < LIST_MAX_DEPTH) more = list_tree(path, prefix, depth + 1, cb, ctx, count);
+            continue;
+        }
+        if (strncmp(path, prefix, prefix_len) != 0) continue;
+        (*count)++;
+        more = cb(path, ctx);
+    }
+    closedir(d);
+    return more;
+}
+
+int fs_scan(const char *prefix, fs_list_cb_t cb, void *ctx)
+{
+    if (!fs_has_dirs()) return list_flat(prefix, cb, ctx);
+
+    /* Start from the deepest directory the prefix names */
+    char dir[FS_PATH_MAX];
+    strncpy(dir, prefix, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    char *slash = strrchr(dir, '/');
+    if (slash && slash != dir) *slash = '\0';
+
+    int count = 0;
+    list_tree(dir, prefix, 0, cb, ctx, &count);
+    return count;
+}
+
+int fs_list(const char *prefix, fs_list_cb_t cb, void *ctx)
+{
+    int count = file_catalog_list(prefix, cb, ctx);
+    return count >= 0 ? count : fs_scan(prefix, cb, ctx);
+}
+
+esp_err_t fs_ensure_parent(const char *path)
+{
+    if (!fs_has_dirs()) return ESP_OK;
+
+    char dir[FS_PATH_MAX];
+    strncpy(dir, path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    for (char *p = dir + strlen(MIMI_SPIFFS_BASE) + 1; (p = strchr(p, '/')) != NULL; p++) {
+        *p = '\0';
+        if (mkdir(dir, 0775) != 0 && errno != EEXIST) {
+            ESP_LOGE(TAG, "mkdir %s failed (errno %d)", dir, errno);
+            return ESP_FAIL;
+        }
+        *p = '/';
+    }
+    return ESP_OK;
+}
+
+/* ── LittleFS and migration ─────────────────────────────────── */
+
+#if MIMI_FS_LITTLEFS
+
+#define MIGRATE_MAX_FILES   256
+
+typedef struct {
+    char path[FS_PATH_MAX];
+    char *data;
+    size_t len;
+} mig_file_t;
+
+typedef struct {
+    mig_file_t *files;
+    int count;
+    size_t bytes;
+    bool sessions;          /* Which pass: sessions are copied last */
+    int skipped;
+} mig_ctx_t;
+
+static esp_err_t mount_littlefs(bool format)
+{
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = MIMI_SPIFFS_BASE,
+        .partition_label = FS_PART_LABEL,
+        .format_if_mount_failed = format,
+        .dont_mount = false,
+    };
+    return esp_vfs_littlefs_register(&conf);
+}
+
+static bool on_migrate_file(const char *path, void *arg)
+{
+    mig_ctx_t *mc = arg;
+    bool is_session = strncmp(path, MIMI_SPIFFS_SESSION_DIR "/",
+                              strlen(MIMI_SPIFFS_SESSION_DIR "/")) == 0;
+    if (is_session != mc->sessions) return true;
+
+    struct stat st;
+    if (stat(path, &st) != 0) return true;
+    if (mc->count >= MIGRATE_MAX_FILES || mc->bytes + st.st_size > MIMI_FS_MIGRATE_MAX) {
+        mc->skipped++;
+        return true;
+    }
+
+    mig_file_t *mf = &mc->files[mc->count];
+    mf->data = heap_caps_malloc(st.st_size + 1, MALLOC_CAP_SPIRAM);
+    FILE *f = mf->data ? fopen(path, "r") : NULL;
+    if (!f) {
+        free(mf->data);
+        mc->skipped++;
+        return true;
+    }
+    mf->len = fread(mf->data, 1, st.st_size, f);
+    fclose(f);
+    strcpy(mf->path, path);
+    mc->bytes += mf->len;
+    mc->count++;
+    return true;
+}
+
+static void free_migrated(mig_ctx_t *mc)
+{
+    for (int i = 0; i < mc->count; i++) {
+        free(mc->files[i].data);
+    }
+    free(mc->files);
+}
+
+/*
+ * The partition holds SPIFFS (first LittleFS boot after an upgrade, or a
+ * SPIFFS image was flashed). Copy its files to PSRAM, reformat as LittleFS
+ * and write them back into real directories. Formatting would lose any
+ * file that did not fit in PSRAM or could not be read, so then the
+ * partition stays SPIFFS and is used as such until it is cleaned up.
+ */
+static esp_err_t migrate_from_spiffs(void)
+{
+    mig_ctx_t mc = {0};
+    mc.files = heap_caps_calloc(MIGRATE_MAX_FILES, sizeof(mig_file_t), MALLOC_CAP_SPIRAM);
+    if (!mc.files) {
+        ESP_LOGE(TAG, "No memory to migrate SPIFFS, staying on SPIFFS");
+        s_spiffs_kept = true;
+        return ESP_OK;
+    }
+
+    list_flat(MIMI_SPIFFS_BASE "/", on_migrate_file, &mc);
+    mc.sessions = true;
+    list_flat(MIMI_SPIFFS_BASE "/", on_migrate_file, &mc);
+    if (mc.skipped) {
+        ESP_LOGE(TAG, "%d SPIFFS files do not fit the migration (%d files, %u bytes read), "
+                 "staying on SPIFFS; free space to migrate on a later boot",
+                 mc.skipped, mc.count, (unsigned)mc.bytes);
+        free_migrated(&mc);
+        s_spiffs_kept = true;
+        return ESP_OK;
+    }
+    esp_vfs_spiffs_unregister(NULL);
+
+    ESP_LOGW(TAG, "Migrating %d files (%u bytes) from SPIFFS to LittleFS",
+             mc.count, (unsigned)mc.bytes);
+
+    esp_err_t err = esp_littlefs_format(FS_PART_LABEL);
+    if (err == ESP_OK) err = mount_littlefs(false);
+
+    int written = 0;
+    for (int i = 0; i < mc.count; i++) {
+        mig_file_t *mf = &mc.files[i];
+        if (err == ESP_OK && fs_ensure_parent(mf->path) == ESP_OK) {
+            FILE *f = fopen(mf->path, "w");
+            if (f) {
+                if (fwrite(mf->data, 1, mf->len, f) == mf->len) written++;
+                fclose(f);
+            }
+        }
+        free(mf->data);
+    }
+    free(mc.files);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LittleFS format/mount failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Migration done: %d/%d files written", written, mc.count);
+    return ESP_OK;
+}
+
+static esp_err_t mount_backend(void)
+{
+    if (mount_littlefs(false) == ESP_OK) return ESP_OK;
+
+    if (mount_spiffs(false) == ESP_OK) return migrate_from_spiffs();
+
+    ESP_LOGW(TAG, "No filesystem found, formatting LittleFS");
+    return mount_littlefs(true);
+}
+
+esp_err_t fs_info(size_t *total, size_t *used)
+{
+    if (s_spiffs_kept) return esp_spiffs_info(NULL, total, used);
+    return esp_littlefs_info(FS_PART_LABEL, total, used);
+}
+
+esp_err_t fs_gc(size_t free_bytes)
+{
+    if (s_spiffs_kept) return esp_spiffs_gc(NULL, free_bytes);
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#else /* SPIFFS */
+
+static esp_err_t mount_backend(void)
+{
+    return mount_spiffs(true);
+}
+
+esp_err_t fs_info(size_t *total, size_t *used)
+{
+    return esp_spiffs_info(NULL, total, used);
+}
+
+esp_err_t fs_gc(size_t free_bytes)
+{
+    return esp_spiffs_gc(NULL, free_bytes);
+}
+
+#endif
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t fs_mount(void)
+{
+    esp_err_t ret = mount_backend();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "%s mount failed: %s",
+                 fs_has_dirs() ? "LittleFS" : "SPIFFS", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (fs_has_dirs()) {
+        for (int i = 0; s_top_dirs[i]; i++) {
+            if (mkdir(s_top_dirs[i], 0775) != 0 && errno != EEXIST) {
+                ESP_LOGW(TAG, "mkdir %s failed (errno %d)", s_top_dirs[i], errno);
+            }
+        }
+    }
+
+    size_t total = 0, used = 0;
+    fs_info(&total, &used);
+    ESP_LOGI(TAG, "%s: total=%d, used=%d",
+             fs_has_dirs() ? "LittleFS" : "SPIFFS", (int)total, (int)used);
+
+    /* Without these, listing scans and reads go to flash */
+    file_catalog_build();
+    file_cache_init();
+
+    int leftovers = fs_writer_recover();
+    if (leftovers) ESP_LOGW(TAG, "Cleaned up %d file(s) left by interrupted writes", leftovers);
+    fs_writer_init();
+    return ESP_OK;
+}
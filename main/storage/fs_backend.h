@@ -0,0 +1,60 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Filesystem behind MIMI_SPIFFS_BASE.
+ *
+ * SPIFFS by default. With CONFIG_MIMI_FS_LITTLEFS the same partition is
+ * mounted as LittleFS at the same path, with real directories. All
+ * enumeration goes through fs_list() so callers work on either, and it is
+ * answered from the in-RAM file catalog (storage/file_catalog.h).
+ */
+
+/** Visitor for fs_list(); path is the full path. Return false to stop. */
+typedef bool (*fs_list_cb_t)(const char *path, void *ctx);
+
+/**
+ * Mount the partition at MIMI_SPIFFS_BASE and create the top-level
+ * directories. A LittleFS build that finds a SPIFFS partition copies its
+ * files over (config, memory and skills first, then sessions, up to
+ * MIMI_FS_MIGRATE_MAX bytes) before formatting it; if any file does not
+ * fit, it keeps the partition as SPIFFS instead. Builds the file catalog,
+ * allocates the file cache, repairs interrupted atomic writes and starts
+ * the coalescing writer (storage/fs_writer.h).
+ */
+esp_err_t fs_mount(void);
+
+/** true when directories are real (LittleFS), false on flat SPIFFS. */
+bool fs_has_dirs(void);
+
+esp_err_t fs_info(size_t *total, size_t *used);
+
+/**
+ * Reclaim deleted pages until at least free_bytes can be written without
+ * collecting garbage inline. SPIFFS only; LittleFS reclaims as it writes.
+ * @return ESP_ERR_NOT_SUPPORTED on LittleFS, ESP_ERR_NOT_FINISHED when the
+ *         partition cannot free that much
+ */
+esp_err_t fs_gc(size_t free_bytes);
+
+/**
+ * Create the missing parent directories of path (no-op on SPIFFS).
+ */
+esp_err_t fs_ensure_parent(const char *path);
+
+/**
+ * Visit the regular files whose full path starts with prefix, e.g.
+ * "/spiffs/skills/", in path order. Served from the file catalog; falls
+ * back to fs_scan() when the catalog is incomplete.
+ * @return number of files visited
+ */
+int fs_list(const char *prefix, fs_list_cb_t cb, void *ctx);
+
+/**
+ * fs_list() straight from flash. SPIFFS lists the whole partition and
+ * filters it; LittleFS walks only the directory the prefix names.
+ */
+int fs_scan(const char *prefix, fs_list_cb_t cb, void *ctx);
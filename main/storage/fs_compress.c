@@ -0,0 +1,262 @@
+#include "storage/fs_compress.h"
+#include "storage/storage_mgr.h"
+#include "storage/file_catalog.h"
+#include "storage/fs_writer.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "rom/miniz.h"
+
+static const char *TAG = "fs_z";
+
+#define Z_MAGIC        "MZ1"
+#define Z_HDR_LEN      12       /* magic[4] raw_len[4] crc32[4], little-endian */
+#define Z_PATH_MAX     96
+
+static atomic_uint s_packed = 0;
+static atomic_uint s_unpacked = 0;
+static atomic_size_t s_raw_bytes = 0;
+static atomic_size_t s_packed_bytes = 0;
+static atomic_uint s_deflate_ms = 0;
+static atomic_uint s_inflate_ms = 0;
+
+static void put_u32le(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t get_u32le(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ── Deflate / inflate ──────────────────────────────────────── */
+
+/* Returns header + deflate stream, or NULL if it would not be smaller. */
+static uint8_t *pack(const char *data, size_t len, size_t *out_len)
+{
+    int64_t start = esp_timer_get_time();
+
+    /* The compressor state is ~320 KB; it only ever lives in PSRAM */
+    tdefl_compressor *d = heap_caps_malloc(sizeof(tdefl_compressor), MALLOC_CAP_SPIRAM);
+    size_t cap = Z_HDR_LEN + len - len / 8;
+    uint8_t *out = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM);
+    if (!d || !out) {
+        free(d);
+        free(out);
+        return NULL;
+    }
+
+    tdefl_init(d, NULL, NULL, MIMI_FS_COMPRESS_PROBES & TDEFL_MAX_PROBES_MASK);
+    size_t in_size = len;
+    size_t z_size = cap - Z_HDR_LEN;
+    tdefl_status st = tdefl_compress(d, data, &in_size, out + Z_HDR_LEN, &z_size, TDEFL_FINISH);
+    free(d);
+
+    /* OKAY instead of DONE: the output did not fit, i.e. saved under 1/8 */
+    if (st != TDEFL_STATUS_DONE) {
+        free(out);
+        return NULL;
+    }
+
+    memcpy(out, Z_MAGIC, 4);
+    put_u32le(out + 4, (uint32_t)len);
+    put_u32le(out + 8, esp_rom_crc32_le(0, (const uint8_t *)data, len));
+    *out_len = Z_HDR_LEN + z_size;
+
+    atomic_fetch_add(&s_packed, 1);
+    atomic_fetch_add(&s_raw_bytes, len);
+    atomic_fetch_add(&s_packed_bytes, *out_len);
+    atomic_fetch_add(&s_deflate_ms, (uint32_t)((esp_timer_get_time() - start) / 1000));
+    return out;
+}
+
+static char *unpack(const uint8_t *in, size_t in_len, size_t max, size_t *len)
+{
+    int64_t start = esp_timer_get_time();
+    *len = get_u32le(in + 4);
+    if (*len > max) return NULL;
+
+    tinfl_decompressor *d = heap_caps_malloc(sizeof(tinfl_decompressor), MALLOC_CAP_SPIRAM);
+    char *out = heap_caps_malloc(*len + 1, MALLOC_CAP_SPIRAM);
+    if (!d || !out) {
+        free(d);
+        free(out);
+        return NULL;
+    }
+
+    tinfl_init(d);
+    size_t z_size = in_len - Z_HDR_LEN;
+    size_t out_size = *len;
+    tinfl_status st = tinfl_decompress(d, in + Z_HDR_LEN, &z_size, (mz_uint8 *)out,
+                                       (mz_uint8 *)out, &out_size,
+                                       TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    free(d);
+
+    if (st != TINFL_STATUS_DONE || out_size != *len ||
+        esp_rom_crc32_le(0, (const uint8_t *)out, out_size) != get_u32le(in + 8)) {
+        ESP_LOGE(TAG, "Corrupt packed data (status %d, %u of %u bytes)",
+                 (int)st, (unsigned)out_size, (unsigned)*len);
+        free(out);
+        return NULL;
+    }
+    out[*len] = '\0';
+
+    atomic_fetch_add(&s_unpacked, 1);
+    atomic_fetch_add(&s_inflate_ms, (uint32_t)((esp_timer_get_time() - start) / 1000));
+    return out;
+}
+
+/* ── Files ──────────────────────────────────────────────────── */
+
+/* Whole file as stored, NUL-terminated. */
+static uint8_t *read_raw(const char *path, size_t max, size_t *len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *len = size > 0 ? (size_t)size : 0;
+
+    uint8_t *data = *len <= max ? heap_caps_malloc(*len + 1, MALLOC_CAP_SPIRAM) : NULL;
+    if (data) {
+        *len = fread(data, 1, *len, f);
+        data[*len] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+static void archive_path(const char *path, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s" FS_COMPRESS_EXT, path);
+}
+
+static bool ends_with_ext(const char *path)
+{
+    size_t n = strlen(path);
+    size_t e = sizeof(FS_COMPRESS_EXT) - 1;
+    return n >= e && strcmp(path + n - e, FS_COMPRESS_EXT) == 0;
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+bool fs_compress_is_packed(const void *data, size_t len)
+{
+    return len >= Z_HDR_LEN && memcmp(data, Z_MAGIC, 4) == 0;
+}
+
+char *fs_compress_read_alloc(const char *path, size_t max, size_t *len)
+{
+    *len = 0;
+    size_t raw_len = 0;
+    /* A packed file is never larger than its contents */
+    uint8_t *raw = read_raw(path, max, &raw_len);
+    if (!raw && raw_len == 0 && !ends_with_ext(path)) {
+        /* Archived: the plain name reads the archive */
+        char zpath[Z_PATH_MAX];
+        archive_path(path, zpath, sizeof(zpath));
+        raw = read_raw(zpath, max, &raw_len);
+    }
+    if (!raw) {
+        *len = raw_len;
+        return NULL;
+    }
+    if (!fs_compress_is_packed(raw, raw_len)) {
+        *len = raw_len;
+        return (char *)raw;
+    }
+
+    char *text = unpack(raw, raw_len, max, len);
+    free(raw);
+    return text;
+}
+
+esp_err_t fs_compress_archive(const char *path)
+{
+    char zpath[Z_PATH_MAX];
+    archive_path(path, zpath, sizeof(zpath));
+
+    size_t len = 0;
+    char *data = (char *)read_raw(path, MIMI_FS_COMPRESS_MAX, &len);
+    if (!data) return len ? ESP_ERR_INVALID_SIZE : ESP_ERR_NOT_FOUND;
+
+    /* Append to an earlier archive of the same file */
+    size_t old_len = 0;
+    char *old = fs_compress_read_alloc(zpath, MIMI_FS_COMPRESS_MAX, &old_len);
+    if (old) {
+        char *merged = heap_caps_realloc(old, old_len + len + 1, MALLOC_CAP_SPIRAM);
+        if (!merged) {
+            free(old);
+            free(data);
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(merged + old_len, data, len + 1);
+        free(data);
+        data = merged;
+        len += old_len;
+    }
+
+    size_t packed_len = 0;
+    uint8_t *packed = pack(data, len, &packed_len);
+    free(data);
+    if (!packed) return ESP_ERR_INVALID_SIZE;
+
+    esp_err_t err = fs_write_atomic(zpath, packed, packed_len, FS_WRITER_ARCHIVE);
+    free(packed);
+    if (err != ESP_OK) return err;
+
+    remove(path);
+    storage_notify(STORAGE_EVT_REMOVED, path);
+    ESP_LOGI(TAG, "Archived %s: %u -> %u bytes", path, (unsigned)len, (unsigned)packed_len);
+    return ESP_OK;
+}
+
+esp_err_t fs_compress_restore(const char *path)
+{
+    char zpath[Z_PATH_MAX];
+    archive_path(path, zpath, sizeof(zpath));
+
+    /* Called on hot session paths: ask the catalog before flash */
+    struct stat st;
+    bool exists = file_catalog_ready() ? file_catalog_stat(zpath, NULL) : stat(zpath, &st) == 0;
+    if (!exists) return ESP_ERR_NOT_FOUND;
+
+    size_t len = 0;
+    char *data = fs_compress_read_alloc(zpath, MIMI_FS_COMPRESS_MAX, &len);
+    if (!data) {
+        ESP_LOGE(TAG, "Cannot restore %s", zpath);
+        return ESP_FAIL;
+    }
+    esp_err_t err = fs_write_atomic(path, data, len, FS_WRITER_ARCHIVE);
+    free(data);
+    if (err != ESP_OK) return err;
+
+    remove(zpath);
+    storage_notify(STORAGE_EVT_REMOVED, zpath);
+    ESP_LOGI(TAG, "Restored %s (%u bytes)", path, (unsigned)len);
+    return ESP_OK;
+}
+
+void fs_compress_get_stats(fs_compress_stats_t *out)
+{
+    out->packed = atomic_load(&s_packed);
+    out->unpacked = atomic_load(&s_unpacked);
+    out->raw_bytes = atomic_load(&s_raw_bytes);
+    out->packed_bytes = atomic_load(&s_packed_bytes);
+    out->deflate_ms = atomic_load(&s_deflate_ms);
+    out->inflate_ms = atomic_load(&s_inflate_ms);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Whole-file compression for cold data, using the deflate/inflate that
+ * ships in the ESP32-S3 ROM (miniz tdefl/tinfl).
+ *
+ * A packed file is a 12-byte header ("MZ1", raw length, CRC-32 of the raw
+ * bytes) followed by a raw deflate stream. Archives are named "<path>.z".
+ * file_cache_read() and friends inflate them transparently, so tools and
+ * the CLI can read an archived file like any other.
+ */
+
+#define FS_COMPRESS_EXT      ".z"
+
+typedef struct {
+    uint32_t packed;            /* Files compressed */
+    uint32_t unpacked;          /* Files inflated */
+    size_t raw_bytes;           /* Input to compression */
+    size_t packed_bytes;        /* Output of compression */
+    uint32_t deflate_ms;        /* Total time compressing */
+    uint32_t inflate_ms;        /* Total time inflating */
+} fs_compress_stats_t;
+
+/** true if data starts with the packed-file header. */
+bool fs_compress_is_packed(const void *data, size_t len);
+
+/**
+ * Read path into a new NUL-terminated PSRAM buffer the caller frees,
+ * inflating it if it is packed. When path is missing, path".z" is read.
+ * @param max  Refuse files whose (inflated) size exceeds this
+ * @param len  Out: (inflated) size, also set when it exceeds max
+ * @return NULL when missing, too large, corrupt or out of memory
+ */
+char *fs_compress_read_alloc(const char *path, size_t max, size_t *len);
+
+/**
+ * Compress path into path".z" and remove path. An existing archive is
+ * inflated and path is appended to it (text files only). Skipped with
+ * ESP_ERR_INVALID_SIZE when deflate saves less than an eighth.
+ */
+esp_err_t fs_compress_archive(const char *path);
+
+/**
+ * Inflate path".z" back to path and remove the archive.
+ * @return ESP_ERR_NOT_FOUND when there is no archive
+ */
+esp_err_t fs_compress_restore(const char *path);
+
+void fs_compress_get_stats(fs_compress_stats_t *out);
@@ -0,0 +1,484 @@
+#include "storage/fs_writer.h"
+#include "storage/fs_backend.h"
+#include "storage/storage_mgr.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const char *TAG = "fs_write";
+
+#define WRITE_PATH_MAX     96
+#define WRITE_EXT_LEN      4        /* "~new" / "~old" */
+#define RECOVER_MAX        8        /* Leftovers repaired per boot */
+
+typedef struct {
+    char path[WRITE_PATH_MAX];
+    char *data;                 /* Latest contents (PSRAM), NULL when free */
+    size_t len;
+    const char *flushing;       /* Buffer the flusher is writing, if any */
+    fs_writer_t who;
+    int64_t deadline_us;
+} pending_t;
+
+static const char *const s_names[FS_WRITER_COUNT] = {
+    "tools", "cron", "sessions", "archive", "index",
+};
+
+static pending_t s_pending[MIMI_FS_WRITE_SLOTS];
+static fs_writer_usage_t s_usage[FS_WRITER_COUNT];
+static SemaphoreHandle_t s_lock = NULL;         /* s_pending, s_usage */
+static SemaphoreHandle_t s_flush_lock = NULL;   /* One file write at a time (recursive) */
+static TaskHandle_t s_task = NULL;
+
+static void lock(void)
+{
+    if (s_lock) xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    if (s_lock) xSemaphoreGive(s_lock);
+}
+
+/* Listeners run inside a write and may write files themselves */
+static void flush_lock(void)
+{
+    if (s_flush_lock) xSemaphoreTakeRecursive(s_flush_lock, portMAX_DELAY);
+}
+
+static void flush_unlock(void)
+{
+    if (s_flush_lock) xSemaphoreGiveRecursive(s_flush_lock);
+}
+
+/* ── Write ──────────────────────────────────────────────────── */
+
+/* Move "<path>~new" over path and tell the listeners. */
+static esp_err_t swap_in(const char *path, int64_t start_us)
+{
+    char tmp[WRITE_PATH_MAX + WRITE_EXT_LEN];
+    char old[WRITE_PATH_MAX + WRITE_EXT_LEN];
+    snprintf(tmp, sizeof(tmp), "%s" FS_WRITE_TMP_EXT, path);
+    snprintf(old, sizeof(old), "%s" FS_WRITE_OLD_EXT, path);
+
+    /* LittleFS renames over a file atomically; SPIFFS needs it moved aside */
+    struct stat st;
+    bool aside = !fs_has_dirs() && stat(path, &st) == 0;
+    if (aside && rename(path, old) != 0) {
+        ESP_LOGE(TAG, "Cannot move %s aside", path);
+        remove(tmp);
+        return ESP_FAIL;
+    }
+    if (rename(tmp, path) != 0) {
+        ESP_LOGE(TAG, "Cannot rename %s", tmp);
+        if (aside) rename(old, path);
+        remove(tmp);
+        return ESP_FAIL;
+    }
+    if (aside) remove(old);
+
+    storage_note_write(path, start_us);
+    storage_notify(STORAGE_EVT_CHANGED, path);
+    return ESP_OK;
+}
+
+static FILE *open_tmp(const char *path)
+{
+    char tmp[WRITE_PATH_MAX + WRITE_EXT_LEN];
+    snprintf(tmp, sizeof(tmp), "%s" FS_WRITE_TMP_EXT, path);
+    fs_ensure_parent(path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) ESP_LOGE(TAG, "Cannot open %s", tmp);
+    return f;
+}
+
+static void drop_tmp(const char *path)
+{
+    char tmp[WRITE_PATH_MAX + WRITE_EXT_LEN];
+    snprintf(tmp, sizeof(tmp), "%s" FS_WRITE_TMP_EXT, path);
+    remove(tmp);
+}
+
+static esp_err_t write_swap(const char *path, const void *data, size_t len)
+{
+    int64_t start = esp_timer_get_time();
+    FILE *f = open_tmp(path);
+    if (!f) return ESP_FAIL;
+
+    size_t written = fwrite(data, 1, len, f);
+    if (fclose(f) != 0 || written != len) {
+        ESP_LOGE(TAG, "Short write to %s" FS_WRITE_TMP_EXT " (%u of %u bytes)", path,
+                 (unsigned)written, (unsigned)len);
+        drop_tmp(path);
+        return ESP_FAIL;
+    }
+    return swap_in(path, start);
+}
+
+/* Caller holds the flush lock. */
+static esp_err_t write_counted(const char *path, const void *data, size_t len, fs_writer_t who)
+{
+    esp_err_t err = write_swap(path, data, len);
+    lock();
+    if (err == ESP_OK) {
+        s_usage[who].flushes++;
+        s_usage[who].bytes += len;
+    } else {
+        s_usage[who].failures++;
+    }
+    unlock();
+    return err;
+}
+
+/* ── Pending writes ─────────────────────────────────────────── */
+
+/* Caller holds s_lock. */
+static pending_t *pending_find(const char *path)
+{
+    for (int i = 0; i < MIMI_FS_WRITE_SLOTS; i++) {
+        if (s_pending[i].data && strcmp(s_pending[i].path, path) == 0) return &s_pending[i];
+    }
+    return NULL;
+}
+
+/* Caller holds s_lock. The flusher frees the buffer it is writing. */
+static void pending_set(pending_t *p, char *data)
+{
+    if (p->data && p->data != p->flushing) free(p->data);
+    p->data = data;
+    if (!data) p->path[0] = '\0';
+}
+
+/* Write slot i if it holds path (any path when NULL) and is due by due_us. */
+static void flush_slot(int i, const char *path, int64_t due_us)
+{
+    pending_t *p = &s_pending[i];
+    flush_lock();
+    lock();
+    if (!p->data || (path && strcmp(p->path, path) != 0) || p->deadline_us > due_us) {
+        unlock();
+        flush_unlock();
+        return;
+    }
+    char target[WRITE_PATH_MAX];
+    strcpy(target, p->path);
+    char *data = p->data;
+    size_t len = p->len;
+    fs_writer_t who = p->who;
+    p->flushing = data;
+    unlock();
+
+    write_counted(target, data, len, who);
+
+    /* A newer version that arrived meanwhile stays pending */
+    lock();
+    if (p->data == data) p->data = NULL;
+    if (!p->data) p->path[0] = '\0';
+    p->flushing = NULL;
+    unlock();
+    free(data);
+    flush_unlock();
+}
+
+static void writer_task(void *arg)
+{
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < MIMI_FS_WRITE_SLOTS; i++) {
+            flush_slot(i, NULL, now);
+        }
+
+        /* Sleep until the next deadline, or until a new file is queued */
+        int64_t next = INT64_MAX;
+        lock();
+        for (int i = 0; i < MIMI_FS_WRITE_SLOTS; i++) {
+            if (s_pending[i].data && s_pending[i].deadline_us < next) next = s_pending[i].deadline_us;
+        }
+        unlock();
+
+        TickType_t wait = portMAX_DELAY;
+        if (next != INT64_MAX) {
+            int64_t ms = (next - esp_timer_get_time()) / 1000;
+            wait = ms > 0 ? pdMS_TO_TICKS(ms) + 1 : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/* ── Recovery ───────────────────────────────────────────────── */
+
+typedef struct {
+    char paths[RECOVER_MAX][WRITE_PATH_MAX + WRITE_EXT_LEN];
+    int count;
+} leftovers_t;
+
+static bool ends_with(const char *s, const char *ext)
+{
+    size_t n = strlen(s);
+    return n > WRITE_EXT_LEN && strcmp(s + n - WRITE_EXT_LEN, ext) == 0;
+}
+
+static bool on_leftover(const char *path, void *arg)
+{
+    leftovers_t *lo = arg;
+    if (!fs_writer_is_temp(path)) return true;
+    if (strlen(path) >= sizeof(lo->paths[0])) return true;
+    strcpy(lo->paths[lo->count++], path);
+    return lo->count < RECOVER_MAX;
+}
+
+static bool exists(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static void drop(const char *path)
+{
+    if (remove(path) == 0) storage_notify(STORAGE_EVT_REMOVED, path);
+}
+
+static bool move(const char *from, const char *to)
+{
+    if (rename(from, to) != 0) return false;
+    storage_notify(STORAGE_EVT_REMOVED, from);
+    storage_notify(STORAGE_EVT_CHANGED, to);
+    return true;
+}
+
+/*
+ * A swap writes X~new, closes it, moves X to X~old, renames X~new to X and
+ * removes X~old. So X~new is complete exactly when X~old exists; without
+ * X~old it is an unfinished write and the old state (X or nothing) stands.
+ */
+static void recover_one(const char *path)
+{
+    char target[WRITE_PATH_MAX + WRITE_EXT_LEN];
+    char sibling[WRITE_PATH_MAX + 2 * WRITE_EXT_LEN];
+    size_t n = strlen(path) - WRITE_EXT_LEN;
+    memcpy(target, path, n);
+    target[n] = '\0';
+
+    if (!exists(path)) return;      /* Already handled with its sibling */
+    if (exists(target)) {
+        drop(path);
+        ESP_LOGW(TAG, "Dropped leftover %s", path);
+        return;
+    }
+
+    if (ends_with(path, FS_WRITE_TMP_EXT)) {
+        snprintf(sibling, sizeof(sibling), "%s" FS_WRITE_OLD_EXT, target);
+        if (exists(sibling) && move(path, target)) {
+            drop(sibling);
+            ESP_LOGW(TAG, "Finished interrupted write of %s", target);
+        } else {
+            drop(path);
+            ESP_LOGW(TAG, "Discarded unfinished write of %s", target);
+        }
+    } else {
+        snprintf(sibling, sizeof(sibling), "%s" FS_WRITE_TMP_EXT, target);
+        if (exists(sibling)) return;    /* The ~new rule decides */
+        if (move(path, target)) ESP_LOGW(TAG, "Restored %s", target);
+    }
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+bool fs_writer_is_temp(const char *path)
+{
+    return ends_with(path, FS_WRITE_TMP_EXT) || ends_with(path, FS_WRITE_OLD_EXT);
+}
+
+int fs_writer_recover(void)
+{
+    leftovers_t *lo = heap_caps_calloc(1, sizeof(*lo), MALLOC_CAP_SPIRAM);
+    if (!lo) return 0;
+
+    /* Collect first: repairs rename files under the listing */
+    fs_list(MIMI_SPIFFS_BASE "/", on_leftover, lo);
+    for (int i = 0; i < lo->count; i++) {
+        recover_one(lo->paths[i]);
+    }
+    int count = lo->count;
+    free(lo);
+    return count;
+}
+
+esp_err_t fs_writer_init(void)
+{
+    if (s_task) return ESP_OK;
+
+    s_lock = xSemaphoreCreateMutex();
+    s_flush_lock = xSemaphoreCreateRecursiveMutex();
+    if (!s_lock || !s_flush_lock) return ESP_ERR_NO_MEM;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(writer_task, "fs_writer",
+                                            MIMI_FS_WRITER_STACK, NULL,
+                                            MIMI_FS_WRITER_PRIO, &s_task, MIMI_FS_WRITER_CORE);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create writer task; writes go straight to flash");
+        s_task = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t fs_write_atomic(const char *path, const void *data, size_t len, fs_writer_t who)
+{
+    /* The temp names would be cut short and could collide with another file's */
+    if (strlen(path) >= WRITE_PATH_MAX) return ESP_ERR_INVALID_ARG;
+
+    flush_lock();
+    lock();
+    s_usage[who].requests++;
+    pending_t *p = pending_find(path);
+    if (p) {
+        s_usage[p->who].coalesced++;
+        pending_set(p, NULL);
+    }
+    unlock();
+
+    esp_err_t err = write_counted(path, data, len, who);
+    flush_unlock();
+    return err;
+}
+
+esp_err_t fs_write_coalesced(const char *path, const void *data, size_t len, fs_writer_t who)
+{
+    if (!s_task || len > MIMI_FS_WRITE_COALESCE_MAX || strlen(path) >= WRITE_PATH_MAX) {
+        return fs_write_atomic(path, data, len, who);
+    }
+    char *copy = heap_caps_malloc(len + 1, MALLOC_CAP_SPIRAM);
+    if (!copy) return fs_write_atomic(path, data, len, who);
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+
+    lock();
+    pending_t *p = pending_find(path);
+    if (p) {
+        s_usage[p->who].coalesced++;
+    } else {
+        for (int i = 0; i < MIMI_FS_WRITE_SLOTS && !p; i++) {
+            if (!s_pending[i].data && !s_pending[i].flushing) p = &s_pending[i];
+        }
+        if (p) {
+            strcpy(p->path, path);
+            p->deadline_us = esp_timer_get_time() + (int64_t)MIMI_FS_WRITE_COALESCE_MS * 1000;
+        }
+    }
+    if (p) {
+        s_usage[who].requests++;
+        pending_set(p, copy);
+        p->len = len;
+        p->who = who;
+    }
+    unlock();
+
+    if (!p) {
+        /* Every slot holds another file */
+        free(copy);
+        return fs_write_atomic(path, data, len, who);
+    }
+    xTaskNotifyGive(s_task);
+    return ESP_OK;
+}
+
+esp_err_t fs_write_stream_begin(fs_write_stream_t *ws, const char *path, fs_writer_t who)
+{
+    memset(ws, 0, sizeof(*ws));
+    if (strlen(path) >= WRITE_PATH_MAX) return ESP_ERR_INVALID_ARG;
+
+    /* Held until fs_write_stream_end(), so no flush interleaves */
+    flush_lock();
+    fs_writer_flush(path);
+    lock();
+    s_usage[who].requests++;
+    unlock();
+
+    ws->start_us = esp_timer_get_time();
+    ws->f = open_tmp(path);
+    if (!ws->f) {
+        lock();
+        s_usage[who].failures++;
+        unlock();
+        flush_unlock();
+        return ESP_FAIL;
+    }
+    ws->path = path;
+    ws->who = who;
+    return ESP_OK;
+}
+
+esp_err_t fs_write_stream_end(fs_write_stream_t *ws, bool commit)
+{
+    if (!ws->f) return ESP_ERR_INVALID_STATE;
+
+    long len = ftell(ws->f);
+    bool closed = fclose(ws->f) == 0;
+    ws->f = NULL;
+
+    esp_err_t err = ESP_OK;
+    if (!commit) {
+        drop_tmp(ws->path);
+    } else if (!closed || len < 0) {
+        ESP_LOGE(TAG, "Short write to %s" FS_WRITE_TMP_EXT, ws->path);
+        drop_tmp(ws->path);
+        err = ESP_FAIL;
+    } else {
+        err = swap_in(ws->path, ws->start_us);
+    }
+
+    lock();
+    if (err != ESP_OK) {
+        s_usage[ws->who].failures++;
+    } else if (commit) {
+        s_usage[ws->who].flushes++;
+        s_usage[ws->who].bytes += (size_t)len;
+    }
+    unlock();
+    flush_unlock();
+    return err;
+}
+
+void fs_writer_flush(const char *path)
+{
+    for (int i = 0; i < MIMI_FS_WRITE_SLOTS; i++) {
+        flush_slot(i, path, INT64_MAX);
+    }
+}
+
+bool fs_writer_peek(const char *path, fs_writer_copy_cb_t copy, void *arg)
+{
+    if (!s_lock) return false;
+
+    lock();
+    pending_t *p = pending_find(path);
+    if (p) copy(p->data, p->len, arg);
+    unlock();
+    return p != NULL;
+}
+
+const char *fs_writer_name(fs_writer_t who)
+{
+    return who < FS_WRITER_COUNT ? s_names[who] : "?";
+}
+
+void fs_writer_get_stats(fs_writer_stats_t *out)
+{
+    lock();
+    memcpy(out->who, s_usage, sizeof(s_usage));
+    out->pending = 0;
+    for (int i = 0; i < MIMI_FS_WRITE_SLOTS; i++) {
+        if (s_pending[i].data) out->pending++;
+    }
+    unlock();
+}
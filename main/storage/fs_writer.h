@@ -0,0 +1,118 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Crash-safe whole-file writes.
+ *
+ * fs_write_atomic() writes "<path>~new" and renames it into place, so a
+ * reset leaves either the old or the new contents. SPIFFS cannot rename
+ * over a file, so there the old one is first renamed to "<path>~old";
+ * fs_writer_recover() finishes or rolls back an interrupted swap at mount.
+ * Both suffixes are reserved: the file tools refuse paths that end in them,
+ * so recovery never mistakes a user's file for a leftover.
+ *
+ * fs_write_coalesced() holds the contents in PSRAM for
+ * MIMI_FS_WRITE_COALESCE_MS and writes only the last version, for files
+ * rewritten several times in a row (cron.json, a note the agent edits
+ * repeatedly in one turn). file_cache reads see the pending contents.
+ *
+ * fs_write_stream_begin() / fs_write_stream_end() are fs_write_atomic()
+ * for contents produced piece by piece, too large to hold in memory.
+ */
+
+#define FS_WRITE_TMP_EXT     "~new"
+#define FS_WRITE_OLD_EXT     "~old"
+
+typedef enum {
+    FS_WRITER_TOOLS = 0,        /* write_file, edit_file */
+    FS_WRITER_CRON,             /* cron.json */
+    FS_WRITER_SESSIONS,         /* Session compaction and migration */
+    FS_WRITER_ARCHIVE,          /* fs_compress archives and restores */
+    FS_WRITER_INDEX,            /* search.idx */
+    FS_WRITER_COUNT,
+} fs_writer_t;
+
+typedef struct {
+    uint32_t requests;          /* Writes asked for */
+    uint32_t flushes;           /* Files actually written */
+    uint32_t coalesced;         /* Pending versions replaced before a flush */
+    uint32_t failures;
+    size_t bytes;               /* Bytes written to flash */
+} fs_writer_usage_t;
+
+typedef struct {
+    fs_writer_usage_t who[FS_WRITER_COUNT];
+    int pending;                /* Files waiting for a coalesced flush */
+} fs_writer_stats_t;
+
+/** An open streamed write, see fs_write_stream_begin(). */
+typedef struct {
+    FILE *f;                    /* Write the new contents here */
+    const char *path;
+    fs_writer_t who;
+    int64_t start_us;
+} fs_write_stream_t;
+
+/** Copy callback for fs_writer_peek(), e.g. file_cache's copy helpers. */
+typedef void (*fs_writer_copy_cb_t)(const char *data, size_t len, void *arg);
+
+/**
+ * Start the flush task. Called by fs_mount() after fs_writer_recover().
+ */
+esp_err_t fs_writer_init(void);
+
+/**
+ * Finish or roll back writes a reset interrupted, from the "~new" and
+ * "~old" files they left behind. Called by fs_mount().
+ * @return number of leftover files handled
+ */
+int fs_writer_recover(void);
+
+/** true if path ends in a suffix reserved for fs_writer's temporary files. */
+bool fs_writer_is_temp(const char *path);
+
+/**
+ * Replace path with data now, then storage_notify() it. A pending
+ * coalesced write to path is dropped.
+ * @return ESP_ERR_INVALID_ARG if path is too long for the temp names
+ */
+esp_err_t fs_write_atomic(const char *path, const void *data, size_t len, fs_writer_t who);
+
+/**
+ * Replace path with data within MIMI_FS_WRITE_COALESCE_MS. Later writes
+ * to the same path before then replace this one. Errors at flush time
+ * are logged and counted. Contents over MIMI_FS_WRITE_COALESCE_MAX, or
+ * with no free slot to hold them, are written before returning.
+ */
+esp_err_t fs_write_coalesced(const char *path, const void *data, size_t len, fs_writer_t who);
+
+/**
+ * Flush any pending write to path and open "<path>~new" as ws->f. Other
+ * writes wait until fs_write_stream_end(), which must always be called
+ * on success. path must stay valid until then.
+ */
+esp_err_t fs_write_stream_begin(fs_write_stream_t *ws, const char *path, fs_writer_t who);
+
+/**
+ * Close ws->f. With commit, swap it into place like fs_write_atomic();
+ * otherwise discard it and leave path untouched.
+ */
+esp_err_t fs_write_stream_end(fs_write_stream_t *ws, bool commit);
+
+/** Write out the pending contents of path now (NULL: every file). */
+void fs_writer_flush(const char *path);
+
+/**
+ * If path has a pending write, call copy with its contents (under the
+ * writer lock) and return true.
+ */
+bool fs_writer_peek(const char *path, fs_writer_copy_cb_t copy, void *arg);
+
+const char *fs_writer_name(fs_writer_t who);
+
+void fs_writer_get_stats(fs_writer_stats_t *out);
@@ -0,0 +1,410 @@
+#include "storage/storage_mgr.h"
+#include "storage/fs_backend.h"
+#include "storage/file_catalog.h"
+#include "storage/file_cache.h"
+#include "mimi_config.h"
+#include "memory/session_mgr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const char *TAG = "storage";
+
+#define STORAGE_PATH_MAX  96
+
+static const char *const s_ns_names[STORAGE_NS_COUNT] = {
+    "sessions", "memory", "skills", "other",
+};
+
+static const size_t s_quotas[STORAGE_NS_COUNT] = {
+    MIMI_STORAGE_QUOTA_SESSIONS,
+    MIMI_STORAGE_QUOTA_MEMORY,
+    MIMI_STORAGE_QUOTA_SKILLS,
+    MIMI_STORAGE_QUOTA_OTHER,
+};
+
+static storage_stats_t s_stats = {0};
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_task = NULL;
+static storage_listener_t s_listeners[MIMI_STORAGE_MAX_LISTENERS];
+static int s_listener_count = 0;
+static volatile bool s_busy = false;
+static volatile int64_t s_idle_since_us = 0;
+
+const char *storage_ns_name(storage_ns_t ns)
+{
+    return ns < STORAGE_NS_COUNT ? s_ns_names[ns] : "?";
+}
+
+storage_ns_t storage_ns_of(const char *path)
+{
+    size_t base_len = strlen(MIMI_SPIFFS_BASE);
+    if (strncmp(path, MIMI_SPIFFS_BASE "/", base_len + 1) == 0) {
+        path += base_len + 1;
+    }
+    if (strncmp(path, "sessions/", 9) == 0) return STORAGE_NS_SESSIONS;
+    if (strncmp(path, "memory/", 7) == 0) return STORAGE_NS_MEMORY;
+    if (strncmp(path, "skills/", 7) == 0) return STORAGE_NS_SKILLS;
+    return STORAGE_NS_OTHER;
+}
+
+/* ── Scan ───────────────────────────────────────────────────── */
+
+typedef struct {
+    char path[STORAGE_PATH_MAX];
+    time_t mtime;
+    size_t size;
+    uint8_t ns;
+} evict_cand_t;
+
+typedef struct {
+    evict_cand_t *items;
+    int count;
+    int cap;
+} cand_list_t;
+
+/* Daily notes are memory/YYYY-MM-DD.md; MEMORY.md is never evicted. */
+static bool is_daily_note(const char *name)
+{
+    if (strlen(name) != 13 || strcmp(name + 10, ".md") != 0) return false;
+    for (int i = 0; i < 10; i++) {
+        bool dash = (i == 4 || i == 7);
+        if (dash ? name[i] != '-' : !isdigit((unsigned char)name[i])) return false;
+    }
+    return true;
+}
+
+static bool is_session_file(const char *name)
+{
+    return strncmp(name, "tg_", 3) == 0 &&
+           (strstr(name, ".jsonl") || strstr(name, ".bin"));
+}
+
+static bool is_evictable(const char *path, storage_ns_t ns)
+{
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    if (ns == STORAGE_NS_SESSIONS) return is_session_file(name);
+    if (ns == STORAGE_NS_MEMORY) return is_daily_note(name);
+    return false;
+}
+
+static void cand_push(cand_list_t *list, const char *path, const struct stat *st, storage_ns_t ns)
+{
+    if (list->count == list->cap) {
+        int new_cap = list->cap ? list->cap * 2 : 32;
+        evict_cand_t *tmp = heap_caps_realloc(list->items, new_cap * sizeof(evict_cand_t),
+                                              MALLOC_CAP_SPIRAM);
+        if (!tmp) return;
+        list->items = tmp;
+        list->cap = new_cap;
+    }
+    evict_cand_t *c = &list->items[list->count++];
+    strncpy(c->path, path, sizeof(c->path) - 1);
+    c->path[sizeof(c->path) - 1] = '\0';
+    c->mtime = st->st_mtime;
+    c->size = st->st_size;
+    c->ns = ns;
+}
+
+typedef struct {
+    storage_ns_usage_t *usage;
+    cand_list_t *cands;
+} scan_ctx_t;
+
+/* Sizes come from stat() rather than the catalog: this pass is the
+ * authoritative one, and it is not on a hot path. */
+static bool on_scan_file(const char *path, void *arg)
+{
+    scan_ctx_t *sc = arg;
+    struct stat st;
+    if (stat(path, &st) != 0) return true;
+    storage_ns_t ns = storage_ns_of(path);
+    sc->usage[ns].bytes += st.st_size;
+    sc->usage[ns].files++;
+    if (is_evictable(path, ns)) {
+        cand_push(sc->cands, path, &st, ns);
+    }
+    return true;
+}
+
+/* ── Eviction ───────────────────────────────────────────────── */
+
+static int cmp_oldest_first(const void *a, const void *b)
+{
+    const evict_cand_t *ca = a, *cb = b;
+    if (ca->mtime != cb->mtime) return ca->mtime < cb->mtime ? -1 : 1;
+    return strcmp(ca->path, cb->path);
+}
+
+static bool evict(const evict_cand_t *c)
+{
+    if (c->ns == STORAGE_NS_SESSIONS) {
+        /* Go through the session manager so its cache and queue stay coherent */
+        const char *name = strrchr(c->path, '/');
+        name = name ? name + 4 : c->path + 3;     /* skip "/tg_" */
+        char chat_id[32];
+        size_t len = strcspn(name, ".");
+        if (len == 0 || len >= sizeof(chat_id)) return false;
+        memcpy(chat_id, name, len);
+        chat_id[len] = '\0';
+        return session_clear(chat_id) == ESP_OK;
+    }
+    if (remove(c->path) != 0) return false;
+    storage_notify(STORAGE_EVT_REMOVED, c->path);
+    return true;
+}
+
+static void enforce(storage_stats_t *st, cand_list_t *cands)
+{
+    static const int keep[STORAGE_NS_COUNT] = {
+        MIMI_STORAGE_KEEP_SESSIONS, MIMI_STORAGE_KEEP_NOTES, 0, 0,
+    };
+    int total[STORAGE_NS_COUNT] = {0};
+    int seen[STORAGE_NS_COUNT] = {0};
+    for (int i = 0; i < cands->count; i++) {
+        total[cands->items[i].ns]++;
+    }
+
+    qsort(cands->items, cands->count, sizeof(evict_cand_t), cmp_oldest_first);
+
+    size_t high_water = st->part_total / 100 * MIMI_STORAGE_HIGH_WATER_PCT;
+    for (int i = 0; i < cands->count; i++) {
+        const evict_cand_t *c = &cands->items[i];
+        storage_ns_usage_t *u = &st->ns[c->ns];
+
+        /* The newest few per namespace are always kept */
+        if (seen[c->ns]++ >= total[c->ns] - keep[c->ns]) continue;
+
+        bool over_quota = u->quota && u->bytes > u->quota;
+        bool over_part = st->part_total && st->part_used > high_water;
+        if (!over_quota && !over_part) continue;
+
+        if (!evict(c)) {
+            ESP_LOGW(TAG, "Could not evict %s", c->path);
+            continue;
+        }
+        ESP_LOGI(TAG, "Evicted %s (%u bytes, %s%s)", c->path, (unsigned)c->size,
+                 over_quota ? "over quota" : "", over_part && !over_quota ? "partition full" : "");
+        u->bytes -= c->size;
+        u->files--;
+        u->evictions++;
+        u->evicted_bytes += c->size;
+        st->part_used = st->part_used > c->size ? st->part_used - c->size : 0;
+    }
+
+    for (int ns = 0; ns < STORAGE_NS_COUNT; ns++) {
+        const storage_ns_usage_t *u = &st->ns[ns];
+        if (u->quota && u->bytes > u->quota) {
+            ESP_LOGW(TAG, "%s over quota: %u / %u bytes", s_ns_names[ns],
+                     (unsigned)u->bytes, (unsigned)u->quota);
+        }
+    }
+}
+
+static void storage_check(void)
+{
+    int64_t start = esp_timer_get_time();
+
+    storage_stats_t st;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    st = s_stats;
+    xSemaphoreGive(s_lock);
+
+    for (int ns = 0; ns < STORAGE_NS_COUNT; ns++) {
+        st.ns[ns].bytes = 0;
+        st.ns[ns].files = 0;
+        st.ns[ns].quota = s_quotas[ns];
+    }
+    fs_info(&st.part_total, &st.part_used);
+
+    cand_list_t cands = {0};
+    scan_ctx_t sc = { .usage = st.ns, .cands = &cands };
+    fs_list(MIMI_SPIFFS_BASE "/", on_scan_file, &sc);
+    enforce(&st, &cands);
+    free(cands.items);
+
+    st.scans++;
+    st.last_scan_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    st.io = s_stats.io;     /* Updated by writers while the scan ran */
+    s_stats = st;
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGD(TAG, "Scan done in %u ms (%u / %u bytes used)",
+             (unsigned)st.last_scan_ms, (unsigned)st.part_used, (unsigned)st.part_total);
+}
+
+/* ── Idle GC ────────────────────────────────────────────────── */
+
+static bool gc_allowed(void)
+{
+    return !s_busy &&
+           esp_timer_get_time() - s_idle_since_us >= (int64_t)MIMI_STORAGE_GC_IDLE_MS * 1000;
+}
+
+/*
+ * Erase blocks of deleted pages ahead of time. Otherwise SPIFFS does it
+ * inside whichever write runs out of free pages, often mid-turn. Works
+ * toward the target in steps, so a turn that starts meanwhile waits for
+ * one step at most.
+ */
+static void storage_gc(void)
+{
+    if (fs_has_dirs()) return;
+    if (!gc_allowed()) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_stats.io.gc_skipped++;
+        xSemaphoreGive(s_lock);
+        return;
+    }
+
+    size_t total = 0, used = 0;
+    if (fs_info(&total, &used) != ESP_OK || used >= total) return;
+    /* GC needs free pages of its own to move live data into */
+    size_t target = MIMI_STORAGE_GC_FREE_TARGET;
+    if (target > (total - used) / 2) target = (total - used) / 2;
+
+    uint32_t total_ms = 0, max_ms = 0;
+    esp_err_t err = ESP_OK;
+    for (size_t goal = MIMI_STORAGE_GC_STEP; goal <= target && gc_allowed(); goal += MIMI_STORAGE_GC_STEP) {
+        int64_t start = esp_timer_get_time();
+        err = fs_gc(goal);
+        uint32_t ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+        total_ms += ms;
+        if (ms > max_ms) max_ms = ms;
+        if (err != ESP_OK) break;
+    }
+    if (err != ESP_OK && err != ESP_ERR_NOT_FINISHED) {
+        ESP_LOGW(TAG, "GC failed: %s", esp_err_to_name(err));
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.io.gc_runs++;
+    s_stats.io.gc_ms += total_ms;
+    if (max_ms > s_stats.io.gc_max_ms) s_stats.io.gc_max_ms = max_ms;
+    xSemaphoreGive(s_lock);
+    ESP_LOGD(TAG, "Idle GC took %u ms (target %u KB writable)",
+             (unsigned)total_ms, (unsigned)(target / 1024));
+}
+
+static void storage_task(void *arg)
+{
+    while (1) {
+        storage_check();
+        storage_gc();
+        storage_notify(STORAGE_EVT_MAINTENANCE, NULL);
+        /* Summaries and rollups: slow, so only between turns */
+        bool idle = gc_allowed();
+        if (idle) storage_notify(STORAGE_EVT_IDLE, NULL);
+        /* Rate-limit requested scans, then wait for a request or the interval.
+           A pass right after a turn comes back once the quiet time is over. */
+        vTaskDelay(pdMS_TO_TICKS(MIMI_STORAGE_MIN_GAP_MS));
+        bool deferred = !idle && !s_busy;
+        ulTaskNotifyTake(pdTRUE, deferred ? 0 : pdMS_TO_TICKS(MIMI_STORAGE_CHECK_INTERVAL_MS));
+    }
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+esp_err_t storage_mgr_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    for (int ns = 0; ns < STORAGE_NS_COUNT; ns++) {
+        s_stats.ns[ns].quota = s_quotas[ns];
+    }
+    ESP_LOGI(TAG, "Storage manager initialized (high water %d%%)", MIMI_STORAGE_HIGH_WATER_PCT);
+    return ESP_OK;
+}
+
+esp_err_t storage_mgr_start(void)
+{
+    if (s_task) return ESP_OK;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(storage_task, "storage",
+                                            MIMI_STORAGE_STACK, NULL,
+                                            MIMI_STORAGE_PRIO, &s_task, MIMI_STORAGE_CORE);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create storage task");
+        s_task = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t storage_add_listener(storage_listener_t fn)
+{
+    if (s_listener_count >= MIMI_STORAGE_MAX_LISTENERS) {
+        ESP_LOGE(TAG, "Too many storage listeners");
+        return ESP_ERR_NO_MEM;
+    }
+    s_listeners[s_listener_count++] = fn;
+    return ESP_OK;
+}
+
+void storage_notify(storage_evt_t evt, const char *path)
+{
+    /* Catalog and cache first, so listeners that list or read files see the change */
+    if (evt == STORAGE_EVT_CHANGED) {
+        file_catalog_changed(path);
+        file_cache_invalidate(path);
+    } else if (evt == STORAGE_EVT_REMOVED) {
+        file_catalog_removed(path);
+        file_cache_invalidate(path);
+    }
+    for (int i = 0; i < s_listener_count; i++) {
+        s_listeners[i](evt, path);
+    }
+}
+
+void storage_mgr_set_busy(bool busy)
+{
+    if (!busy) s_idle_since_us = esp_timer_get_time();
+    s_busy = busy;
+}
+
+void storage_note_write(const char *path, int64_t start_us)
+{
+    if (!s_lock) return;
+
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (ms >= MIMI_STORAGE_SLOW_WRITE_MS) {
+        ESP_LOGW(TAG, "Write to %s stalled for %u ms", path, (unsigned)ms);
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    storage_io_stats_t *io = &s_stats.io;
+    io->writes++;
+    if (ms >= MIMI_STORAGE_SLOW_WRITE_MS) io->slow_writes++;
+    if (ms > io->write_max_ms) {
+        io->write_max_ms = ms;
+        strncpy(io->write_max_path, path, sizeof(io->write_max_path) - 1);
+        io->write_max_path[sizeof(io->write_max_path) - 1] = '\0';
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void storage_mgr_request_check(void)
+{
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+void storage_get_stats(storage_stats_t *out)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_lock);
+}
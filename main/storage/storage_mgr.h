@@ -0,0 +1,111 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    STORAGE_NS_SESSIONS = 0,    /* /spiffs/sessions/ */
+    STORAGE_NS_MEMORY,          /* /spiffs/memory/ */
+    STORAGE_NS_SKILLS,          /* /spiffs/skills/ */
+    STORAGE_NS_OTHER,           /* everything else (config, cron, heartbeat) */
+    STORAGE_NS_COUNT,
+} storage_ns_t;
+
+typedef struct {
+    size_t bytes;
+    size_t quota;               /* 0 = unlimited */
+    int files;
+    uint32_t evictions;
+    size_t evicted_bytes;
+} storage_ns_usage_t;
+
+typedef struct {
+    uint32_t gc_runs;           /* Idle passes that ran garbage collection */
+    uint32_t gc_skipped;        /* Passes that found a turn running */
+    uint32_t gc_ms;             /* Total time spent in idle GC */
+    uint32_t gc_max_ms;         /* Longest single GC step */
+    uint32_t writes;            /* Timed writes: sessions, write/edit_file, cron */
+    uint32_t slow_writes;       /* Over MIMI_STORAGE_SLOW_WRITE_MS */
+    uint32_t write_max_ms;      /* Worst write stall seen */
+    char write_max_path[48];
+} storage_io_stats_t;
+
+typedef struct {
+    storage_ns_usage_t ns[STORAGE_NS_COUNT];
+    size_t part_total;
+    size_t part_used;
+    uint32_t scans;
+    uint32_t last_scan_ms;      /* Duration of the last scan */
+    storage_io_stats_t io;
+} storage_stats_t;
+
+typedef enum {
+    STORAGE_EVT_CHANGED = 0,    /* File created or rewritten */
+    STORAGE_EVT_REMOVED,        /* File deleted */
+    STORAGE_EVT_MAINTENANCE,    /* Background pass finished (path is NULL) */
+    STORAGE_EVT_IDLE,           /* Pass with no turn for MIMI_STORAGE_GC_IDLE_MS (path is NULL) */
+} storage_evt_t;
+
+/**
+ * Called for every storage_notify() and once per background pass.
+ * Runs on the caller's task; keep it short, except on STORAGE_EVT_IDLE,
+ * which runs on the storage task between turns and may make LLM calls.
+ */
+typedef void (*storage_listener_t)(storage_evt_t evt, const char *path);
+
+/**
+ * Initialize the storage manager.
+ */
+esp_err_t storage_mgr_init(void);
+
+/**
+ * Start the background task that scans usage and enforces quotas,
+ * every MIMI_STORAGE_CHECK_INTERVAL_MS or when requested. On SPIFFS each
+ * pass also collects garbage up to MIMI_STORAGE_GC_FREE_TARGET, but only
+ * while no agent turn is running, so writes inside a turn do not stall.
+ */
+esp_err_t storage_mgr_start(void);
+
+/**
+ * Ask the background task for a scan soon (rate-limited, non-blocking).
+ */
+void storage_mgr_request_check(void);
+
+/**
+ * Mark an agent turn as running (true) or finished (false). Idle GC and
+ * STORAGE_EVT_IDLE wait MIMI_STORAGE_GC_IDLE_MS after a turn; GC stops
+ * between steps when a new one starts.
+ */
+void storage_mgr_set_busy(bool busy);
+
+/**
+ * Record the latency of a write to path that began at start_us
+ * (esp_timer_get_time()) and has just been closed.
+ */
+void storage_note_write(const char *path, int64_t start_us);
+
+/**
+ * Register a listener for file change events (up to MIMI_STORAGE_MAX_LISTENERS).
+ */
+esp_err_t storage_add_listener(storage_listener_t fn);
+
+/**
+ * Update the file catalog and cache, then tell listeners (search index,
+ * memory fingerprints) that a file changed or was removed. Writers of files
+ * under MIMI_SPIFFS_BASE call this after closing the file.
+ */
+void storage_notify(storage_evt_t evt, const char *path);
+
+/**
+ * Snapshot of the usage and eviction counters from the last scan.
+ */
+void storage_get_stats(storage_stats_t *out);
+
+/**
+ * Namespace a path under MIMI_SPIFFS_BASE belongs to.
+ */
+storage_ns_t storage_ns_of(const char *path);
+
+const char *storage_ns_name(storage_ns_t ns);
@@ -0,0 +1,307 @@
+#include "tools/json_stream.h"
+
+#include <string.h>
+
+enum {
+    S_VALUE = 0,                /* A value */
+    S_FIRST,                    /* After '[': a value or ']' */
+    S_KEY_FIRST,                /* After '{': a key or '}' */
+    S_KEY,                      /* After ',' in an object: a key */
+    S_COLON,
+    S_NEXT,                     /* After a member or element: ',' or the closer */
+    S_STRING,
+    S_LITERAL,                  /* Number, true, false or null */
+    S_DONE,
+    S_ERROR,
+};
+
+/* ── Containers ─────────────────────────────────────────────── */
+
+static bool push(json_stream_t *js, bool is_array)
+{
+    if (js->depth >= JSON_STREAM_MAX_DEPTH) return false;
+    json_stream_level_t *l = &js->level[js->depth++];
+    l->key[0] = '\0';
+    l->index = 0;
+    l->is_array = is_array;
+    return true;
+}
+
+static void value_done(json_stream_t *js)
+{
+    js->state = js->depth == 0 ? S_DONE : S_NEXT;
+}
+
+/* ── Strings ────────────────────────────────────────────────── */
+
+static bool put_bytes(json_stream_t *js, const char *p, size_t n)
+{
+    char *buf = js->in_key ? js->level[js->depth - 1].key : js->value;
+    size_t cap = js->in_key ? JSON_STREAM_KEY_MAX : JSON_STREAM_VALUE_MAX;
+    if (js->len + n > cap - 1) {
+        js->truncated = true;
+        return false;
+    }
+    memcpy(buf + js->len, p, n);
+    js->len += n;
+    return true;
+}
+
+static void put_code(json_stream_t *js, unsigned cp)
+{
+    char u[4];
+    size_t n;
+    if (cp < 0x80) {
+        u[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        u[0] = (char)(0xC0 | (cp >> 6));
+        u[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        u[0] = (char)(0xE0 | (cp >> 12));
+        u[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        u[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        u[0] = (char)(0xF0 | (cp >> 18));
+        u[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        u[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        u[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    put_bytes(js, u, n);
+}
+
+/* A \uXXXX escape; surrogate pairs combine, unpaired halves become U+FFFD */
+static void put_escape(json_stream_t *js, unsigned cp)
+{
+    if (cp >= 0xD800 && cp < 0xDC00) {
+        if (js->high) put_code(js, 0xFFFD);
+        js->high = cp;
+        return;
+    }
+    if (cp >= 0xDC00 && cp < 0xE000) {
+        cp = js->high ? 0x10000 + ((js->high - 0xD800) << 10) + (cp - 0xDC00) : 0xFFFD;
+    } else if (js->high) {
+        put_code(js, 0xFFFD);
+    }
+    js->high = 0;
+    put_code(js, cp);
+}
+
+static void put_char(json_stream_t *js, char c)
+{
+    if (js->high) {
+        js->high = 0;
+        put_code(js, 0xFFFD);
+    }
+    put_bytes(js, &c, 1);
+}
+
+/* Drop a UTF-8 sequence the length limit cut in half. */
+static void trim_partial(char *s, size_t *len)
+{
+    size_t i = *len;
+    while (i > 0 && ((unsigned char)s[i - 1] & 0xC0) == 0x80) i--;
+    if (i == 0) return;
+    unsigned char lead = (unsigned char)s[i - 1];
+    size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    if (*len - (i - 1) < need) *len = i - 1;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Returns false to stop: malformed escape or the callback said so. */
+static bool string_char(json_stream_t *js, char c)
+{
+    if (js->esc == 1) {
+        static const char from[] = "\"\\/bfnrt";
+        static const char to[] = "\"\\/\b\f\n\r\t";
+        js->esc = 0;
+        if (c == 'u') {
+            js->esc = 2;
+            js->code = 0;
+            return true;
+        }
+        const char *p = c ? strchr(from, c) : NULL;
+        if (!p) {
+            js->state = S_ERROR;
+            return false;
+        }
+        put_char(js, to[p - from]);
+        return true;
+    }
+    if (js->esc >= 2) {
+        int h = hex_value(c);
+        if (h < 0) {
+            js->state = S_ERROR;
+            return false;
+        }
+        js->code = (js->code << 4) | (unsigned)h;
+        if (++js->esc == 6) {
+            js->esc = 0;
+            put_escape(js, js->code);
+        }
+        return true;
+    }
+    if (c == '\\') {
+        js->esc = 1;
+        return true;
+    }
+    if (c != '"') {
+        put_char(js, c);
+        return true;
+    }
+
+    /* Closing quote */
+    if (js->high) {
+        js->high = 0;
+        put_code(js, 0xFFFD);
+    }
+    if (js->in_key) {
+        js->level[js->depth - 1].key[js->len] = '\0';
+        js->state = S_COLON;
+        return true;
+    }
+    if (js->truncated) trim_partial(js->value, &js->len);
+    js->value[js->len] = '\0';
+    value_done(js);
+    if (!js->cb(js, js->value, js->len, js->truncated, js->ctx)) {
+        js->state = S_DONE;
+        return false;
+    }
+    return true;
+}
+
+static void string_start(json_stream_t *js, bool is_key)
+{
+    js->state = S_STRING;
+    js->in_key = is_key;
+    js->esc = 0;
+    js->high = 0;
+    js->len = 0;
+    js->truncated = false;
+}
+
+/* ── Structure ──────────────────────────────────────────────── */
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_literal(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' ||
+           c == '.' || c == 'E';
+}
+
+static void structural(json_stream_t *js, char c)
+{
+    json_stream_level_t *top = js->depth ? &js->level[js->depth - 1] : NULL;
+
+    switch (js->state) {
+    case S_FIRST:
+        if (c == ']') {
+            js->depth--;
+            value_done(js);
+            return;
+        }
+        /* fall through */
+    case S_VALUE:
+        if (c == '{' || c == '[') {
+            js->state = c == '{' ? S_KEY_FIRST : S_FIRST;
+            if (!push(js, c == '[')) js->state = S_ERROR;
+        } else if (c == '"') {
+            string_start(js, false);
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+            js->state = S_LITERAL;
+        } else {
+            js->state = S_ERROR;
+        }
+        return;
+    case S_KEY_FIRST:
+        if (c == '}') {
+            js->depth--;
+            value_done(js);
+            return;
+        }
+        /* fall through */
+    case S_KEY:
+        if (c == '"') {
+            string_start(js, true);
+        } else {
+            js->state = S_ERROR;
+        }
+        return;
+    case S_COLON:
+        js->state = c == ':' ? S_VALUE : S_ERROR;
+        return;
+    case S_NEXT:
+        if (c == ',') {
+            if (top->is_array) top->index++;
+            js->state = top->is_array ? S_VALUE : S_KEY;
+        } else if (c == (top->is_array ? ']' : '}')) {
+            js->depth--;
+            value_done(js);
+        } else {
+            js->state = S_ERROR;
+        }
+        return;
+    default:
+        js->state = S_ERROR;
+        return;
+    }
+}
+
+/* ── Public API ─────────────────────────────────────────────── */
+
+void json_stream_init(json_stream_t *js, json_stream_cb_t cb, void *ctx)
+{
+    memset(js, 0, offsetof(json_stream_t, value));
+    js->value[0] = '\0';
+    js->cb = cb;
+    js->ctx = ctx;
+    js->state = S_VALUE;
+}
+
+json_stream_status_t json_stream_feed(json_stream_t *js, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && js->state != S_DONE && js->state != S_ERROR) {
+        char c = data[i];
+        if (js->state == S_STRING) {
+            string_char(js, c);
+        } else if (js->state == S_LITERAL) {
+            if (!is_literal(c)) {
+                /* The literal ended; look at c again as structure */
+                value_done(js);
+                continue;
+            }
+        } else if (!is_space(c)) {
+            structural(js, c);
+        }
+        i++;
+    }
+    if (js->state == S_DONE) return JSON_STREAM_DONE;
+    return js->state == S_ERROR ? JSON_STREAM_ERROR : JSON_STREAM_MORE;
+}
+
+const char *json_stream_key(const json_stream_t *js, int level)
+{
+    if (level < 0 || level >= js->depth || js->level[level].is_array) return NULL;
+    return js->level[level].key;
+}
+
+int json_stream_index(const json_stream_t *js, int level)
+{
+    if (level < 0 || level >= js->depth || !js->level[level].is_array) return -1;
+    return js->level[level].index;
+}
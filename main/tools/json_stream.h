@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Push parser for JSON that arrives in pieces, e.g. an HTTP body read
+ * chunk by chunk. Memory is fixed whatever the document size: nesting
+ * up to JSON_STREAM_MAX_DEPTH, keys up to JSON_STREAM_KEY_MAX - 1 bytes
+ * (longer ones are cut) and string values up to JSON_STREAM_VALUE_MAX - 1
+ * bytes (longer ones are cut and flagged). Only string values are
+ * reported; numbers, true, false and null are skipped.
+ */
+
+#define JSON_STREAM_MAX_DEPTH   16
+#define JSON_STREAM_KEY_MAX     24
+#define JSON_STREAM_VALUE_MAX   768
+
+typedef enum {
+    JSON_STREAM_MORE = 0,       /* Fine so far, feed more */
+    JSON_STREAM_DONE,           /* Root value closed, or the callback stopped */
+    JSON_STREAM_ERROR,          /* Malformed, or nested too deep */
+} json_stream_status_t;
+
+typedef struct json_stream json_stream_t;
+
+/**
+ * String value callback. value is NUL-terminated and unescaped (\uXXXX
+ * becomes UTF-8); truncated tells whether it was cut. Use
+ * json_stream_key() / json_stream_index() for where it sits.
+ * Return false to stop parsing.
+ */
+typedef bool (*json_stream_cb_t)(const json_stream_t *js, const char *value, size_t len,
+                                 bool truncated, void *ctx);
+
+typedef struct {
+    char key[JSON_STREAM_KEY_MAX];  /* Objects: key of the current member */
+    int index;                      /* Arrays: index of the current element */
+    bool is_array;
+} json_stream_level_t;
+
+struct json_stream {
+    int depth;                  /* Open containers around the current value */
+    json_stream_level_t level[JSON_STREAM_MAX_DEPTH];
+
+    /* Private */
+    json_stream_cb_t cb;
+    void *ctx;
+    int state;
+    bool in_key;
+    int esc;                    /* 0, 1 after '\', 2..5 inside \uXXXX */
+    unsigned code;
+    unsigned high;              /* Pending UTF-16 high surrogate */
+    size_t len;
+    bool truncated;
+    char value[JSON_STREAM_VALUE_MAX];
+};
+
+/** Start a new document. */
+void json_stream_init(json_stream_t *js, json_stream_cb_t cb, void *ctx);
+
+/** Parse the next piece of the document. */
+json_stream_status_t json_stream_feed(json_stream_t *js, const char *data, size_t len);
+
+/**
+ * Key at a nesting level (0 = the root object), or NULL if that level is
+ * an array or not open.
+ */
+const char *json_stream_key(const json_stream_t *js, int level);
+
+/** Element index at a nesting level, or -1 if it is an object or not open. */
+int json_stream_index(const json_stream_t *js, int level);
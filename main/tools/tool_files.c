@@ -1,34 +1,266 @@
 #include "tools/tool_files.h"
 #include "mimi_config.h"
+#include "storage/fs_backend.h"
+#include "storage/file_cache.h"
+#include "storage/fs_writer.h"
+#include "storage/fs_compress.h"
+#include "storage/storage_mgr.h"
+#include "memory/memory_dedup.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <dirent.h>
+#include <ctype.h>
 #include <sys/stat.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "cJSON.h"
 
 static const char *TAG = "tool_files";
 
 #define MAX_FILE_SIZE (32 * 1024)
+#define FOOTER_RESERVE 128      /* Room kept for the range / match summary line */
+#define GREP_DEFAULT_MATCHES 20
+#define EDIT_CHUNK 1024         /* edit_file reads this much past the longest old_string */
+#define BATCH_RESULT_MIN 160    /* Output kept for each file_batch op still to run */
+
+#define PATH_ERROR "Error: path must start with /spiffs/, must not contain '..' " \
+                   "and must not end in " FS_WRITE_TMP_EXT " or " FS_WRITE_OLD_EXT
 
 /**
- * Validate that a path starts with /spiffs/ and contains no ".." traversal.
+ * Validate that a path starts with /spiffs/, contains no ".." traversal and
+ * is not one of fs_writer's temporary names, which recovery would take over.
  */
 static bool validate_path(const char *path)
 {
     if (!path) return false;
     if (strncmp(path, "/spiffs/", 8) != 0) return false;
     if (strstr(path, "..") != NULL) return false;
+    if (fs_writer_is_temp(path)) return false;
     return true;
 }
 
+/* Tell the model which near-duplicate memory entries were dropped or kept. */
+static void append_dedup_note(char *output, size_t output_size, const memory_dedup_report_t *rep)
+{
+    if (!rep->duplicates) return;
+    size_t len = strlen(output);
+    if (rep->dropped) {
+        snprintf(output + len, output_size - len,
+                 " (dropped %d near-duplicate memory entr%s already saved, e.g. %s)",
+                 rep->dropped, rep->dropped == 1 ? "y" : "ies", rep->detail);
+    } else {
+        snprintf(output + len, output_size - len,
+                 " (warning: %d entr%s repeat existing memory, e.g. %s)",
+                 rep->duplicates, rep->duplicates == 1 ? "y" : "ies", rep->detail);
+    }
+}
+
+/* ── File source ───────────────────────────────────────────── */
+
+/*
+ * Files up to MAX_FILE_SIZE come whole from the file cache, so pending
+ * writes, packed digests and built-in assets read as text. Larger files
+ * are streamed from flash, so memory stays bounded whatever the size.
+ */
+typedef struct {
+    char *data;                 /* Whole file, or NULL when streaming */
+    FILE *f;
+    size_t size;
+    size_t pos;                 /* Only used with data */
+} file_src_t;
+
+static esp_err_t src_open(const char *path, file_src_t *src)
+{
+    memset(src, 0, sizeof(*src));
+    src->data = file_cache_read_alloc(path, MAX_FILE_SIZE, &src->size);
+    if (src->data) return ESP_OK;
+    if (src->size == 0) return ESP_ERR_NOT_FOUND;
+
+    /* The cache only serves pending contents it could return whole */
+    fs_writer_flush(path);
+    src->f = fopen(path, "r");
+    if (!src->f) return ESP_ERR_NOT_FOUND;
+
+    /* A packed file that inflates past MAX_FILE_SIZE cannot be streamed as text */
+    char head[16];
+    size_t n = fread(head, 1, sizeof(head), src->f);
+    if (fs_compress_is_packed(head, n)) {
+        fclose(src->f);
+        src->f = NULL;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    fseek(src->f, 0, SEEK_END);
+    long size = ftell(src->f);
+    fseek(src->f, 0, SEEK_SET);
+    src->size = size > 0 ? (size_t)size : 0;
+    return ESP_OK;
+}
+
+static void src_close(file_src_t *src)
+{
+    free(src->data);
+    if (src->f) fclose(src->f);
+}
+
+static int src_getc(file_src_t *src)
+{
+    if (src->f) return fgetc(src->f);
+    return src->pos < src->size ? (unsigned char)src->data[src->pos++] : EOF;
+}
+
+static size_t src_read(file_src_t *src, char *buf, size_t n)
+{
+    if (src->f) return fread(buf, 1, n, src->f);
+    if (n > src->size - src->pos) n = src->size - src->pos;
+    memcpy(buf, src->data + src->pos, n);
+    src->pos += n;
+    return n;
+}
+
+static size_t src_read_at(file_src_t *src, size_t offset, char *buf, size_t n)
+{
+    if (offset >= src->size) return 0;
+    if (n > src->size - offset) n = src->size - offset;
+    if (src->f) {
+        fseek(src->f, (long)offset, SEEK_SET);
+        return fread(buf, 1, n, src->f);
+    }
+    memcpy(buf, src->data + offset, n);
+    return n;
+}
+
+/*
+ * Next line without its line ending, cut to size - 1 bytes.
+ * @return line length, or -1 at end of file
+ */
+static int src_line(file_src_t *src, char *line, size_t size, bool *cut)
+{
+    size_t len = 0;
+    int c = src_getc(src);
+    if (c == EOF) return -1;
+
+    *cut = false;
+    while (c != EOF && c != '\n') {
+        if (len < size - 1) {
+            line[len++] = (char)c;
+        } else {
+            *cut = true;
+        }
+        c = src_getc(src);
+    }
+    if (len && line[len - 1] == '\r') len--;
+    line[len] = '\0';
+    return (int)len;
+}
+
 /* ── read_file ─────────────────────────────────────────────── */
 
+/* Optional non-negative integer argument; -1 when absent. */
+static long get_count(cJSON *root, const char *name)
+{
+    cJSON *item = cJSON_GetObjectItem(root, name);
+    if (!cJSON_IsNumber(item)) return -1;
+    return item->valuedouble < 0 ? 0 : (long)item->valuedouble;
+}
+
+/* Bytes [offset, offset + length), with a note when more follows. */
+static void read_bytes(file_src_t *src, const char *path, size_t offset, long length,
+                       bool ranged, char *output, size_t output_size)
+{
+    if (offset > src->size) offset = src->size;
+    size_t room = output_size - 1 - FOOTER_RESERVE;
+    size_t want = length < 0 || (size_t)length > room ? room : (size_t)length;
+    size_t n = src_read_at(src, offset, output, want);
+    output[n] = '\0';
+    const char *nl = n && output[n - 1] != '\n' ? "\n" : "";
+
+    size_t end = offset + n;
+    if (end < src->size) {
+        snprintf(output + n, output_size - n,
+                 "%s[bytes %u-%u of %u; continue with offset=%u]", nl,
+                 (unsigned)offset, (unsigned)end, (unsigned)src->size, (unsigned)end);
+    } else if (ranged) {
+        snprintf(output + n, output_size - n, "%s[bytes %u-%u of %u]", nl,
+                 (unsigned)offset, (unsigned)end, (unsigned)src->size);
+    }
+    ESP_LOGI(TAG, "read_file: %s bytes %u-%u of %u", path,
+             (unsigned)offset, (unsigned)end, (unsigned)src->size);
+}
+
+/* Lines [line_start, line_start + line_count), 1-based, as far as the output allows. */
+static esp_err_t read_lines(file_src_t *src, const char *path, long line_start, long line_count,
+                            char *output, size_t output_size)
+{
+    if (line_start < 1) line_start = 1;
+    if (line_count < 0) line_count = 0x7FFFFFFF;
+
+    long newlines = 0;
+    size_t pos = 0;
+    int c, last = EOF;
+    while (newlines + 1 < line_start && (c = src_getc(src)) != EOF) {
+        pos++;
+        last = c;
+        if (c == '\n') newlines++;
+    }
+    if (newlines + 1 < line_start) {
+        snprintf(output, output_size, "Error: %s has only %ld lines", path,
+                 newlines + (last != '\n' && last != EOF));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t room = output_size - 1 - FOOTER_RESERVE;
+    size_t off = 0;
+    long shown = 0;
+    bool cut = false;
+    while (shown < line_count) {
+        if (off >= room) {
+            cut = true;
+            break;
+        }
+        if ((c = src_getc(src)) == EOF) break;
+        output[off++] = (char)c;
+        last = c;
+        if (c == '\n') shown++;
+    }
+    output[off] = '\0';
+
+    /* Count the rest, so the model knows how far the file goes */
+    newlines += shown;
+    while ((c = src_getc(src)) != EOF) {
+        last = c;
+        if (c == '\n') newlines++;
+    }
+    long total = newlines + (last != '\n' && last != EOF);
+    if (!cut && off > 0 && output[off - 1] != '\n') shown++;   /* Last line, no newline */
+
+    long end = line_start + shown - 1;
+    const char *nl = off && output[off - 1] != '\n' ? "\n" : "";
+    if (cut && shown == 0) {
+        snprintf(output + off, output_size - off,
+                 "%s[line %ld is longer than the output; continue with offset=%u]", nl,
+                 line_start, (unsigned)(pos + off));
+    } else if (cut || end < total) {
+        snprintf(output + off, output_size - off,
+                 "%s[lines %ld-%ld of %ld; continue with line_start=%ld]", nl,
+                 line_start, end, total, end + 1);
+    } else {
+        snprintf(output + off, output_size - off, "%s[lines %ld-%ld of %ld]", nl,
+                 line_start, end, total);
+    }
+    ESP_LOGI(TAG, "read_file: %s lines %ld-%ld of %ld", path, line_start, end, total);
+    return ESP_OK;
+}
+
 esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t output_size)
 {
+    if (output_size <= FOOTER_RESERVE + 1) {
+        snprintf(output, output_size, "Error: output buffer too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
     cJSON *root = cJSON_Parse(input_json);
     if (!root) {
         snprintf(output, output_size, "Error: invalid JSON input");
@@ -37,26 +269,201 @@ esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t ou
 
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
     if (!validate_path(path)) {
-        snprintf(output, output_size, "Error: path must start with /spiffs/ and must not contain '..'");
+        snprintf(output, output_size, PATH_ERROR);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    long offset = get_count(root, "offset");
+    long length = get_count(root, "length");
+    long line_start = get_count(root, "line_start");
+    long line_count = get_count(root, "line_count");
+
+    file_src_t src;
+    esp_err_t err = src_open(path, &src);
+    if (err == ESP_ERR_NOT_FOUND) {
         snprintf(output, output_size, "Error: file not found: %s", path);
+    } else if (err != ESP_OK) {
+        snprintf(output, output_size, "Error: %s is compressed and too large to read", path);
+    } else if (line_start >= 0 || line_count >= 0) {
+        err = read_lines(&src, path, line_start, line_count, output, output_size);
+    } else {
+        read_bytes(&src, path, offset < 0 ? 0 : (size_t)offset, length,
+                   offset >= 0 || length >= 0, output, output_size);
+    }
+
+    src_close(&src);
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── grep_file ─────────────────────────────────────────────── */
+
+static bool line_contains(const char *line, const char *pat, size_t pat_len, bool icase)
+{
+    if (!icase) return strstr(line, pat) != NULL;
+    for (; *line; line++) {
+        size_t i = 0;
+        while (i < pat_len && line[i] &&
+               tolower((unsigned char)line[i]) == tolower((unsigned char)pat[i])) {
+            i++;
+        }
+        if (i == pat_len) return true;
+    }
+    return false;
+}
+
+typedef struct {
+    char *out;
+    size_t size;                /* Usable bytes, FOOTER_RESERVE excluded */
+    size_t off;
+    bool full;
+} grep_out_t;
+
+/* grep style: "12: text" for a match, "11- text" for context */
+static void grep_emit(grep_out_t *go, long lineno, char sep, const char *text, bool cut)
+{
+    if (go->full) return;
+    int n = snprintf(go->out + go->off, go->size - go->off, "%ld%c %s%s\n",
+                     lineno, sep, text, cut ? " ..." : "");
+    if (n < 0 || go->off + n >= go->size) {
+        go->out[go->off] = '\0';
+        go->full = true;
+        return;
+    }
+    go->off += n;
+}
+
+static void grep_sep(grep_out_t *go)
+{
+    if (go->full) return;
+    if (go->off + 4 >= go->size) {
+        go->full = true;
+        return;
+    }
+    go->off += snprintf(go->out + go->off, go->size - go->off, "--\n");
+}
+
+esp_err_t tool_grep_file_execute(const char *input_json, char *output, size_t output_size)
+{
+    if (output_size <= FOOTER_RESERVE + 1) {
+        snprintf(output, output_size, "Error: output buffer too small");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
+    const char *pattern = cJSON_GetStringValue(cJSON_GetObjectItem(root, "pattern"));
+    long context = get_count(root, "context");
+    long max_matches = get_count(root, "max_matches");
+    bool icase = !cJSON_IsTrue(cJSON_GetObjectItem(root, "case_sensitive"));
+
+    if (!validate_path(path)) {
+        snprintf(output, output_size, PATH_ERROR);
         cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!pattern || !pattern[0] || strlen(pattern) >= MIMI_GREP_LINE_MAX) {
+        snprintf(output, output_size, "Error: 'pattern' must be 1-%d characters", MIMI_GREP_LINE_MAX - 1);
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (context < 0) context = 0;
+    if (context > MIMI_GREP_MAX_CONTEXT) context = MIMI_GREP_MAX_CONTEXT;
+    if (max_matches < 1) max_matches = GREP_DEFAULT_MATCHES;
+    if (max_matches > MIMI_GREP_MAX_MATCHES) max_matches = MIMI_GREP_MAX_MATCHES;
+
+    file_src_t src;
+    esp_err_t err = src_open(path, &src);
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_NOT_FOUND) {
+            snprintf(output, output_size, "Error: file not found: %s", path);
+        } else {
+            snprintf(output, output_size, "Error: %s is compressed and too large to search", path);
+        }
+        cJSON_Delete(root);
+        return err;
     }
 
-    size_t max_read = output_size - 1;
-    if (max_read > MAX_FILE_SIZE) max_read = MAX_FILE_SIZE;
+    /* The current line, then a ring of the previous `context` lines */
+    char *lines = heap_caps_malloc((context + 1) * MIMI_GREP_LINE_MAX, MALLOC_CAP_SPIRAM);
+    bool *ring_cut = heap_caps_calloc(context + 1, sizeof(bool), MALLOC_CAP_SPIRAM);
+    if (!lines || !ring_cut) {
+        free(lines);
+        free(ring_cut);
+        src_close(&src);
+        snprintf(output, output_size, "Error: out of memory");
+        cJSON_Delete(root);
+        return ESP_ERR_NO_MEM;
+    }
+    char *cur = lines;
+    char *ring = lines + MIMI_GREP_LINE_MAX;
+
+    grep_out_t go = { .out = output, .size = output_size - FOOTER_RESERVE, .off = 0 };
+    output[0] = '\0';
+    size_t pat_len = strlen(pattern);
+    long lineno = 0, last_shown = 0, more_at = 0;
+    long after = 0;
+    int matches = 0;
+    bool cut = false;
+
+    while (!go.full && src_line(&src, cur, MIMI_GREP_LINE_MAX, &cut) >= 0) {
+        lineno++;
+        if (line_contains(cur, pattern, pat_len, icase)) {
+            if (matches == max_matches) {
+                more_at = lineno;
+                break;
+            }
+            long before = lineno - 1 - last_shown;
+            if (before > context) before = context;
+            if (context && last_shown && lineno - before > last_shown + 1) grep_sep(&go);
+            for (long k = before; k >= 1; k--) {
+                long slot = (lineno - k) % context;
+                grep_emit(&go, lineno - k, '-', ring + slot * MIMI_GREP_LINE_MAX, ring_cut[slot]);
+            }
+            grep_emit(&go, lineno, ':', cur, cut);
+            if (go.full) {
+                more_at = lineno;
+                break;
+            }
+            last_shown = lineno;
+            after = context;
+            matches++;
+        } else if (after > 0) {
+            grep_emit(&go, lineno, '-', cur, cut);
+            last_shown = lineno;
+            after--;
+        }
+        if (context) {
+            long slot = lineno % context;
+            strcpy(ring + slot * MIMI_GREP_LINE_MAX, cur);
+            ring_cut[slot] = cut;
+        }
+    }
 
-    size_t n = fread(output, 1, max_read, f);
-    output[n] = '\0';
-    fclose(f);
+    if (matches == 0) {
+        snprintf(output, output_size, "No matches for \"%s\" in %s (%ld lines)", pattern, path, lineno);
+    } else if (more_at) {
+        snprintf(output + go.off, output_size - go.off,
+                 "[%d matches shown; next match at line %ld, read on with line_start=%ld or narrow the pattern]",
+                 matches, more_at, more_at);
+    } else if (go.full) {
+        snprintf(output + go.off, output_size - go.off,
+                 "[%d match%s; output full at line %ld]", matches, matches == 1 ? "" : "es", lineno);
+    } else {
+        snprintf(output + go.off, output_size - go.off, "[%d match%s in %ld lines]",
+                 matches, matches == 1 ? "" : "es", lineno);
+    }
 
-    ESP_LOGI(TAG, "read_file: %s (%d bytes)", path, (int)n);
+    ESP_LOGI(TAG, "grep_file: %s \"%s\" -> %d matches", path, pattern, matches);
+    free(lines);
+    free(ring_cut);
+    src_close(&src);
     cJSON_Delete(root);
     return ESP_OK;
 }
@@ -72,10 +479,10 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
     }
 
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
-    const char *content = cJSON_GetStringValue(cJSON_GetObjectItem(root, "content"));
+    char *content = cJSON_GetStringValue(cJSON_GetObjectItem(root, "content"));
 
     if (!validate_path(path)) {
-        snprintf(output, output_size, "Error: path must start with /spiffs/ and must not contain '..'");
+        snprintf(output, output_size, PATH_ERROR);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
@@ -85,31 +492,154 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
         return ESP_ERR_INVALID_ARG;
     }
 
-    FILE *f = fopen(path, "w");
-    if (!f) {
-        snprintf(output, output_size, "Error: cannot open file for writing: %s", path);
-        cJSON_Delete(root);
-        return ESP_FAIL;
-    }
-
-    size_t len = strlen(content);
-    size_t written = fwrite(content, 1, len, f);
-    fclose(f);
+    memory_dedup_report_t dedup;
+    size_t len = memory_dedup_filter(path, true, content, strlen(content), &dedup);
 
-    if (written != len) {
-        snprintf(output, output_size, "Error: wrote %d of %d bytes to %s", (int)written, (int)len, path);
+    /* Agents often rewrite a file several times in a turn: flush the last one */
+    if (fs_write_coalesced(path, content, len, FS_WRITER_TOOLS) != ESP_OK) {
+        snprintf(output, output_size, "Error: cannot write file: %s", path);
         cJSON_Delete(root);
         return ESP_FAIL;
     }
 
-    snprintf(output, output_size, "OK: wrote %d bytes to %s", (int)written, path);
-    ESP_LOGI(TAG, "write_file: %s (%d bytes)", path, (int)written);
+    snprintf(output, output_size, "OK: wrote %d bytes to %s", (int)len, path);
+    append_dedup_note(output, output_size, &dedup);
+    ESP_LOGI(TAG, "write_file: %s (%d bytes)", path, (int)len);
     cJSON_Delete(root);
     return ESP_OK;
 }
 
 /* ── edit_file ─────────────────────────────────────────────── */
 
+typedef struct {
+    const char *old_str;
+    const char *new_str;
+    size_t old_len;
+    size_t new_len;
+    int limit;                  /* Replacements wanted, 0 for all */
+    int applied;
+    int found;                  /* Occurrences in the original text */
+} edit_t;
+
+/*
+ * Edited contents go to a PSRAM buffer when the file came whole from the
+ * cache, so they can be deduplicated and coalesced like write_file, and
+ * straight to "<path>~new" otherwise.
+ */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    fs_write_stream_t *ws;
+    bool failed;
+} edit_sink_t;
+
+static void sink_put(edit_sink_t *sink, const char *data, size_t n)
+{
+    if (n == 0 || sink->failed) return;
+    if (sink->ws) {
+        sink->failed = fwrite(data, 1, n, sink->ws->f) != n;
+        sink->len += n;
+        return;
+    }
+    if (sink->len + n + 1 > sink->cap) {
+        size_t cap = sink->cap * 2 > sink->len + n + 1 ? sink->cap * 2 : sink->len + n + 1;
+        char *grown = heap_caps_realloc(sink->buf, cap, MALLOC_CAP_SPIRAM);
+        if (!grown) {
+            sink->failed = true;
+            return;
+        }
+        sink->buf = grown;
+        sink->cap = cap;
+    }
+    memcpy(sink->buf + sink->len, data, n);
+    sink->len += n;
+    sink->buf[sink->len] = '\0';
+}
+
+/*
+ * One pass over the original text, left to right. At each position the
+ * first listed edit that matches and still has replacements left wins.
+ * Only EDIT_CHUNK plus the longest old_string is held at a time.
+ */
+static esp_err_t apply_edits(file_src_t *src, edit_t *edits, int count, edit_sink_t *sink)
+{
+    size_t max_old = 0;
+    for (int i = 0; i < count; i++) {
+        if (edits[i].old_len > max_old) max_old = edits[i].old_len;
+    }
+    size_t cap = EDIT_CHUNK + max_old;
+    char *win = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM);
+    if (!win) return ESP_ERR_NO_MEM;
+
+    size_t pos = 0, end = 0;
+    size_t run = 0;             /* Start of the bytes passed through unchanged */
+    bool eof = false;
+    while (1) {
+        if (!eof && end - pos < max_old) {
+            sink_put(sink, win + run, pos - run);
+            memmove(win, win + pos, end - pos);
+            end -= pos;
+            pos = run = 0;
+            size_t n = src_read(src, win + end, cap - end);
+            if (n == 0) eof = true;
+            end += n;
+            continue;
+        }
+        if (pos == end) break;
+
+        edit_t *hit = NULL;
+        for (int i = 0; i < count; i++) {
+            edit_t *e = &edits[i];
+            if (e->old_len > end - pos || memcmp(win + pos, e->old_str, e->old_len) != 0) continue;
+            e->found++;
+            if (!hit && (e->limit == 0 || e->applied < e->limit)) hit = e;
+        }
+        if (!hit) {
+            pos++;
+            continue;
+        }
+        sink_put(sink, win + run, pos - run);
+        sink_put(sink, hit->new_str, hit->new_len);
+        hit->applied++;
+        pos += hit->old_len;
+        run = pos;
+    }
+    sink_put(sink, win + run, pos - run);
+    free(win);
+    return sink->failed ? ESP_FAIL : ESP_OK;
+}
+
+/* One {old_string, new_string, count} object; false when malformed. */
+static bool parse_edit(cJSON *obj, edit_t *e)
+{
+    memset(e, 0, sizeof(*e));
+    e->old_str = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "old_string"));
+    e->new_str = cJSON_GetStringValue(cJSON_GetObjectItem(obj, "new_string"));
+    if (!e->old_str || !e->old_str[0] || !e->new_str) return false;
+    e->old_len = strlen(e->old_str);
+    e->new_len = strlen(e->new_str);
+    long n = get_count(obj, "count");
+    e->limit = n < 0 ? 1 : (int)n;
+    return true;
+}
+
+/* "edit 1: 1 of 3 matches, edit 2: 4" */
+static void append_edit_counts(char *output, size_t output_size, const edit_t *edits, int count)
+{
+    size_t len = strlen(output);
+    for (int i = 0; i < count && len < output_size - 1; i++) {
+        const edit_t *e = &edits[i];
+        if (e->found > e->applied) {
+            len += snprintf(output + len, output_size - len, "%sedit %d: %d of %d matches",
+                            i ? ", " : "", i + 1, e->applied, e->found);
+        } else {
+            len += snprintf(output + len, output_size - len, "%sedit %d: %d",
+                            i ? ", " : "", i + 1, e->applied);
+        }
+    }
+}
+
 esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -119,100 +649,125 @@ esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t ou
     }
 
     const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
-    const char *old_str = cJSON_GetStringValue(cJSON_GetObjectItem(root, "old_string"));
-    const char *new_str = cJSON_GetStringValue(cJSON_GetObjectItem(root, "new_string"));
-
     if (!validate_path(path)) {
-        snprintf(output, output_size, "Error: path must start with /spiffs/ and must not contain '..'");
+        snprintf(output, output_size, PATH_ERROR);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
-    if (!old_str || !new_str) {
-        snprintf(output, output_size, "Error: missing 'old_string' or 'new_string' field");
+
+    /* Either an edits array or a single old_string / new_string */
+    edit_t edits[MIMI_EDIT_MAX_EDITS];
+    int count = 0;
+    cJSON *list = cJSON_GetObjectItem(root, "edits");
+    bool valid = true;
+    if (cJSON_IsArray(list)) {
+        cJSON *item;
+        cJSON_ArrayForEach(item, list) {
+            if (count == MIMI_EDIT_MAX_EDITS || !parse_edit(item, &edits[count])) {
+                valid = false;
+                break;
+            }
+            count++;
+        }
+    } else if (parse_edit(root, &edits[0])) {
+        count = 1;
+    }
+    if (!valid || count == 0) {
+        snprintf(output, output_size,
+                 "Error: need old_string and new_string, or 'edits' with 1-%d of them",
+                 MIMI_EDIT_MAX_EDITS);
         cJSON_Delete(root);
         return ESP_ERR_INVALID_ARG;
     }
 
-    /* Read existing file */
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        snprintf(output, output_size, "Error: file not found: %s", path);
+    file_src_t src;
+    esp_err_t err = src_open(path, &src);
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_NOT_FOUND) {
+            snprintf(output, output_size, "Error: file not found: %s", path);
+        } else {
+            snprintf(output, output_size, "Error: %s is compressed and too large to edit", path);
+        }
         cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+        return err;
     }
-
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (file_size <= 0 || file_size > MAX_FILE_SIZE) {
-        snprintf(output, output_size, "Error: file too large or empty (%ld bytes)", file_size);
-        fclose(f);
-        cJSON_Delete(root);
-        return ESP_ERR_INVALID_SIZE;
+    size_t old_size = src.size;
+
+    fs_write_stream_t ws;
+    edit_sink_t sink = { 0 };
+    if (src.data) {
+        sink.cap = src.size + 1;
+        sink.buf = heap_caps_malloc(sink.cap, MALLOC_CAP_SPIRAM);
+        if (!sink.buf) err = ESP_ERR_NO_MEM;
+    } else if ((err = fs_write_stream_begin(&ws, path, FS_WRITER_TOOLS)) == ESP_OK) {
+        sink.ws = &ws;
     }
+    if (err == ESP_OK) err = apply_edits(&src, edits, count, &sink);
+    src_close(&src);
 
-    /* Allocate buffer for the result (old content + possible expansion) */
-    size_t old_len = strlen(old_str);
-    size_t new_len = strlen(new_str);
-    size_t max_result = file_size + (new_len > old_len ? new_len - old_len : 0) + 1;
-    char *buf = malloc(file_size + 1);
-    char *result = malloc(max_result);
-    if (!buf || !result) {
-        free(buf);
-        free(result);
-        fclose(f);
-        snprintf(output, output_size, "Error: out of memory");
-        cJSON_Delete(root);
-        return ESP_ERR_NO_MEM;
+    int missing = 0;
+    for (int i = 0; i < count && !missing; i++) {
+        if (!edits[i].applied) missing = i + 1;
     }
 
-    size_t n = fread(buf, 1, file_size, f);
-    buf[n] = '\0';
-    fclose(f);
-
-    /* Find and replace first occurrence */
-    char *pos = strstr(buf, old_str);
-    if (!pos) {
-        snprintf(output, output_size, "Error: old_string not found in %s", path);
-        free(buf);
-        free(result);
-        cJSON_Delete(root);
-        return ESP_ERR_NOT_FOUND;
+    /* Nothing is written unless every edit applied */
+    memory_dedup_report_t dedup = { 0 };
+    if (sink.ws) {
+        esp_err_t end_err = fs_write_stream_end(&ws, err == ESP_OK && !missing);
+        if (err == ESP_OK && !missing) err = end_err;
+    } else if (err == ESP_OK && !missing) {
+        sink.len = memory_dedup_filter(path, true, sink.buf, sink.len, &dedup);
+        err = fs_write_coalesced(path, sink.buf, sink.len, FS_WRITER_TOOLS);
     }
+    free(sink.buf);
 
-    size_t prefix_len = pos - buf;
-    memcpy(result, buf, prefix_len);
-    memcpy(result + prefix_len, new_str, new_len);
-    size_t suffix_start = prefix_len + old_len;
-    size_t suffix_len = n - suffix_start;
-    memcpy(result + prefix_len + new_len, buf + suffix_start, suffix_len);
-    size_t total = prefix_len + new_len + suffix_len;
-    result[total] = '\0';
-
-    free(buf);
-
-    /* Write back */
-    f = fopen(path, "w");
-    if (!f) {
-        snprintf(output, output_size, "Error: cannot open file for writing: %s", path);
-        free(result);
-        cJSON_Delete(root);
-        return ESP_FAIL;
+    if (err == ESP_ERR_NO_MEM) {
+        snprintf(output, output_size, "Error: out of memory");
+    } else if (err != ESP_OK) {
+        snprintf(output, output_size, "Error: cannot write file: %s", path);
+    } else if (missing) {
+        if (count == 1) {
+            snprintf(output, output_size, "Error: old_string not found in %s", path);
+        } else {
+            snprintf(output, output_size, "Error: edit %d old_string not found in %s, nothing changed (",
+                     missing, path);
+            append_edit_counts(output, output_size, edits, count);
+            size_t len = strlen(output);
+            snprintf(output + len, output_size - len, ")");
+        }
+        err = ESP_ERR_NOT_FOUND;
+    } else {
+        snprintf(output, output_size, "OK: edited %s (%u -> %u bytes; ", path,
+                 (unsigned)old_size, (unsigned)sink.len);
+        append_edit_counts(output, output_size, edits, count);
+        size_t len = strlen(output);
+        snprintf(output + len, output_size - len, " replaced)");
+        append_dedup_note(output, output_size, &dedup);
     }
 
-    fwrite(result, 1, total, f);
-    fclose(f);
-    free(result);
-
-    snprintf(output, output_size, "OK: edited %s (replaced %d bytes with %d bytes)", path, (int)old_len, (int)new_len);
-    ESP_LOGI(TAG, "edit_file: %s", path);
+    ESP_LOGI(TAG, "edit_file: %s, %d edits, %s", path, count, esp_err_to_name(err));
     cJSON_Delete(root);
-    return ESP_OK;
+    return err;
 }
 
 /* ── list_dir ──────────────────────────────────────────────── */
 
+typedef struct {
+    char *out;
+    size_t size;
+    size_t off;
+    int count;
+} list_ctx_t;
+
+static bool on_list_file(const char *path, void *arg)
+{
+    list_ctx_t *lc = arg;
+    if (lc->off >= lc->size - 1) return false;
+    lc->off += snprintf(lc->out + lc->off, lc->size - lc->off, "%s\n", path);
+    lc->count++;
+    return true;
+}
+
 esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t output_size)
 {
     cJSON *root = cJSON_Parse(input_json);
@@ -224,37 +779,205 @@ esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t out
         }
     }
 
-    DIR *dir = opendir(MIMI_SPIFFS_BASE);
-    if (!dir) {
-        snprintf(output, output_size, "Error: cannot open /spiffs directory");
+    list_ctx_t lc = { .out = output, .size = output_size, .off = 0, .count = 0 };
+    output[0] = '\0';
+    fs_list(prefix ? prefix : MIMI_SPIFFS_BASE "/", on_list_file, &lc);
+    int count = lc.count;
+
+    if (count == 0) {
+        snprintf(output, output_size, "(no files found)");
+    }
+
+    ESP_LOGI(TAG, "list_dir: %d files (prefix=%s)", count, prefix ? prefix : "(none)");
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+/* ── file_batch ────────────────────────────────────────────── */
+
+/* Batch-only op: add content to the end of a file, creating it if needed. */
+static esp_err_t append_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(root, "path"));
+    const char *content = cJSON_GetStringValue(cJSON_GetObjectItem(root, "content"));
+    if (!validate_path(path)) {
+        snprintf(output, output_size, PATH_ERROR);
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!content) {
+        snprintf(output, output_size, "Error: missing 'content' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t len = strlen(content);
+    char *copy = heap_caps_malloc(len + 2, MALLOC_CAP_SPIRAM);
+    if (!copy) {
+        snprintf(output, output_size, "Error: out of memory");
+        cJSON_Delete(root);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, content, len + 1);
+
+    /* Drop entries that only restate ones already saved */
+    memory_dedup_report_t dedup;
+    len = memory_dedup_filter(path, false, copy, len, &dedup);
+    if (len == 0) {
+        snprintf(output, output_size, "OK: nothing appended to %s", path);
+        append_dedup_note(output, output_size, &dedup);
+        free(copy);
+        cJSON_Delete(root);
+        return ESP_OK;
+    }
+    if (copy[len - 1] != '\n') {
+        copy[len++] = '\n';
+        copy[len] = '\0';
+    }
+
+    int64_t start = esp_timer_get_time();
+    fs_writer_flush(path);
+    fs_ensure_parent(path);
+    FILE *f = fopen(path, "a");
+    size_t written = f ? fwrite(copy, 1, len, f) : 0;
+    long size = f ? ftell(f) : -1;
+    bool ok = f && fclose(f) == 0 && written == len;
+    free(copy);
+    if (!ok) {
+        snprintf(output, output_size, "Error: cannot append to %s", path);
         cJSON_Delete(root);
         return ESP_FAIL;
     }
+    storage_note_write(path, start);
+    storage_notify(STORAGE_EVT_CHANGED, path);
 
-    size_t off = 0;
-    struct dirent *ent;
-    int count = 0;
+    snprintf(output, output_size, "OK: appended %d bytes to %s (now %ld bytes)", (int)len, path, size);
+    append_dedup_note(output, output_size, &dedup);
+    ESP_LOGI(TAG, "append: %s (%d bytes)", path, (int)len);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+typedef struct {
+    const char *op;
+    esp_err_t (*execute)(const char *input_json, char *output, size_t output_size);
+} batch_op_t;
+
+static const batch_op_t s_batch_ops[] = {
+    { "read",   tool_read_file_execute },
+    { "grep",   tool_grep_file_execute },
+    { "write",  tool_write_file_execute },
+    { "append", append_execute },
+    { "edit",   tool_edit_file_execute },
+};
 
-    while ((ent = readdir(dir)) != NULL && off < output_size - 1) {
-        /* Build full path: SPIFFS entries are just filenames with embedded slashes */
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", MIMI_SPIFFS_BASE, ent->d_name);
+static const batch_op_t *batch_op_find(const char *op)
+{
+    for (size_t i = 0; op && i < sizeof(s_batch_ops) / sizeof(s_batch_ops[0]); i++) {
+        if (strcmp(s_batch_ops[i].op, op) == 0) return &s_batch_ops[i];
+    }
+    return NULL;
+}
 
-        if (prefix && strncmp(full_path, prefix, strlen(prefix)) != 0) {
+esp_err_t tool_file_batch_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cJSON *ops = cJSON_GetObjectItem(root, "ops");
+    int count = cJSON_IsArray(ops) ? cJSON_GetArraySize(ops) : 0;
+    if (count < 1 || count > MIMI_FILE_BATCH_MAX_OPS) {
+        snprintf(output, output_size, "Error: 'ops' must list 1-%d operations", MIMI_FILE_BATCH_MAX_OPS);
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+    cJSON *stop_item = cJSON_GetObjectItem(root, "stop_on_error");
+    bool stop_on_error = !cJSON_IsBool(stop_item) || cJSON_IsTrue(stop_item);
+
+    size_t off = 0;
+    int done = 0, failed = 0, index = 0;
+    bool stopped = false, truncated = false;
+    output[0] = '\0';
+    cJSON *item;
+    cJSON_ArrayForEach(item, ops) {
+        index++;
+        const char *op = cJSON_GetStringValue(cJSON_GetObjectItem(item, "op"));
+        const char *path = cJSON_GetStringValue(cJSON_GetObjectItem(item, "path"));
+        size_t start = off;
+        int head = snprintf(output + off, output_size - off, "[%d] %s %s: ", index,
+                            op ? op : "?", path ? path : "?");
+        if (head < 0 || (size_t)head >= output_size - off) {
+            truncated = true;
+            break;
+        }
+        off += head;
+
+        if (stopped) {
+            off += snprintf(output + off, output_size - off, "skipped\n");
+            if (off >= output_size - 1) {
+                off = start;
+                truncated = true;
+                break;
+            }
             continue;
         }
 
-        off += snprintf(output + off, output_size - off, "%s\n", full_path);
-        count++;
-    }
+        /* Reads get what the ops after them do not need; the op's share
+         * must still hold a result, or the batch ends here unrun */
+        size_t reserve = (size_t)(count - index) * BATCH_RESULT_MIN;
+        size_t room = output_size - off;
+        room = room > reserve + BATCH_RESULT_MIN ? room - reserve : room;
+        if (room < BATCH_RESULT_MIN) {
+            off = start;
+            output[off] = '\0';
+            truncated = true;
+            break;
+        }
 
-    closedir(dir);
+        const batch_op_t *b = batch_op_find(op);
+        char *args = b ? cJSON_PrintUnformatted(item) : NULL;
+        esp_err_t err;
+        if (!b) {
+            snprintf(output + off, room, "Error: unknown op (use read, grep, write, append or edit)");
+            err = ESP_ERR_INVALID_ARG;
+        } else if (!args) {
+            snprintf(output + off, room, "Error: out of memory");
+            err = ESP_ERR_NO_MEM;
+        } else {
+            err = b->execute(args, output + off, room);
+        }
+        free(args);
+
+        off += strlen(output + off);
+        if (off < output_size - 1 && (off == 0 || output[off - 1] != '\n')) output[off++] = '\n';
+        output[off] = '\0';
+        if (err == ESP_OK) {
+            done++;
+        } else {
+            failed++;
+            stopped = stop_on_error;
+        }
+    }
 
-    if (count == 0) {
-        snprintf(output, output_size, "(no files found)");
+    if (truncated) {
+        /* Overwrite the tail if needed so the note always fits */
+        const char *fmt = "[%d-%d] not run: output full, send them in another batch\n";
+        size_t need = (size_t)snprintf(NULL, 0, fmt, index, count) + 1;
+        if (off + need > output_size) off = output_size > need ? output_size - need : 0;
+        snprintf(output + off, output_size - off, fmt, index, count);
     }
 
-    ESP_LOGI(TAG, "list_dir: %d files (prefix=%s)", count, prefix ? prefix : "(none)");
+    ESP_LOGI(TAG, "file_batch: %d ops, %d ok, %d failed%s%s", count, done, failed,
+             stopped ? ", stopped" : "", truncated ? ", truncated" : "");
     cJSON_Delete(root);
-    return ESP_OK;
+    return (failed || truncated) && !done ? ESP_FAIL : ESP_OK;
 }
@@ -4,11 +4,21 @@
 #include <stddef.h>
 
 /**
- * Read a file from SPIFFS.
- * Input JSON: {"path": "/spiffs/..."}
+ * Read a file from SPIFFS, whole or a byte / line range.
+ * Input JSON: {"path": "/spiffs/...", "offset": 0, "length": 4096}
+ *          or {"path": "/spiffs/...", "line_start": 1, "line_count": 50} (all but path optional)
+ * A ranged or cut-off read ends with a [bytes|lines a-b of n] note saying where to continue.
  */
 esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t output_size);
 
+/**
+ * Print the lines of one file that contain pattern (plain text, case-insensitive
+ * unless case_sensitive is set), grep style with line numbers. Large files are
+ * streamed line by line.
+ * Input JSON: {"path": "/spiffs/...", "pattern": "...", "context": 2, "max_matches": 20}
+ */
+esp_err_t tool_grep_file_execute(const char *input_json, char *output, size_t output_size);
+
 /**
  * Write/overwrite a file on SPIFFS.
  * Input JSON: {"path": "/spiffs/...", "content": "..."}
@@ -16,8 +26,11 @@ esp_err_t tool_read_file_execute(const char *input_json, char *output, size_t ou
 esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t output_size);
 
 /**
- * Find-and-replace edit a file on SPIFFS.
- * Input JSON: {"path": "/spiffs/...", "old_string": "...", "new_string": "..."}
+ * Find-and-replace edit a file on SPIFFS, streamed so any file size works.
+ * Input JSON: {"path": "/spiffs/...", "old_string": "...", "new_string": "...", "count": 1}
+ *          or {"path": "/spiffs/...", "edits": [{"old_string": ..., "new_string": ..., "count": 0}, ...]}
+ * count defaults to 1; 0 replaces every occurrence. The file is written only
+ * if every edit matched.
  */
 esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t output_size);
 
@@ -26,3 +39,13 @@ esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t ou
  * Input JSON: {"prefix": "/spiffs/..."} (prefix is optional)
  */
 esp_err_t tool_list_dir_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * Run several file operations in order, in one tool call.
+ * Input JSON: {"ops": [{"op": "read"|"grep"|"write"|"append"|"edit", "path": ..., ...}, ...],
+ *              "stop_on_error": true}
+ * Each op takes the arguments of the matching tool; append takes path and
+ * content. Results are numbered per op; after a failure the rest are
+ * skipped unless stop_on_error is false.
+ */
+esp_err_t tool_file_batch_execute(const char *input_json, char *output, size_t output_size);
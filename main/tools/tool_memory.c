@@ -0,0 +1,127 @@
+#include "tools/tool_memory.h"
+#include "memory/memory_kv.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "cJSON.h"
+
+static const char *TAG = "tool_memory";
+
+#define KEY_RULES "keys are 1-47 chars of a-z, 0-9, '.', '_' or '-'"
+
+/* ── memory_set ─────────────────────────────────────────────── */
+
+esp_err_t tool_memory_set_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(root, "key"));
+    const char *value = cJSON_GetStringValue(cJSON_GetObjectItem(root, "value"));
+    if (!key || !value) {
+        snprintf(output, output_size, "Error: missing 'key' or 'value' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = memory_kv_set(key, value);
+    if (err == ESP_OK) {
+        snprintf(output, output_size, "OK: %s = %s", key, value);
+        ESP_LOGI(TAG, "memory_set: %s", key);
+    } else if (err == ESP_ERR_INVALID_ARG) {
+        snprintf(output, output_size, "Error: invalid key or value too long (%s; values under %d bytes)",
+                 KEY_RULES, MIMI_MEMORY_KV_VALUE_MAX);
+    } else if (err == ESP_ERR_NO_MEM) {
+        snprintf(output, output_size, "Error: memory full (%d keys); delete unused keys first",
+                 MIMI_MEMORY_KV_MAX_KEYS);
+    } else {
+        snprintf(output, output_size, "Error: failed to save %s", key);
+    }
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── memory_get ─────────────────────────────────────────────── */
+
+esp_err_t tool_memory_get_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(root, "key"));
+    if (!key) {
+        snprintf(output, output_size, "Error: missing 'key' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = memory_kv_get(key, output, output_size);
+    if (err == ESP_ERR_NOT_FOUND) {
+        snprintf(output, output_size, "Not found: %s", key);
+    } else if (err != ESP_OK) {
+        snprintf(output, output_size, "Error: invalid key (%s)", KEY_RULES);
+    }
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── memory_delete ──────────────────────────────────────────── */
+
+esp_err_t tool_memory_delete_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    const char *key = cJSON_GetStringValue(cJSON_GetObjectItem(root, "key"));
+    if (!key) {
+        snprintf(output, output_size, "Error: missing 'key' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = memory_kv_delete(key);
+    if (err == ESP_OK) {
+        snprintf(output, output_size, "OK: deleted %s", key);
+        ESP_LOGI(TAG, "memory_delete: %s", key);
+    } else if (err == ESP_ERR_NOT_FOUND) {
+        snprintf(output, output_size, "Not found: %s", key);
+    } else {
+        snprintf(output, output_size, "Error: failed to delete %s", key);
+    }
+    cJSON_Delete(root);
+    return err;
+}
+
+/* ── memory_list ────────────────────────────────────────────── */
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t off;
+} list_ctx_t;
+
+static bool append_fact(const char *key, const char *value, uint32_t ts, void *arg)
+{
+    list_ctx_t *c = arg;
+    if (c->off >= c->size - 1) return false;
+    c->off += snprintf(c->buf + c->off, c->size - c->off, "%s: %s\n", key, value);
+    return true;
+}
+
+esp_err_t tool_memory_list_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    const char *prefix = cJSON_GetStringValue(cJSON_GetObjectItem(root, "prefix"));
+
+    list_ctx_t ctx = { .buf = output, .size = output_size, .off = 0 };
+    output[0] = '\0';
+    int count = memory_kv_list(prefix, append_fact, &ctx);
+    if (count == 0) {
+        snprintf(output, output_size, "(no facts stored%s%s)", prefix ? " under " : "", prefix ? prefix : "");
+    }
+
+    ESP_LOGI(TAG, "memory_list: %d keys (prefix=%s)", count, prefix ? prefix : "(none)");
+    cJSON_Delete(root);
+    return ESP_OK;
+}
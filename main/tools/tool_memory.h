@@ -0,0 +1,28 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/**
+ * Store a fact in key-value memory.
+ * Input JSON: {"key": "user.name", "value": "..."}
+ */
+esp_err_t tool_memory_set_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * Look up a fact by key.
+ * Input JSON: {"key": "user.name"}
+ */
+esp_err_t tool_memory_get_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * Remove a fact by key.
+ * Input JSON: {"key": "user.name"}
+ */
+esp_err_t tool_memory_delete_execute(const char *input_json, char *output, size_t output_size);
+
+/**
+ * List stored facts, optionally only keys starting with a prefix.
+ * Input JSON: {"prefix": "user."} (prefix is optional)
+ */
+esp_err_t tool_memory_list_execute(const char *input_json, char *output, size_t output_size);
@@ -3,6 +3,8 @@
 #include "tools/tool_get_time.h"
 #include "tools/tool_files.h"
 #include "tools/tool_cron.h"
+#include "tools/tool_search.h"
+#include "tools/tool_memory.h"
 
 #include <string.h>
 #include "esp_log.h"
@@ -10,7 +12,7 @@
 
 static const char *TAG = "tools";
 
-#define MAX_TOOLS 12
+#define MAX_TOOLS 20
 
 static mimi_tool_t s_tools[MAX_TOOLS];
 static int s_tool_count = 0;
@@ -59,11 +61,13 @@ esp_err_t tool_registry_init(void)
 
     mimi_tool_t ws = {
         .name = "web_search",
-        .description = "Search the web for current information. Use this when you need up-to-date facts, news, weather, or anything beyond your training data.",
+        .description = "Search the web for current information. Use this when you need up-to-date facts, news, weather, or anything beyond your training data. To look into several angles at once, pass queries: they run in parallel and come back as one list without duplicate URLs, each result tagged with the numbers of the queries that found it.",
         .input_schema_json =
             "{\"type\":\"object\","
-            "\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"The search query\"}},"
-            "\"required\":[\"query\"]}",
+            "\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"The search query\"},"
+            "\"queries\":{\"type\":\"array\",\"items\":{\"type\":\"string\"},"
+            "\"description\":\"Several search queries run together instead of one call each (max 4)\"}},"
+            "\"required\":[]}",
         .execute = tool_web_search_execute,
     };
     register_tool(&ws);
@@ -71,7 +75,7 @@ esp_err_t tool_registry_init(void)
     /* Register get_current_time */
     mimi_tool_t gt = {
         .name = "get_current_time",
-        .description = "Get the current date and time. Also sets the system clock. Call this when you need to know what time or date it is.",
+        .description = "Get the current date and time from the device clock, which syncs itself. The turn context already gives current_time; call this only when you need it to the second or the clock is not set.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{},"
@@ -83,15 +87,35 @@ esp_err_t tool_registry_init(void)
     /* Register read_file */
     mimi_tool_t rf = {
         .name = "read_file",
-        .description = "Read a file from SPIFFS storage. Path must start with /spiffs/.",
+        .description = "Read a file from SPIFFS storage. Path must start with /spiffs/. For large files pass a line range (line_start/line_count) or byte range (offset/length); the result ends with a note saying where to continue.",
         .input_schema_json =
             "{\"type\":\"object\","
-            "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with /spiffs/\"}},"
+            "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with /spiffs/\"},"
+            "\"offset\":{\"type\":\"integer\",\"description\":\"Optional byte offset to start at\"},"
+            "\"length\":{\"type\":\"integer\",\"description\":\"Optional number of bytes to read\"},"
+            "\"line_start\":{\"type\":\"integer\",\"description\":\"Optional first line to read, starting at 1\"},"
+            "\"line_count\":{\"type\":\"integer\",\"description\":\"Optional number of lines to read\"}},"
             "\"required\":[\"path\"]}",
         .execute = tool_read_file_execute,
     };
     register_tool(&rf);
 
+    /* Register grep_file */
+    mimi_tool_t gf = {
+        .name = "grep_file",
+        .description = "Find the lines of one file that contain a text pattern. Returns line:text, with optional context lines. Cheaper than reading a large file.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with /spiffs/\"},"
+            "\"pattern\":{\"type\":\"string\",\"description\":\"Plain text to look for (not a regex)\"},"
+            "\"context\":{\"type\":\"integer\",\"description\":\"Lines to show before and after each match (default 0, max 5)\"},"
+            "\"max_matches\":{\"type\":\"integer\",\"description\":\"Maximum matches to return (default 20, max 50)\"},"
+            "\"case_sensitive\":{\"type\":\"boolean\",\"description\":\"Match case exactly (default false)\"}},"
+            "\"required\":[\"path\",\"pattern\"]}",
+        .execute = tool_grep_file_execute,
+    };
+    register_tool(&gf);
+
     /* Register write_file */
     mimi_tool_t wf = {
         .name = "write_file",
@@ -108,17 +132,44 @@ esp_err_t tool_registry_init(void)
     /* Register edit_file */
     mimi_tool_t ef = {
         .name = "edit_file",
-        .description = "Find and replace text in a file on SPIFFS. Replaces first occurrence of old_string with new_string.",
+        .description = "Find and replace text in a file on SPIFFS. Replaces the first occurrence of old_string with new_string, or count occurrences (0 = all). Pass several changes to one file at once as edits; they all apply or none do. Reports how many matches each edit had.",
         .input_schema_json =
             "{\"type\":\"object\","
             "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with /spiffs/\"},"
             "\"old_string\":{\"type\":\"string\",\"description\":\"Text to find\"},"
-            "\"new_string\":{\"type\":\"string\",\"description\":\"Replacement text\"}},"
-            "\"required\":[\"path\",\"old_string\",\"new_string\"]}",
+            "\"new_string\":{\"type\":\"string\",\"description\":\"Replacement text\"},"
+            "\"count\":{\"type\":\"integer\",\"description\":\"Occurrences to replace (default 1, 0 = all)\"},"
+            "\"edits\":{\"type\":\"array\",\"description\":\"Several replacements instead of old_string/new_string, applied in one pass over the original text\","
+            "\"items\":{\"type\":\"object\",\"properties\":{"
+            "\"old_string\":{\"type\":\"string\"},\"new_string\":{\"type\":\"string\"},\"count\":{\"type\":\"integer\"}},"
+            "\"required\":[\"old_string\",\"new_string\"]}}},"
+            "\"required\":[\"path\"]}",
         .execute = tool_edit_file_execute,
     };
     register_tool(&ef);
 
+    /* Register file_batch */
+    mimi_tool_t fb = {
+        .name = "file_batch",
+        .description = "Run several file operations in order in one call: read, grep, write, append, edit. Each op takes the same arguments as the matching tool (append: path, content). Returns a numbered result per op; after a failure the rest are skipped unless stop_on_error is false.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"ops\":{\"type\":\"array\",\"description\":\"Operations to run in order (max 8)\","
+            "\"items\":{\"type\":\"object\",\"properties\":{"
+            "\"op\":{\"type\":\"string\",\"enum\":[\"read\",\"grep\",\"write\",\"append\",\"edit\"]},"
+            "\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with /spiffs/\"},"
+            "\"content\":{\"type\":\"string\",\"description\":\"write / append: text to store\"},"
+            "\"old_string\":{\"type\":\"string\"},\"new_string\":{\"type\":\"string\"},"
+            "\"edits\":{\"type\":\"array\",\"items\":{\"type\":\"object\"}},"
+            "\"pattern\":{\"type\":\"string\",\"description\":\"grep: text to find\"},"
+            "\"line_start\":{\"type\":\"integer\"},\"line_count\":{\"type\":\"integer\"}},"
+            "\"required\":[\"op\",\"path\"]}},"
+            "\"stop_on_error\":{\"type\":\"boolean\",\"description\":\"Skip the remaining ops after a failure (default true)\"}},"
+            "\"required\":[\"ops\"]}",
+        .execute = tool_file_batch_execute,
+    };
+    register_tool(&fb);
+
     /* Register list_dir */
     mimi_tool_t ld = {
         .name = "list_dir",
@@ -131,6 +182,69 @@ esp_err_t tool_registry_init(void)
     };
     register_tool(&ld);
 
+    /* Register search_files */
+    mimi_tool_t sf = {
+        .name = "search_files",
+        .description = "Full-text search over memory, skill and config files. Returns matching lines as path:line: text, best first. Use before reading whole files.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"Words to search for\"},"
+            "\"max_results\":{\"type\":\"integer\",\"description\":\"Maximum lines to return (default 8, max 20)\"},"
+            "\"prefix\":{\"type\":\"string\",\"description\":\"Optional path prefix filter, e.g. /spiffs/memory/\"}},"
+            "\"required\":[\"query\"]}",
+        .execute = tool_search_files_execute,
+    };
+    register_tool(&sf);
+
+    /* Register memory_set */
+    mimi_tool_t ms = {
+        .name = "memory_set",
+        .description = "Remember a fact as a key-value pair, replacing any previous value. No need to read memory first. Use dotted keys like user.name or pref.units.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"key\":{\"type\":\"string\",\"description\":\"Lowercase key of a-z, 0-9, '.', '_' or '-', e.g. user.city\"},"
+            "\"value\":{\"type\":\"string\",\"description\":\"Value to store (short text)\"}},"
+            "\"required\":[\"key\",\"value\"]}",
+        .execute = tool_memory_set_execute,
+    };
+    register_tool(&ms);
+
+    /* Register memory_get */
+    mimi_tool_t mg = {
+        .name = "memory_get",
+        .description = "Look up a remembered fact by key.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"key\":{\"type\":\"string\",\"description\":\"Key to look up\"}},"
+            "\"required\":[\"key\"]}",
+        .execute = tool_memory_get_execute,
+    };
+    register_tool(&mg);
+
+    /* Register memory_delete */
+    mimi_tool_t md = {
+        .name = "memory_delete",
+        .description = "Forget a remembered fact by key.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"key\":{\"type\":\"string\",\"description\":\"Key to delete\"}},"
+            "\"required\":[\"key\"]}",
+        .execute = tool_memory_delete_execute,
+    };
+    register_tool(&md);
+
+    /* Register memory_list */
+    mimi_tool_t ml = {
+        .name = "memory_list",
+        .description = "List remembered facts as key: value lines, optionally filtered by key prefix.",
+        .input_schema_json =
+            "{\"type\":\"object\","
+            "\"properties\":{\"prefix\":{\"type\":\"string\",\"description\":\"Optional key prefix, e.g. user.\"}},"
+            "\"required\":[]}",
+        .execute = tool_memory_list_execute,
+    };
+    register_tool(&ml);
+
     /* Register cron_add */
     mimi_tool_t ca = {
         .name = "cron_add",
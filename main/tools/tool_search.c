@@ -0,0 +1,137 @@
+#include "tools/tool_search.h"
+#include "search/search_index.h"
+#include "storage/file_cache.h"
+#include "mimi_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+
+static const char *TAG = "tool_search";
+
+#define DEFAULT_RESULTS  8
+#define SNIPPET_MAX      160
+#define SNIPPET_FILE_MAX (256 * 1024)
+
+typedef struct {
+    search_hit_t hit;
+    char snippet[SNIPPET_MAX + 4];
+} result_t;
+
+static int cmp_by_location(const void *a, const void *b)
+{
+    const result_t *const *ra = a, *const *rb = b;
+    int c = strcmp((*ra)->hit.path, (*rb)->hit.path);
+    return c ? c : (int)(*ra)->hit.line - (int)(*rb)->hit.line;
+}
+
+static void set_snippet(result_t *r, const char *line)
+{
+    while (*line == ' ' || *line == '\t') line++;
+    size_t len = strcspn(line, "\r\n");
+    if (len > SNIPPET_MAX) {
+        memcpy(r->snippet, line, SNIPPET_MAX);
+        strcpy(r->snippet + SNIPPET_MAX, "...");
+    } else {
+        memcpy(r->snippet, line, len);
+        r->snippet[len] = '\0';
+    }
+}
+
+/* Fill snippets reading each file once, hits sorted by (path, line). */
+static void load_snippets(result_t **order, int count)
+{
+    for (int i = 0; i < count;) {
+        const char *path = order[i]->hit.path;
+        size_t len = 0;
+        char *text = file_cache_read_alloc(path, SNIPPET_FILE_MAX, &len);
+        const char *line = text;
+        int lineno = 1;
+
+        for (; i < count && strcmp(order[i]->hit.path, path) == 0; i++) {
+            result_t *r = order[i];
+            if (!text) {
+                strcpy(r->snippet, "(file unavailable)");
+                continue;
+            }
+            /* Skip to the hit's line */
+            while (line && lineno < r->hit.line) {
+                line = strchr(line, '\n');
+                if (line) {
+                    line++;
+                    lineno++;
+                }
+            }
+            if (line && *line) {
+                set_snippet(r, line);
+            } else {
+                strcpy(r->snippet, "(line changed)");
+            }
+        }
+        free(text);
+    }
+}
+
+esp_err_t tool_search_files_execute(const char *input_json, char *output, size_t output_size)
+{
+    cJSON *root = cJSON_Parse(input_json);
+    if (!root) {
+        snprintf(output, output_size, "Error: invalid JSON input");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *query = cJSON_GetStringValue(cJSON_GetObjectItem(root, "query"));
+    const char *prefix = cJSON_GetStringValue(cJSON_GetObjectItem(root, "prefix"));
+    cJSON *max_item = cJSON_GetObjectItem(root, "max_results");
+    int max_results = cJSON_IsNumber(max_item) ? max_item->valueint : DEFAULT_RESULTS;
+    if (max_results < 1) max_results = 1;
+    if (max_results > MIMI_SEARCH_MAX_RESULTS) max_results = MIMI_SEARCH_MAX_RESULTS;
+
+    if (!query || !query[0]) {
+        snprintf(output, output_size, "Error: missing 'query' field");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    result_t *results = heap_caps_calloc(max_results, sizeof(result_t), MALLOC_CAP_SPIRAM);
+    search_hit_t *hits = heap_caps_calloc(max_results, sizeof(search_hit_t), MALLOC_CAP_SPIRAM);
+    result_t **order = heap_caps_calloc(max_results, sizeof(result_t *), MALLOC_CAP_SPIRAM);
+    if (!results || !hits || !order) {
+        free(results);
+        free(hits);
+        free(order);
+        snprintf(output, output_size, "Error: out of memory");
+        cJSON_Delete(root);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int count = search_index_query(query, prefix, hits, max_results);
+    if (count < 0) {
+        snprintf(output, output_size, "Error: search index unavailable");
+    } else if (count == 0) {
+        snprintf(output, output_size, "No matches for \"%s\"", query);
+    } else {
+        for (int i = 0; i < count; i++) {
+            results[i].hit = hits[i];
+            order[i] = &results[i];
+        }
+        qsort(order, count, sizeof(result_t *), cmp_by_location);
+        load_snippets(order, count);
+
+        size_t off = snprintf(output, output_size, "%d matches for \"%s\":\n", count, query);
+        for (int i = 0; i < count && off < output_size - 1; i++) {
+            off += snprintf(output + off, output_size - off, "%s:%u: %s\n",
+                            results[i].hit.path, results[i].hit.line, results[i].snippet);
+        }
+    }
+
+    ESP_LOGI(TAG, "search_files: \"%s\" -> %d hits", query, count);
+    free(results);
+    free(hits);
+    free(order);
+    cJSON_Delete(root);
+    return count < 0 ? ESP_FAIL : ESP_OK;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/**
+ * Full-text search over config, memory and skill files.
+ * Input JSON: {"query": "...", "max_results": 8, "prefix": "/spiffs/memory/"}
+ * (max_results and prefix are optional). Returns "path:line: text" lines, best first.
+ */
+esp_err_t tool_search_files_execute(const char *input_json, char *output, size_t output_size);
@@ -1,10 +1,19 @@
 #include "tool_web_search.h"
 #include "mimi_config.h"
 #include "proxy/http_proxy.h"
+#include "proxy/http_body.h"
+#include "tools/json_stream.h"
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
@@ -15,35 +24,213 @@ static const char *TAG = "web_search";
 
 static char s_search_key[128] = {0};
 
-#define SEARCH_BUF_SIZE     (16 * 1024)
-#define SEARCH_RESULT_COUNT 5
-
-/* ── Response accumulator ─────────────────────────────────────── */
+#define SEARCH_HOST         "api.search.brave.com"
+#define SEARCH_RESULT_COUNT 5       /* Results asked for per query */
+#define SEARCH_QUERY_MAX    128
+#define SEARCH_TITLE_MAX    160
+#define SEARCH_URL_MAX      256
+#define SEARCH_DESC_MAX     512
+
+/* ── Result extraction ────────────────────────────────────────── */
+
+/*
+ * Each response is parsed as it arrives and only
+ * web.results[i].{title,url,description} are kept, in fixed slots.
+ * Memory is the same whatever the response size; nothing beyond the
+ * fields is buffered.
+ */
+typedef struct {
+    char title[SEARCH_TITLE_MAX];
+    char url[SEARCH_URL_MAX];
+    char desc[SEARCH_DESC_MAX];
+} search_hit_t;
 
+/* One query of a web_search call, run on the caller or a worker task. */
 typedef struct {
-    char *data;
-    size_t len;
-    size_t cap;
-} search_buf_t;
+    char query[SEARCH_QUERY_MAX];
+    char path[384];
+    bool proxied;
+    int count;                  /* Complete hits */
+    int index;                  /* results[] element filling hit[count], -1 if none */
+    search_hit_t hit[SEARCH_RESULT_COUNT];
+    json_stream_t js;
+    json_stream_status_t js_status;
+    http_body_t *body;
+    esp_err_t err;
+    SemaphoreHandle_t done;     /* Given by the worker task when finished */
+} search_job_t;
+
+static bool on_value(const json_stream_t *js, const char *value, size_t len, bool truncated,
+                     void *ctx)
+{
+    search_job_t *job = ctx;
+
+    /* web.results[i].field: root object, web object, results array, result object */
+    if (js->depth != 4) return true;
+    const char *web = json_stream_key(js, 0);
+    const char *results = json_stream_key(js, 1);
+    const char *field = json_stream_key(js, 3);
+    int i = json_stream_index(js, 2);
+    if (!web || strcmp(web, "web") != 0 || !results || strcmp(results, "results") != 0 ||
+        i < 0 || !field) {
+        return true;
+    }
+
+    if (i != job->index) {
+        if (job->index >= 0) job->count++;
+        job->index = -1;
+        if (job->count >= SEARCH_RESULT_COUNT) return false;
+        job->index = i;
+    }
+
+    search_hit_t *h = &job->hit[job->count];
+    if (strcmp(field, "title") == 0) {
+        snprintf(h->title, sizeof(h->title), "%s", value);
+    } else if (strcmp(field, "url") == 0) {
+        snprintf(h->url, sizeof(h->url), "%s", value);
+    } else if (strcmp(field, "description") == 0) {
+        snprintf(h->desc, sizeof(h->desc), "%s", value);
+    }
+    return true;
+}
+
+/* Decoded body bytes go straight into the JSON parser. */
+static bool body_sink(const char *data, size_t len, void *ctx)
+{
+    search_job_t *job = ctx;
+    job->js_status = json_stream_feed(&job->js, data, len);
+    return job->js_status == JSON_STREAM_MORE;
+}
 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
-    search_buf_t *sb = (search_buf_t *)evt->user_data;
-    if (evt->event_id == HTTP_EVENT_ON_DATA) {
-        size_t needed = sb->len + evt->data_len;
-        if (needed < sb->cap) {
-            memcpy(sb->data + sb->len, evt->data, evt->data_len);
-            sb->len += evt->data_len;
-            sb->data[sb->len] = '\0';
+    search_job_t *job = (search_job_t *)evt->user_data;
+    if (!job) return ESP_OK;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        http_body_header(job->body, evt->header_key, evt->header_value);
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        /* An error body is not parsed; the status is checked after perform */
+        if (esp_http_client_get_status_code(evt->client) != 200 ||
+            http_body_finished(job->body)) {
+            return ESP_OK;
         }
+        http_body_feed(job->body, evt->data, evt->data_len);
     }
     return ESP_OK;
 }
 
+/* ── Connection pool ──────────────────────────────────────────── */
+
+/*
+ * Direct requests reuse kept-alive HTTPS connections to the API, so a
+ * search soon after another skips the TLS handshake. Parallel queries
+ * beyond the pool get a connection of their own, closed afterwards. One
+ * idle for longer than MIMI_WEB_SEARCH_IDLE_MS is closed at the next
+ * search rather than reused, as the server has likely dropped it.
+ */
+typedef struct {
+    esp_http_client_handle_t client;
+    int64_t idle_since_us;
+    bool busy;
+} pool_slot_t;
+
+static pool_slot_t s_pool[MIMI_WEB_SEARCH_POOL];
+static SemaphoreHandle_t s_pool_lock = NULL;
+
+static esp_http_client_handle_t client_open(void)
+{
+    esp_http_client_config_t config = {
+        .url = "https://" SEARCH_HOST "/",
+        .event_handler = http_event_handler,
+        .timeout_ms = MIMI_WEB_SEARCH_TIMEOUT_MS,
+        .buffer_size = 4096,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) return NULL;
+    esp_http_client_set_header(client, "Accept", "application/json");
+    esp_http_client_set_header(client, "Accept-Encoding", "gzip");
+    return client;
+}
+
+/*
+ * A connection for one request. *slot is its pool slot, or -1 when the
+ * pool is all busy; *reused tells whether it may already be connected.
+ */
+static esp_http_client_handle_t pool_take(int *slot, bool *reused)
+{
+    esp_http_client_handle_t stale[MIMI_WEB_SEARCH_POOL];
+    int n_stale = 0;
+    int64_t now = esp_timer_get_time();
+    *slot = -1;
+    *reused = false;
+
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    int empty = -1;
+    for (int i = 0; i < MIMI_WEB_SEARCH_POOL; i++) {
+        pool_slot_t *p = &s_pool[i];
+        if (p->busy) continue;
+        if (p->client && now - p->idle_since_us > (int64_t)MIMI_WEB_SEARCH_IDLE_MS * 1000) {
+            stale[n_stale++] = p->client;
+            p->client = NULL;
+        }
+        if (p->client && *slot < 0) *slot = i;
+        if (!p->client && empty < 0) empty = i;
+    }
+    if (*slot >= 0) {
+        *reused = true;
+    } else {
+        *slot = empty;
+    }
+    if (*slot >= 0) s_pool[*slot].busy = true;
+    esp_http_client_handle_t client = *slot >= 0 ? s_pool[*slot].client : NULL;
+    xSemaphoreGive(s_pool_lock);
+
+    for (int i = 0; i < n_stale; i++) esp_http_client_cleanup(stale[i]);
+
+    /* A busy slot belongs to this request until pool_give() */
+    if (!client) {
+        client = client_open();
+        if (*slot >= 0 && client) {
+            s_pool[*slot].client = client;
+        } else if (*slot >= 0) {
+            xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+            s_pool[*slot].busy = false;
+            xSemaphoreGive(s_pool_lock);
+        }
+    }
+    return client;
+}
+
+/* Return a connection; keep it only if its last request went through. */
+static void pool_give(int slot, esp_http_client_handle_t client, bool keep)
+{
+    esp_http_client_set_user_data(client, NULL);
+    if (slot >= 0 && keep) {
+        xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+        s_pool[slot].idle_since_us = esp_timer_get_time();
+        s_pool[slot].busy = false;
+        xSemaphoreGive(s_pool_lock);
+        return;
+    }
+
+    esp_http_client_cleanup(client);
+    if (slot >= 0) {
+        xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+        s_pool[slot].client = NULL;
+        s_pool[slot].busy = false;
+        xSemaphoreGive(s_pool_lock);
+    }
+}
+
 /* ── Init ─────────────────────────────────────────────────────── */
 
 esp_err_t tool_web_search_init(void)
 {
+    if (!s_pool_lock) s_pool_lock = xSemaphoreCreateMutex();
+    if (!s_pool_lock) return ESP_ERR_NO_MEM;
+
     /* Start with build-time default */
     if (MIMI_SECRET_SEARCH_KEY[0] != '\0') {
         strncpy(s_search_key, MIMI_SECRET_SEARCH_KEY, sizeof(s_search_key) - 1);
@@ -92,134 +279,267 @@ static size_t url_encode(const char *src, char *dst, size_t dst_size)
     return pos;
 }
 
-/* ── Format results as readable text ──────────────────────────── */
-
-static void format_results(cJSON *root, char *output, size_t output_size)
-{
-    cJSON *web = cJSON_GetObjectItem(root, "web");
-    if (!web) {
-        snprintf(output, output_size, "No web results found.");
-        return;
-    }
-
-    cJSON *results = cJSON_GetObjectItem(web, "results");
-    if (!results || !cJSON_IsArray(results) || cJSON_GetArraySize(results) == 0) {
-        snprintf(output, output_size, "No web results found.");
-        return;
-    }
-
-    size_t off = 0;
-    int idx = 0;
-    cJSON *item;
-    cJSON_ArrayForEach(item, results) {
-        if (idx >= SEARCH_RESULT_COUNT) break;
-
-        cJSON *title = cJSON_GetObjectItem(item, "title");
-        cJSON *url = cJSON_GetObjectItem(item, "url");
-        cJSON *desc = cJSON_GetObjectItem(item, "description");
-
-        off += snprintf(output + off, output_size - off,
-            "%d. %s\n   %s\n   %s\n\n",
-            idx + 1,
-            (title && cJSON_IsString(title)) ? title->valuestring : "(no title)",
-            (url && cJSON_IsString(url)) ? url->valuestring : "",
-            (desc && cJSON_IsString(desc)) ? desc->valuestring : "");
-
-        if (off >= output_size - 1) break;
-        idx++;
-    }
-}
-
 /* ── Direct HTTPS request ─────────────────────────────────────── */
 
-static esp_err_t search_direct(const char *url, search_buf_t *sb)
+static esp_err_t search_direct(search_job_t *job)
 {
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .user_data = sb,
-        .timeout_ms = 15000,
-        .buffer_size = 4096,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-    };
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) return ESP_FAIL;
-
-    esp_http_client_set_header(client, "Accept", "application/json");
-    esp_http_client_set_header(client, "X-Subscription-Token", s_search_key);
-
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    char url[512];
+    snprintf(url, sizeof(url), "https://" SEARCH_HOST "%s", job->path);
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int slot;
+        bool reused;
+        esp_http_client_handle_t client = pool_take(&slot, &reused);
+        if (!client) return ESP_FAIL;
+
+        esp_http_client_set_url(client, url);
+        esp_http_client_set_user_data(client, job);
+        esp_http_client_set_header(client, "X-Subscription-Token", s_search_key);
+
+        esp_err_t err = esp_http_client_perform(client);
+        int status = esp_http_client_get_status_code(client);
+        pool_give(slot, client, err == ESP_OK);
+
+        /* A kept-alive connection the server has closed fails before any data */
+        size_t wire = 0;
+        http_body_sizes(job->body, &wire, NULL);
+        if (err != ESP_OK && reused && wire == 0) {
+            ESP_LOGD(TAG, "Pooled connection dropped, reconnecting");
+            continue;
+        }
 
-    if (err != ESP_OK) return err;
-    if (status != 200) {
-        ESP_LOGE(TAG, "Search API returned %d", status);
-        return ESP_FAIL;
+        if (err != ESP_OK) return err;
+        if (status != 200) {
+            ESP_LOGE(TAG, "Search API returned %d", status);
+            return ESP_FAIL;
+        }
+        return ESP_OK;
     }
-    return ESP_OK;
+    return ESP_FAIL;
 }
 
 /* ── Proxy HTTPS request ──────────────────────────────────────── */
 
-static esp_err_t search_via_proxy(const char *path, search_buf_t *sb)
+static esp_err_t search_via_proxy(search_job_t *job)
 {
-    proxy_conn_t *conn = proxy_conn_open("api.search.brave.com", 443, 15000);
+    proxy_conn_t *conn = proxy_conn_open(SEARCH_HOST, 443, MIMI_WEB_SEARCH_TIMEOUT_MS);
     if (!conn) return ESP_ERR_HTTP_CONNECT;
 
     char header[512];
     int hlen = snprintf(header, sizeof(header),
         "GET %s HTTP/1.1\r\n"
-        "Host: api.search.brave.com\r\n"
+        "Host: " SEARCH_HOST "\r\n"
         "Accept: application/json\r\n"
+        "Accept-Encoding: gzip\r\n"
         "X-Subscription-Token: %s\r\n"
         "Connection: close\r\n\r\n",
-        path, s_search_key);
+        job->path, s_search_key);
 
     if (proxy_conn_write(conn, header, hlen) < 0) {
         proxy_conn_close(conn);
         return ESP_ERR_HTTP_WRITE_DATA;
     }
 
-    /* Read full response */
+    /* Decode as it arrives; stop reading once the results are in */
     char tmp[4096];
-    size_t total = 0;
-    while (1) {
-        int n = proxy_conn_read(conn, tmp, sizeof(tmp), 15000);
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && !http_body_finished(job->body)) {
+        int n = proxy_conn_read(conn, tmp, sizeof(tmp), MIMI_WEB_SEARCH_TIMEOUT_MS);
         if (n <= 0) break;
-        size_t copy = (total + n < sb->cap - 1) ? (size_t)n : sb->cap - 1 - total;
-        if (copy > 0) {
-            memcpy(sb->data + total, tmp, copy);
-            total += copy;
-        }
+        err = http_body_feed(job->body, tmp, n);
     }
-    sb->data[total] = '\0';
-    sb->len = total;
     proxy_conn_close(conn);
 
-    /* Check status */
-    int status = 0;
-    if (total > 5 && strncmp(sb->data, "HTTP/", 5) == 0) {
-        const char *sp = strchr(sb->data, ' ');
-        if (sp) status = atoi(sp + 1);
+    int status = http_body_status(job->body);
+    if (status != 200) {
+        ESP_LOGE(TAG, "Search API returned %d via proxy", status);
+        return ESP_FAIL;
     }
+    return err;
+}
+
+/* ── Queries ──────────────────────────────────────────────────── */
 
-    /* Strip headers */
-    char *body = strstr(sb->data, "\r\n\r\n");
-    if (body) {
-        body += 4;
-        size_t blen = total - (body - sb->data);
-        memmove(sb->data, body, blen);
-        sb->len = blen;
-        sb->data[sb->len] = '\0';
+static void job_run(search_job_t *job)
+{
+    job->index = -1;
+    json_stream_init(&job->js, on_value, job);
+    job->body = http_body_create(job->proxied, body_sink, job);
+    if (!job->body) {
+        job->err = ESP_ERR_NO_MEM;
+        return;
     }
 
-    if (status != 200) {
-        ESP_LOGE(TAG, "Search API returned %d via proxy", status);
-        return ESP_FAIL;
+    job->err = job->proxied ? search_via_proxy(job) : search_direct(job);
+    if (job->index >= 0) job->count++;
+    job->index = -1;
+
+    size_t wire = 0, decoded = 0;
+    http_body_sizes(job->body, &wire, &decoded);
+    ESP_LOGI(TAG, "\"%s\": %d results, %u bytes received, %u decoded", job->query,
+             job->count, (unsigned)wire, (unsigned)decoded);
+    http_body_destroy(job->body);
+    job->body = NULL;
+}
+
+static void job_task(void *arg)
+{
+    search_job_t *job = arg;
+    job_run(job);
+    xSemaphoreGive(job->done);
+    vTaskDelete(NULL);
+}
+
+/* The first query runs on the caller, the others on worker tasks in parallel. */
+static void run_jobs(search_job_t *jobs, int n)
+{
+    for (int i = 1; i < n; i++) {
+        jobs[i].done = xSemaphoreCreateBinary();
+        if (!jobs[i].done ||
+            xTaskCreatePinnedToCore(job_task, "web_search", MIMI_WEB_SEARCH_STACK, &jobs[i],
+                                    MIMI_WEB_SEARCH_PRIO, NULL, MIMI_WEB_SEARCH_CORE) != pdPASS) {
+            /* Not fatal: it runs here after the others */
+            ESP_LOGW(TAG, "No worker for query %d, running it in turn", i + 1);
+            if (jobs[i].done) vSemaphoreDelete(jobs[i].done);
+            jobs[i].done = NULL;
+        }
+    }
+
+    job_run(&jobs[0]);
+    for (int i = 1; i < n; i++) {
+        if (jobs[i].done) {
+            xSemaphoreTake(jobs[i].done, portMAX_DELAY);
+            vSemaphoreDelete(jobs[i].done);
+        } else {
+            job_run(&jobs[i]);
+        }
+    }
+}
+
+static bool add_query(const char *q, const char **queries, int *n)
+{
+    if (!q || !q[0] || *n >= MIMI_WEB_SEARCH_MAX_QUERIES) return false;
+    for (int i = 0; i < *n; i++) {
+        if (strcasecmp(queries[i], q) == 0) return false;
+    }
+    queries[(*n)++] = q;
+    return true;
+}
+
+/* query and queries[] together, without repeats; returns how many. */
+static int collect_queries(cJSON *input, const char **queries)
+{
+    int n = 0;
+    cJSON *query = cJSON_GetObjectItem(input, "query");
+    if (cJSON_IsString(query)) add_query(query->valuestring, queries, &n);
+
+    cJSON *list = cJSON_GetObjectItem(input, "queries");
+    cJSON *item;
+    if (cJSON_IsArray(list)) {
+        cJSON_ArrayForEach(item, list) {
+            if (cJSON_IsString(item)) add_query(item->valuestring, queries, &n);
+        }
+    }
+    return n;
+}
+
+/* ── Merge and format ─────────────────────────────────────────── */
+
+typedef struct {
+    const search_hit_t *hit;
+    uint32_t queries;           /* Bit per query that returned it */
+} merged_hit_t;
+
+/* URL without scheme, "www.", fragment or trailing '/', lowercased */
+static void url_key(const char *url, char *key, size_t size)
+{
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    if (strncasecmp(p, "www.", 4) == 0) p += 4;
+    size_t n = strcspn(p, "#");
+    while (n > 0 && p[n - 1] == '/') n--;
+    if (n >= size) n = size - 1;
+    for (size_t i = 0; i < n; i++) key[i] = (char)tolower((unsigned char)p[i]);
+    key[n] = '\0';
+}
+
+static bool same_url(const char *a, const char *b)
+{
+    char ka[SEARCH_URL_MAX], kb[SEARCH_URL_MAX];
+    url_key(a, ka, sizeof(ka));
+    url_key(b, kb, sizeof(kb));
+    return ka[0] && strcmp(ka, kb) == 0;
+}
+
+/* Interleave by rank (every query's first result, then the seconds...), dropping repeats. */
+static int merge_hits(const search_job_t *jobs, int n, merged_hit_t *out)
+{
+    int m = 0;
+    for (int r = 0; r < SEARCH_RESULT_COUNT; r++) {
+        for (int q = 0; q < n; q++) {
+            if (r >= jobs[q].count) continue;
+            const search_hit_t *h = &jobs[q].hit[r];
+            int j = 0;
+            while (j < m && !same_url(out[j].hit->url, h->url)) j++;
+            if (j < m) {
+                out[j].queries |= 1u << q;
+                continue;
+            }
+            out[m].hit = h;
+            out[m].queries = 1u << q;
+            m++;
+        }
+    }
+    return m;
+}
+
+/* Append at most max bytes of text, cut at a UTF-8 boundary and marked with "..." */
+static void append_cut(char *out, size_t size, size_t *off, const char *text, size_t max)
+{
+    size_t len = strlen(text);
+    const char *more = "";
+    if (len > max) {
+        len = max > 3 ? max - 3 : 0;
+        while (len > 0 && ((unsigned char)text[len] & 0xC0) == 0x80) len--;
+        more = "...";
+    }
+    int n = snprintf(out + *off, size - *off, "%.*s%s", (int)len, text, len ? more : "");
+    *off += n > 0 ? (size_t)n : 0;
+    if (*off > size - 1) *off = size - 1;
+}
+
+/*
+ * Each result gets an even share of the space still left, so a long
+ * description never crowds out the results after it; only descriptions
+ * are shortened.
+ */
+static void format_hits(const merged_hit_t *hits, int count, int n_queries,
+                        char *output, size_t output_size, size_t off)
+{
+    for (int i = 0; i < count && off < output_size - 1; i++) {
+        const search_hit_t *h = hits[i].hit;
+        size_t share = (output_size - 1 - off) / (count - i);
+
+        char tags[8 + 3 * MIMI_WEB_SEARCH_MAX_QUERIES] = "";
+        if (n_queries > 1) {
+            size_t t = snprintf(tags, sizeof(tags), " [");
+            for (int q = 0; q < n_queries; q++) {
+                if (!(hits[i].queries & (1u << q))) continue;
+                t += snprintf(tags + t, sizeof(tags) - t, "%s%d", tags[t - 1] == '[' ? "" : ",", q + 1);
+            }
+            snprintf(tags + t, sizeof(tags) - t, "]");
+        }
+
+        size_t start = off;
+        int n = snprintf(output + off, output_size - off, "%d. %s%s\n   %s\n   ", i + 1,
+                         h->title[0] ? h->title : "(no title)", tags, h->url);
+        off += n > 0 ? (size_t)n : 0;
+        if (off > output_size - 1) off = output_size - 1;
+
+        size_t used = off - start + 2;
+        append_cut(output, output_size, &off, h->desc, share > used ? share - used : 0);
+        append_cut(output, output_size, &off, "\n\n", 2);
     }
-    return ESP_OK;
 }
 
 /* ── Execute ──────────────────────────────────────────────────── */
@@ -231,70 +551,89 @@ esp_err_t tool_web_search_execute(const char *input_json, char *output, size_t o
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Parse input to get query */
+    /* Parse input to get the queries */
     cJSON *input = cJSON_Parse(input_json);
     if (!input) {
         snprintf(output, output_size, "Error: Invalid input JSON");
         return ESP_ERR_INVALID_ARG;
     }
 
-    cJSON *query = cJSON_GetObjectItem(input, "query");
-    if (!query || !cJSON_IsString(query) || query->valuestring[0] == '\0') {
+    const char *queries[MIMI_WEB_SEARCH_MAX_QUERIES];
+    int n = collect_queries(input, queries);
+    if (n == 0) {
         cJSON_Delete(input);
-        snprintf(output, output_size, "Error: Missing 'query' field");
+        snprintf(output, output_size, "Error: Missing 'query' or 'queries' field");
         return ESP_ERR_INVALID_ARG;
     }
 
-    ESP_LOGI(TAG, "Searching: %s", query->valuestring);
-
-    /* Build URL */
-    char encoded_query[256];
-    url_encode(query->valuestring, encoded_query, sizeof(encoded_query));
-    cJSON_Delete(input);
-
-    char path[384];
-    snprintf(path, sizeof(path),
-             "/res/v1/web/search?q=%s&count=%d", encoded_query, SEARCH_RESULT_COUNT);
-
-    /* Allocate response buffer from PSRAM */
-    search_buf_t sb = {0};
-    sb.data = heap_caps_calloc(1, SEARCH_BUF_SIZE, MALLOC_CAP_SPIRAM);
-    if (!sb.data) {
+    /* Parser state and result slots live in PSRAM; responses are never held */
+    search_job_t *jobs = heap_caps_calloc(n, sizeof(search_job_t), MALLOC_CAP_SPIRAM);
+    if (!jobs) {
+        cJSON_Delete(input);
         snprintf(output, output_size, "Error: Out of memory");
         return ESP_ERR_NO_MEM;
     }
-    sb.cap = SEARCH_BUF_SIZE;
 
-    /* Make HTTP request */
-    esp_err_t err;
-    if (http_proxy_is_enabled()) {
-        err = search_via_proxy(path, &sb);
-    } else {
-        char url[512];
-        snprintf(url, sizeof(url), "https://api.search.brave.com%s", path);
-        err = search_direct(url, &sb);
+    bool proxied = http_proxy_is_enabled();
+    for (int i = 0; i < n; i++) {
+        search_job_t *job = &jobs[i];
+        ESP_LOGI(TAG, "Searching: %s", queries[i]);
+        snprintf(job->query, sizeof(job->query), "%s", queries[i]);
+
+        char encoded_query[256];
+        url_encode(queries[i], encoded_query, sizeof(encoded_query));
+        snprintf(job->path, sizeof(job->path),
+                 "/res/v1/web/search?q=%s&count=%d", encoded_query, SEARCH_RESULT_COUNT);
+        job->proxied = proxied;
     }
+    cJSON_Delete(input);
 
-    if (err != ESP_OK) {
-        free(sb.data);
-        snprintf(output, output_size, "Error: Search request failed");
-        return err;
+    int64_t start = esp_timer_get_time();
+    run_jobs(jobs, n);
+
+    merged_hit_t hits[MIMI_WEB_SEARCH_MAX_QUERIES * SEARCH_RESULT_COUNT];
+    int count = merge_hits(jobs, n, hits);
+    int failed = 0;
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < n; i++) {
+        if (jobs[i].err == ESP_OK) continue;
+        if (failed++ == 0) err = jobs[i].err;
     }
 
-    /* Parse and format results */
-    cJSON *root = cJSON_Parse(sb.data);
-    free(sb.data);
+    /* Several queries: list them first, results are tagged with their numbers */
+    size_t off = 0;
+    output[0] = '\0';
+    if (n > 1) {
+        append_cut(output, output_size, &off, "Queries:", SIZE_MAX);
+        for (int i = 0; i < n; i++) {
+            char num[8];
+            snprintf(num, sizeof(num), " [%d] ", i + 1);
+            append_cut(output, output_size, &off, num, SIZE_MAX);
+            append_cut(output, output_size, &off, jobs[i].query, SIZE_MAX);
+            if (jobs[i].err != ESP_OK) append_cut(output, output_size, &off, " (failed)", SIZE_MAX);
+        }
+        append_cut(output, output_size, &off, "\n\n", SIZE_MAX);
+    }
 
-    if (!root) {
+    esp_err_t ret = ESP_OK;
+    if (count > 0) {
+        /* Results read before a late failure are still worth returning */
+        format_hits(hits, count, n, output, output_size, off);
+    } else if (failed == n) {
+        snprintf(output, output_size, "Error: Search request failed");
+        ret = err;
+    } else if (n == 1 && jobs[0].js_status == JSON_STREAM_ERROR) {
         snprintf(output, output_size, "Error: Failed to parse search results");
-        return ESP_FAIL;
+        ret = ESP_FAIL;
+    } else {
+        append_cut(output, output_size, &off, "No web results found.", SIZE_MAX);
     }
+    free(jobs);
 
-    format_results(root, output, output_size);
-    cJSON_Delete(root);
-
-    ESP_LOGI(TAG, "Search complete, %d bytes result", (int)strlen(output));
-    return ESP_OK;
+    ESP_LOGI(TAG, "Search complete: %d queries (%d failed), %d unique results, %lld ms, %d bytes result",
+             n, failed, count, (long long)((esp_timer_get_time() - start) / 1000),
+             (int)strlen(output));
+    return ret;
 }
 
 esp_err_t tool_web_search_set_key(const char *api_key)
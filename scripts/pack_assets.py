@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Pack assets_data/ into the image flashed to the read-only "assets" partition.
+
+Layout (little-endian), read by main/storage/assets.c:
+
+    header   magic "MAS1", count, image length, CRC-32 of bytes 16..length
+    entries  count x { name[56] NUL-padded, offset, length }, sorted by name
+    data     each file followed by a NUL, so it can be used as a C string
+
+Names are paths relative to the source directory, e.g. "skills/weather.md".
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"MAS1"
+HEADER = struct.Struct("<4sIII")
+ENTRY = struct.Struct("<56sII")
+
+
+def collect(src):
+    files = []
+    for root, dirs, names in os.walk(src):
+        dirs.sort()
+        for name in names:
+            if name.startswith("."):
+                continue
+            path = os.path.join(root, name)
+            rel = os.path.relpath(path, src).replace(os.sep, "/")
+            if len(rel.encode()) >= ENTRY.size - 8:
+                sys.exit(f"pack_assets: name too long: {rel}")
+            with open(path, "rb") as f:
+                data = f.read()
+            if b"\0" in data:
+                sys.exit(f"pack_assets: {rel} contains a NUL byte")
+            files.append((rel.encode(), data))
+    files.sort()
+    return files
+
+
+def pack(files):
+    offset = HEADER.size + ENTRY.size * len(files)
+    table = b""
+    blob = b""
+    for name, data in files:
+        table += ENTRY.pack(name, offset + len(blob), len(data))
+        blob += data + b"\0"
+    body = table + blob
+    length = HEADER.size + len(body)
+    return HEADER.pack(MAGIC, len(files), length, zlib.crc32(body)) + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("src", help="directory to pack")
+    parser.add_argument("out", help="image file to write")
+    parser.add_argument("size", type=lambda s: int(s, 0), help="partition size in bytes")
+    args = parser.parse_args()
+
+    files = collect(args.src)
+    image = pack(files)
+    if len(image) > args.size:
+        sys.exit(f"pack_assets: {len(image)} bytes do not fit the {args.size}-byte partition")
+
+    with open(args.out, "wb") as f:
+        f.write(image + b"\xff" * (args.size - len(image)))
+    print(f"pack_assets: {len(files)} files, {len(image)} of {args.size} bytes")
+
+
+if __name__ == "__main__":
+    main()